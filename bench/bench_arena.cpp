@@ -0,0 +1,96 @@
+// Typical math temporaries allocated from the global heap against a per
+// thread ArenaResource that is reset after every task (as a render tile
+// would), single-threaded and across the thread pool where heap contention
+// shows up.
+#include "bench_util.hpp"
+#include "arena.hpp"
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+#include <cstdio>
+#include <functional>
+#include <random>
+
+
+namespace {
+
+constexpr std::size_t kChainsPerTask = 64;
+
+struct Inputs {
+    VectorData<float> a, b, c;
+    MatrixND<float> m;
+};
+
+Inputs makeInputs(std::size_t n) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> value(-1, 1);
+    std::vector<float> a(n), b(n), c(n);
+    for (std::size_t i = 0; i < n; i++) {
+        a[i] = value(rng);
+        b[i] = value(rng);
+        c[i] = value(rng);
+    }
+    MatrixND<float> m(4, 4);
+    for (std::size_t i = 0; i < 4; i++) {
+        for (std::size_t j = 0; j < 4; j++) m.set(i, j, value(rng));
+    }
+    return Inputs{VectorData<float>(a), VectorData<float>(b), VectorData<float>(c), m};
+}
+
+// Eager VectorData operators (one buffer each), a lazy VectorND chain and a
+// small matrix product, as transform code strings them together.
+float chain(const Inputs& in) {
+    VectorData<float> t = (in.a + in.b) * 0.5f;
+    VectorData<float> u = t - in.c / 3.0f;
+    VectorND<float> v = VectorND<float>(u) * 2.0f + in.a;
+    MatrixND<float> p = in.m * in.m;
+    return v.get(0) + p.get(1, 2);
+}
+
+double tasksPerSecond(ThreadPool* pool, std::size_t tasks, const std::function<void(std::size_t)>& task) {
+    int reps = 0;
+    Timer timer;
+    do {
+        if (pool) {
+            pool->parallelFor(tasks, task);
+        } else {
+            for (std::size_t i = 0; i < tasks; i++) task(i);
+        }
+        reps++;
+    } while (timer.seconds() < 0.3);
+    return double(tasks) * reps / timer.seconds();
+}
+
+}
+
+int main() {
+    ThreadPool pool;
+    std::printf("%d chains per task, %zu pool threads; tasks/s\n", int(kChainsPerTask), pool.size());
+    std::printf("%8s %8s %12s %12s %8s\n", "length", "threads", "malloc", "arena", "speedup");
+
+    for (std::size_t n : {3, 64, 1024}) {
+        Inputs inputs = makeInputs(n);
+        for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+            auto heapTask = [&](std::size_t) {
+                float acc = 0;
+                for (std::size_t k = 0; k < kChainsPerTask; k++) acc += chain(inputs);
+                doNotOptimize(acc);
+            };
+            auto arenaTask = [&](std::size_t) {
+                thread_local ArenaResource arena;
+                float acc = 0;
+                {
+                    ScopedMathResource scope(&arena);
+                    for (std::size_t k = 0; k < kChainsPerTask; k++) acc += chain(inputs);
+                }
+                arena.reset();
+                doNotOptimize(acc);
+            };
+            std::size_t tasks = p ? 8 * pool.size() : 8;
+            double heap = tasksPerSecond(p, tasks, heapTask);
+            double arena = tasksPerSecond(p, tasks, arenaTask);
+            std::printf("%8zu %8zu %12.0f %12.0f %7.2fx\n", n, p ? pool.size() : 1, heap, arena, arena / heap);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+// Closest-hit queries per second, linear scan over Scene::objects() versus the
+// BVH, as the number of spheres grows.
+#include "bench_util.hpp"
+#include "scene.hpp"
+#include <cstdio>
+#include <random>
+
+
+static double raysPerSecond(const Scene& scene, const std::vector<Ray>& rays, int& hits) {
+    hits = 0;
+    Timer timer;
+    for (const Ray& ray : rays) {
+        hits += scene.intersect(ray).has_value();
+    }
+    return rays.size() / timer.seconds();
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-100, 100);
+    std::uniform_real_distribution<float> radius(0.5, 4);
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 1000; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+
+    std::printf("%10s %14s %14s %10s %8s\n", "objects", "linear ray/s", "bvh ray/s", "speedup", "hits");
+    for (int count = 16; count <= 16384; count *= 4) {
+        Scene scene;
+        for (int i = 0; i < count; i++) {
+            scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+        }
+
+        int linearHits, bvhHits;
+        double linear = raysPerSecond(scene, rays, linearHits);
+        scene.buildBVH();
+        double bvh = raysPerSecond(scene, rays, bvhHits);
+        std::printf("%10d %14.0f %14.0f %9.1fx %8d%s\n", count, linear, bvh, bvh / linear, bvhHits,
+                    linearHits == bvhHits ? "" : "  MISMATCH");
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// BVH build time, SAH cost and closest-hit rays per second for each build
+// quality, serial and on a thread pool, at 100k, 1M and 10M spheres (or up
+// to argv[1] spheres).
+#include "bench_util.hpp"
+#include "bvh.hpp"
+#include "sphere_kernels.hpp"
+#include "thread_pool.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+
+int main(int argc, char** argv) {
+    std::size_t maxCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-100, 100);
+    std::uniform_real_distribution<float> radius(0.5, 4);
+    ThreadPool pool;
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 4000; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+
+    std::printf("%zu pool threads\n", pool.size());
+    std::printf("%9s %9s %10s %10s %8s %9s %12s\n", "spheres", "quality", "serial s", "pool s", "speedup", "sah cost",
+                "ray/s");
+    for (std::size_t count = 100000; count <= maxCount; count *= 10) {
+        // Keep the density roughly constant so hit rates are comparable.
+        float scale = std::cbrt(count / 1000.0f);
+        std::vector<std::unique_ptr<SceneObject>> objects;
+        objects.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            objects.push_back(std::make_unique<SphereSceneObject>(coord(rng) * scale, coord(rng) * scale, coord(rng) * scale,
+                                                                  1, 1, 1, 1, radius(rng)));
+        }
+        std::vector<Ray> scaled = rays;
+        for (Ray& ray : scaled) ray.origin = ray.origin * scale;
+
+        for (BVHQuality quality : {BVHQuality::Median, BVHQuality::Fast, BVHQuality::Balanced, BVHQuality::High}) {
+            BVHBuildOptions options;
+            options.quality = quality;
+            Timer timer;
+            BVH serial(objects, options);
+            double serialSeconds = timer.seconds();
+            options.pool = &pool;
+            timer.reset();
+            BVH bvh(objects, options);
+            double poolSeconds = timer.seconds();
+
+            // Spheres in leaf order, as Scene keeps them.
+            std::vector<float> cx, cy, cz, r;
+            for (std::uint32_t idx : bvh.indices()) {
+                cx.push_back(objects[idx]->position().x());
+                cy.push_back(objects[idx]->position().y());
+                cz.push_back(objects[idx]->position().z());
+                r.push_back(objects[idx]->radius());
+            }
+            SphereArrays spheres{cx.data(), cy.data(), cz.data(), r.data(), bvh.indices().data()};
+            int hits = 0, passes = 0;
+            timer.reset();
+            do {
+                for (const Ray& ray : scaled) {
+                    hits += bvh_detail::closestLeafHit(bvh.nodes().data(), ray,
+                                                       [&](std::uint32_t first, std::uint32_t n, std::optional<PrimitiveHit>& best) {
+                        sphere_kernels::nearest(spheres, first, first + n, ray, best);
+                    }).has_value();
+                }
+                passes++;
+            } while (timer.seconds() < 0.3);
+            doNotOptimize(hits);
+
+            std::printf("%9zu %9s %10.3f %10.3f %7.2fx %9.2f %12.0f\n", count, bvhQualityName(quality), serialSeconds,
+                        poolSeconds, serialSeconds / poolSeconds, bvh.sahCost(), scaled.size() * passes / timer.seconds());
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Per-frame BVH upkeep for an animated scene: Scene::updateBVH() refitting
+// around a few moving spheres versus rebuilding the whole tree, with the SAH
+// cost drift and the number of rebuilds the growth threshold triggered.
+#include "bench_util.hpp"
+#include "scene.hpp"
+#include "thread_pool.hpp"
+#include <cstdio>
+#include <random>
+
+
+int main() {
+    constexpr int kFrames = 50;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-100, 100);
+    std::uniform_real_distribution<float> radius(0.5, 4);
+    std::uniform_real_distribution<float> step(-0.5, 0.5);
+    ThreadPool pool;
+    BVHBuildOptions options;
+    options.pool = &pool;
+
+    std::printf("%9s %8s %12s %12s %9s %10s %9s\n", "spheres", "moving", "refit ms", "rebuild ms", "speedup",
+                "sah drift", "rebuilds");
+    for (int count = 100000; count <= 1000000; count *= 10) {
+        float scale = std::cbrt(count / 1000.0f);
+        Scene scene;
+        scene.reserveObjects(count);
+        for (int i = 0; i < count; i++) {
+            scene.addObject(std::make_unique<SphereSceneObject>(coord(rng) * scale, coord(rng) * scale, coord(rng) * scale,
+                                                                1, 1, 1, 1, radius(rng)));
+        }
+        Timer timer;
+        scene.buildBVH(options);
+        double rebuild = timer.seconds();
+
+        for (int moving : {10, 1000, count / 10}) {
+            scene.buildBVH(options);
+            const float built = scene.bvh().sahCost();
+            std::uniform_int_distribution<int> pick(0, count - 1);
+            std::vector<int> movers(moving);
+            for (int& idx : movers) idx = pick(rng);
+
+            int rebuilds = 0;
+            double update = 0;
+            for (int frame = 0; frame < kFrames; frame++) {
+                for (int idx : movers) {
+                    const Vector3D& p = scene.objects()[idx]->position();
+                    scene.setPosition(idx, p.x() + step(rng), p.y() + step(rng), p.z() + step(rng));
+                }
+                timer.reset();
+                rebuilds += scene.updateBVH(options) == BVHUpdate::Rebuild;
+                update += timer.seconds();
+            }
+            double refit = update / kFrames;
+            std::printf("%9d %8d %12.3f %12.3f %8.1fx %9.3fx %9d\n", count, moving, refit * 1000, rebuild * 1000,
+                        rebuild / refit, scene.bvh().sahCost() / built, rebuilds);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Time to first ray: from nothing in memory to the first closest-hit answer,
+// for a text scene (parse + BVH build) against the binary scene cache, both
+// verified and traced in place on the mapping and converted back into a
+// Scene as the renderer does. The cache is measured with a warm page cache
+// and after evicting the file from it.
+// N random spheres, default 1M, or argv[1].
+#include "bench_util.hpp"
+#include "scene_cache.hpp"
+#include "scene_file.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <unistd.h>
+
+
+namespace {
+
+// Drops the file's pages from the page cache, so the next mapping reads the disk.
+void evict(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+Ray firstRay(const Camera& cam, const RenderSettings& settings) {
+    return Ray{cam.getRayOrigin(settings.height, settings.width, settings.height / 2, settings.width / 2),
+               cam.orientation()};
+}
+
+void report(const char* label, double seconds, const std::optional<HitInfo>& hit) {
+    std::printf("%-32s %9.1f ms   first hit: %s %u\n", label, seconds * 1e3, hit ? "object" : "none",
+                hit ? hit->objectId : 0);
+    std::fflush(stdout);
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::string textPath = (std::filesystem::temp_directory_path() / "bench_first_ray.scene").string();
+    std::string cachePath = (std::filesystem::temp_directory_path() / "bench_first_ray.rtcache").string();
+    writeRandomSceneFile(textPath, count);
+    {
+        Scene scene;
+        RenderSettings settings;
+        loadScene(textPath, scene, settings);
+        scene.buildBVH();
+        writeSceneCache(cachePath, scene, settings);
+    }
+    std::printf("%zu spheres: text %.1f MB, cache %.1f MB\n", count, std::filesystem::file_size(textPath) / 1e6,
+                std::filesystem::file_size(cachePath) / 1e6);
+
+    {
+        Timer timer;
+        Scene scene;
+        RenderSettings settings;
+        loadScene(textPath, scene, settings);
+        scene.buildBVH();
+        std::optional<HitInfo> hit = scene.intersect(firstRay(*scene.cam(), settings));
+        report("text: parse + build", timer.seconds(), hit);
+    }
+    for (bool cold : {false, true}) {
+        if (cold) evict(cachePath);
+        Timer timer;
+        SceneCache cache(cachePath);
+        // intersect() is only safe on a verified file.
+        cache.verify();
+        std::optional<HitInfo> hit = cache.intersect(firstRay(cache.camera(), cache.settings()));
+        report(cold ? "cache verify + in place (cold)" : "cache verify + in place (warm)", timer.seconds(), hit);
+    }
+    for (bool cold : {false, true}) {
+        if (cold) evict(cachePath);
+        Timer timer;
+        SceneCache cache(cachePath);
+        Scene scene;
+        cache.toScene(scene);
+        std::optional<HitInfo> hit = scene.intersect(firstRay(*scene.cam(), cache.settings()));
+        report(cold ? "cache -> Scene (cold)" : "cache -> Scene (warm)", timer.seconds(), hit);
+    }
+
+    std::filesystem::remove(textPath);
+    std::filesystem::remove(cachePath);
+    return 0;
+}
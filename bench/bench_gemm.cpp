@@ -0,0 +1,67 @@
+// MatrixND<float> multiply throughput in GFLOP/s for n x n matrices: the old
+// transpose + VectorND::dot path against the packed GEMM with the scalar and
+// the runtime-selected SIMD microkernels.
+#include "bench_util.hpp"
+#include "matrix.hpp"
+#include <cstdio>
+#include <functional>
+#include <random>
+
+
+// What MatrixND::mul used to do: transpose B, then one VectorND::dot (with its
+// temporary product vector) per output element.
+static MatrixND<float> legacyMul(const MatrixND<float>& a, const MatrixND<float>& b) {
+    MatrixND<float> bt = b.transpose();
+    std::vector<VectorND<float>> rowsA, colsB;
+    for (std::size_t i = 0; i < a.rows(); i++) rowsA.push_back(a.get(i));
+    for (std::size_t j = 0; j < bt.rows(); j++) colsB.push_back(bt.get(j));
+    MatrixND<float> c(a.rows(), b.cols());
+    for (std::size_t i = 0; i < a.rows(); i++) {
+        for (std::size_t j = 0; j < b.cols(); j++) {
+            c.set(i, j, rowsA[i].dot(colsB[j]));
+        }
+    }
+    return c;
+}
+
+static double gflops(std::size_t n, const std::function<void()>& fn) {
+    int reps = 0;
+    Timer timer;
+    do {
+        fn();
+        reps++;
+    } while (timer.seconds() < 0.25);
+    return 2.0 * n * n * n * reps / timer.seconds() / 1e9;
+}
+
+int main() {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> value(-1, 1);
+    GemmKernel simd = detectGemmKernel();
+
+    std::printf("%6s %12s %12s %12s\n", "n", "legacy", "gemm scalar", "gemm simd");
+    std::printf("%6s %12s %12s %12s\n", "", "GFLOP/s", "GFLOP/s", gemmKernelName(simd));
+    for (std::size_t n = 16; n <= 2048; n *= 2) {
+        MatrixND<float> a(n, n), b(n, n), c(n, n);
+        for (std::size_t i = 0; i < n; i++) {
+            for (std::size_t j = 0; j < n; j++) {
+                a.set(i, j, value(rng));
+                b.set(i, j, value(rng));
+            }
+        }
+
+        char legacy[32] = "skipped";
+        if (n <= 256) {
+            std::snprintf(legacy, sizeof(legacy), "%.3f", gflops(n, [&] { doNotOptimize(legacyMul(a, b)); }));
+        }
+        double scalar = gflops(n, [&] {
+            gemm(n, n, n, a.data(), a.ld(), b.data(), b.ld(), c.data(), c.ld(), GemmKernel::Scalar);
+        });
+        double vector = gflops(n, [&] {
+            gemm(n, n, n, a.data(), a.ld(), b.data(), b.ld(), c.data(), c.ld(), simd);
+        });
+        std::printf("%6zu %12s %12.2f %12.2f\n", n, legacy, scalar, vector);
+        std::fflush(stdout);
+    }
+    return 0;
+}
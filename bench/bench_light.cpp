@@ -0,0 +1,69 @@
+// Noise per ray of the irradiance a sphere light casts on a point: bounce
+// rays that count when they happen to hit the light (cosine-weighted over
+// the hemisphere, as a path tracer would find a Light sphere) versus one
+// AnalyticLight sample toward the light. Both spend one ray per sample; the
+// last column is how many times more rays the bounce estimate needs for the
+// same error.
+#include "bench_util.hpp"
+#include "light.hpp"
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <random>
+
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0, 1);
+    const Vector3D normal(0, 1, 0);
+    const int kEstimates = 20000;
+
+    std::printf("%7s %7s %9s %12s %12s %12s %12s %12s %9s\n", "radius", "dist", "samples", "exact", "bounce rms",
+                "light rms", "bounce ns", "light ns", "rays x");
+    for (float distance : {4.0f, 10.0f, 40.0f}) {
+        const float radius = 1;
+        // 60 degrees off the normal, still entirely above the horizon.
+        const Vector3D center(distance * std::sqrt(0.75f), distance * 0.5f, 0);
+        AnalyticLight light = AnalyticLight::sphere(center, radius, 1, 1, 1, 100);
+        // Above the horizon a sphere light gives what a point light would.
+        const double exact = 100.0 / (distance * distance) * 0.5;
+
+        for (int samples : {1, 16, 256}) {
+            double bounceErr = 0, lightErr = 0;
+            Timer timer;
+            for (int e = 0; e < kEstimates; e++) {
+                double sum = 0;
+                for (int s = 0; s < samples; s++) {
+                    float r = std::sqrt(unit(rng)), phi = 2 * std::numbers::pi_v<float> * unit(rng);
+                    Vector3D dir(r * std::cos(phi), std::sqrt(std::max(0.0f, 1 - r * r)), r * std::sin(phi));
+                    // Ray against the light from outside: project and compare.
+                    float proj = center.dot(dir);
+                    bool hit = proj > 0 && center.lengthSquared() - proj * proj <= radius * radius;
+                    // Radiance 100 / (pi r^2) times pi, over a cosine-weighted pdf.
+                    sum += hit ? 100.0 / (radius * radius) : 0;
+                }
+                bounceErr += std::pow(sum / samples - exact, 2);
+            }
+            double bounceNs = timer.seconds() * 1e9 / (double(kEstimates) * samples);
+            timer.reset();
+            for (int e = 0; e < kEstimates; e++) {
+                double sum = 0;
+                for (int s = 0; s < samples; s++) {
+                    LightSample sample = light.sample(Vector3D(), unit(rng), unit(rng));
+                    sum += sample.weight[0] * std::max(0.0f, normal.dot(sample.direction));
+                }
+                lightErr += std::pow(sum / samples - exact, 2);
+            }
+            double lightNs = timer.seconds() * 1e9 / (double(kEstimates) * samples);
+            doNotOptimize(lightErr);
+
+            double bounceRms = std::sqrt(bounceErr / kEstimates) / exact;
+            double lightRms = std::sqrt(lightErr / kEstimates) / exact;
+            std::printf("%7.1f %7.1f %9d %12.4f %11.2f%% %11.2f%% %12.1f %12.1f %8.3gx\n", radius, distance, samples,
+                        exact, bounceRms * 100, lightRms * 100, bounceNs, lightNs,
+                        std::pow(bounceRms / lightRms, 2));
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
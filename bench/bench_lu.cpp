@@ -0,0 +1,61 @@
+// MatrixND<double> determinant and inverse through the LU factorisation, and
+// the cofactor expansion they replaced, for growing n. The LU columns should
+// scale as n^3 (roughly constant time/n^3); Laplace expansion grows as n!.
+#include "bench_util.hpp"
+#include "matrix.hpp"
+#include <cstdio>
+#include <functional>
+#include <random>
+
+
+// What MatrixND::determinant used to do: expand along the first row.
+static double laplaceDeterminant(const MatrixND<double>& m) {
+    if (m.rows() == 1) return m.get(0, 0);
+    if (m.rows() == 2) return m.get(0, 0) * m.get(1, 1) - m.get(0, 1) * m.get(1, 0);
+    double det = 0;
+    for (std::size_t i = 0; i < m.cols(); i++) {
+        double minor = laplaceDeterminant(m.minorMat(0, i));
+        det += (i % 2 == 0 ? 1 : -1) * m.get(0, i) * minor;
+    }
+    return det;
+}
+
+static double secondsPerCall(const std::function<void()>& fn) {
+    int reps = 0;
+    Timer timer;
+    do {
+        fn();
+        reps++;
+    } while (timer.seconds() < 0.25);
+    return timer.seconds() / reps;
+}
+
+int main() {
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<double> value(-1, 1);
+
+    std::printf("%6s %14s %14s %14s %14s %14s\n", "n", "laplace det", "lu det", "lu det/n^3", "lu inverse",
+                "inverse/n^3");
+    std::printf("%6s %14s %14s %14s %14s %14s\n", "", "us", "us", "ns", "us", "ns");
+    for (std::size_t n = 4; n <= 512; n *= 2) {
+        MatrixND<double> a(n, n);
+        for (std::size_t i = 0; i < n; i++) {
+            for (std::size_t j = 0; j < n; j++) {
+                a.set(i, j, value(rng));
+            }
+        }
+        double cube = double(n) * n * n;
+
+        char laplace[32] = "skipped";
+        if (n <= 8) {
+            std::snprintf(laplace, sizeof(laplace), "%.2f",
+                          secondsPerCall([&] { doNotOptimize(laplaceDeterminant(a)); }) * 1e6);
+        }
+        double det = secondsPerCall([&] { doNotOptimize(a.determinant()); });
+        double inv = secondsPerCall([&] { doNotOptimize(a.inverse()); });
+        std::printf("%6zu %14s %14.2f %14.3f %14.2f %14.3f\n", n, laplace, det * 1e6, det / cube * 1e9, inv * 1e6,
+                    inv / cube * 1e9);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+// Shadow rays per second: the yes/no answer from Scene::occluded() for
+// 0 < t < tmax versus the closest-hit query Scene::intersect(), which does
+// not stop early. The blocked column is occluded()'s answer.
+#include "bench_util.hpp"
+#include "scene.hpp"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+
+template <typename Query>
+static double raysPerSecond(const std::vector<Ray>& rays, int& blocked, Query&& query) {
+    Timer timer;
+    int passes = 0;
+    do {
+        blocked = 0;
+        for (const Ray& ray : rays) blocked += query(ray);
+        passes++;
+    } while (timer.seconds() < 0.3);
+    return rays.size() * passes / timer.seconds();
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-100, 100);
+    std::uniform_real_distribution<float> radius(2, 8);
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 4000; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+    const float tmax = 50;
+
+    std::printf("%9s %9s %16s %16s %8s\n", "spheres", "blocked", "intersect ray/s", "occluded ray/s", "speedup");
+    for (int count = 1000; count <= 1000000; count *= 10) {
+        float scale = std::cbrt(count / 1000.0f);
+        Scene scene;
+        scene.reserveObjects(count);
+        for (int i = 0; i < count; i++) {
+            scene.addObject(std::make_unique<SphereSceneObject>(coord(rng) * scale, coord(rng) * scale, coord(rng) * scale,
+                                                                1, 1, 1, 1, radius(rng)));
+        }
+        scene.buildBVH();
+        std::vector<Ray> scaled = rays;
+        for (Ray& ray : scaled) ray.origin = ray.origin * scale;
+
+        int viaIntersect, viaOccluded;
+        double closest = raysPerSecond(scaled, viaIntersect, [&](const Ray& ray) {
+            std::optional<HitInfo> hit = scene.intersect(ray);
+            return hit && std::abs(hit->t) < tmax;
+        });
+        double any = raysPerSecond(scaled, viaOccluded, [&](const Ray& ray) {
+            return scene.occluded(ray.origin, ray.direction, 0, tmax);
+        });
+        std::printf("%9d %8.1f%% %16.0f %16.0f %7.2fx\n", count, 100.0 * viaOccluded / scaled.size(), closest, any,
+                    any / closest);
+        std::fflush(stdout);
+    }
+    return 0;
+}
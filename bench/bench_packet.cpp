@@ -0,0 +1,83 @@
+// Primary visibility rays per second, one ray at a time versus 4x4 and 8x8
+// RayPackets sharing a BVH traversal, for scenes from 1 to 1M spheres.
+#include "bench_util.hpp"
+#include "renderer.hpp"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+
+constexpr int kWidth = 640, kHeight = 480;
+
+// Traces every primary ray of the image once; returns rays/s and the hit count.
+static double raysPerSecond(const Scene& scene, int packetSize, int& hits) {
+    hits = 0;
+    Timer timer;
+    int passes = 0;
+    RayPacket packet;
+    std::optional<HitInfo> packetHits[RayPacket::kMaxRays];
+    do {
+        hits = 0;
+        for (int by = 0; by < kHeight; by += packetSize) {
+            for (int bx = 0; bx < kWidth; bx += packetSize) {
+                if (packetSize == 1) {
+                    hits += scene.intersect(primaryRay(scene, kHeight, kWidth, by, bx)).has_value();
+                    continue;
+                }
+                packet.count = 0;
+                for (int i = by; i < std::min(by + packetSize, kHeight); i++) {
+                    for (int j = bx; j < std::min(bx + packetSize, kWidth); j++) {
+                        packet.add(primaryRay(scene, kHeight, kWidth, i, j));
+                    }
+                }
+                scene.intersect(packet, packetHits);
+                for (int i = 0; i < packet.count; i++) hits += packetHits[i].has_value();
+            }
+        }
+        passes++;
+    } while (timer.seconds() < 0.5);
+    return double(kWidth) * kHeight * passes / timer.seconds();
+}
+
+int main() {
+    Scene probe;
+    probe.setCamera(std::make_unique<Camera>(-4, 1, 0, 0, 0.2, 0.1, 4));
+    AABB view;
+    for (int i = 0; i < kHeight; i += 8) {
+        for (int j = 0; j < kWidth; j += 8) {
+            Vector3D o = primaryRay(probe, kHeight, kWidth, i, j).origin;
+            view.grow(o.x(), o.y(), o.z());
+        }
+    }
+
+    std::printf("%9s %14s %14s %8s %14s %8s %8s\n", "spheres", "single ray/s", "4x4 ray/s", "speedup", "8x8 ray/s",
+                "speedup", "hits");
+    for (int count = 1; count <= 1000000; count *= 10) {
+        // Spheres over the region the primary rays start from, sized so the
+        // image stays partly covered at every count.
+        std::mt19937 rng(count);
+        float size = std::max({view.extent(0), view.extent(1), view.extent(2)});
+        std::uniform_real_distribution<float> x(view.min[0] - size / 4, view.max[0] + size / 4);
+        std::uniform_real_distribution<float> y(view.min[1] - size / 4, view.max[1] + size / 4);
+        std::uniform_real_distribution<float> z(view.min[2] - size / 4, view.max[2] + size / 4);
+        std::uniform_real_distribution<float> radius(0.1f, 0.6f);
+        float scale = size / std::cbrt(float(count));
+
+        Scene scene;
+        scene.setCamera(std::make_unique<Camera>(-4, 1, 0, 0, 0.2, 0.1, 4));
+        scene.reserveObjects(count);
+        for (int i = 0; i < count; i++) {
+            scene.addObject(std::make_unique<SphereSceneObject>(x(rng), y(rng), z(rng), 1, 1, 1, 1, radius(rng) * scale));
+        }
+        scene.buildBVH();
+
+        int singleHits, hits4, hits8;
+        double single = raysPerSecond(scene, 1, singleHits);
+        double packet4 = raysPerSecond(scene, 4, hits4);
+        double packet8 = raysPerSecond(scene, 8, hits8);
+        std::printf("%9d %14.0f %14.0f %7.2fx %14.0f %7.2fx %8d%s\n", count, single, packet4, packet4 / single, packet8,
+                    packet8 / single, singleHits, singleHits == hits4 && singleHits == hits8 ? "" : "  MISMATCH");
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+// Text scene load time: writes a scene of N random spheres (default 10M,
+// or argv[1]) to a temporary file, then times loadScene() into a fresh Scene.
+#include "bench_util.hpp"
+#include "scene_file.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+
+int main(int argc, char** argv) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    std::string path = (std::filesystem::temp_directory_path() / "bench_scene_load.scene").string();
+
+    Timer timer;
+    writeRandomSceneFile(path, count);
+    std::printf("wrote %zu spheres, %.1f MB in %.2f s\n", count, std::filesystem::file_size(path) / 1e6, timer.seconds());
+    std::fflush(stdout);
+
+    Scene scene;
+    RenderSettings settings;
+    timer.reset();
+    SceneFileStats stats = loadScene(path, scene, settings);
+    double seconds = timer.seconds();
+    std::printf("loaded %zu objects, %zu lines in %.2f s: %.0f MB/s, %.2f M objects/s\n", stats.objects, stats.lines,
+                seconds, stats.bytes / seconds / 1e6, stats.objects / seconds / 1e6);
+    std::fflush(stdout);
+
+    timer.reset();
+    scene.buildBVH();
+    std::printf("BVH build %.2f s\n", timer.seconds());
+
+    std::filesystem::remove(path);
+    return 0;
+}
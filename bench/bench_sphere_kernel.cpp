@@ -0,0 +1,90 @@
+// Closest-hit queries per second for one ray against n spheres: the virtual
+// SphereSceneObject::intersect loop versus sphere_kernels::nearest at each
+// SIMD level, brute force and in BVH leaves.
+#include "bench_util.hpp"
+#include "scene.hpp"
+#include "sphere_kernels.hpp"
+#include <cstdio>
+#include <random>
+
+
+template <typename Query>
+static double raysPerSecond(const std::vector<Ray>& rays, int& hits, Query&& query) {
+    hits = 0;
+    Timer timer;
+    int passes = 0;
+    do {
+        for (const Ray& ray : rays) hits += query(ray);
+        passes++;
+    } while (timer.seconds() < 0.2);
+    hits /= passes;
+    return rays.size() * passes / timer.seconds();
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-100, 100);
+    std::uniform_real_distribution<float> radius(0.5, 40);
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 1000; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2}) {
+        if (level <= detectSimdLevel()) levels.push_back(level);
+    }
+
+    std::printf("brute force\n%10s %14s", "spheres", "virtual ray/s");
+    for (SimdLevel level : levels) std::printf(" %12s/s %7s", simdLevelName(level), "speedup");
+    std::printf("\n");
+    for (int count = 8; count <= 4096; count *= 8) {
+        Scene scene;
+        for (int i = 0; i < count; i++) {
+            scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+        }
+
+        int virtualHits;
+        double virtualRate = raysPerSecond(rays, virtualHits, [&](const Ray& ray) {
+            std::optional<PrimitiveHit> best;
+            for (std::uint32_t i = 0; i < scene.objects().size(); i++) {
+                std::optional<HitInfo> hit = scene.objects()[i]->intersect(ray.origin, ray.direction);
+                if (!hit) continue;
+                PrimitiveHit candidate{i, hit->t};
+                if (!best || candidate.closerThan(*best)) best = candidate;
+            }
+            return best.has_value();
+        });
+        std::printf("%10d %14.0f", count, virtualRate);
+        for (SimdLevel level : levels) {
+            int hits;
+            double rate = raysPerSecond(rays, hits, [&](const Ray& ray) {
+                std::optional<PrimitiveHit> best;
+                sphere_kernels::nearest(scene.spheres().arrays(), 0, count, ray, best, level);
+                return best.has_value();
+            });
+            std::printf(" %14.0f %6.1fx%s", rate, rate / virtualRate, hits == virtualHits ? "" : " MISMATCH");
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    std::printf("\nbvh\n%10s %14s %14s %8s\n", "spheres", "virtual ray/s", "kernel ray/s", "speedup");
+    for (int count = 1024; count <= 65536; count *= 8) {
+        Scene scene;
+        for (int i = 0; i < count; i++) {
+            scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng) / 8));
+        }
+        scene.buildBVH();
+
+        int virtualHits, kernelHits;
+        double virtualRate = raysPerSecond(rays, virtualHits, [&](const Ray& ray) {
+            return scene.bvh().intersect(ray, scene.objects()).has_value();
+        });
+        double kernelRate = raysPerSecond(rays, kernelHits, [&](const Ray& ray) { return scene.intersect(ray).has_value(); });
+        std::printf("%10d %14.0f %14.0f %7.1fx%s\n", count, virtualRate, kernelRate, kernelRate / virtualRate,
+                    kernelHits == virtualHits ? "" : "  MISMATCH");
+        std::fflush(stdout);
+    }
+    return 0;
+}
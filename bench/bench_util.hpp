@@ -0,0 +1,54 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+
+// Wall-clock stopwatch for the benchmarks.
+class Timer {
+public:
+    Timer() : _start(std::chrono::steady_clock::now()) {}
+    void reset() { _start = std::chrono::steady_clock::now(); }
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+// Keeps the optimiser from discarding a result.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Text scene (see include/scene_file.hpp) with one camera, one light and
+// count random spheres in a 2000-unit cube.
+inline void writeRandomSceneFile(const std::string& path, std::size_t count) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    std::fputs("render 640 480 16 0\ncamera -4 1 0 0 0.2 0.1 4\nlight 0 15 0 1 1 1 23\n", file);
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> coord(-1000, 1000);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::string out;
+    for (std::size_t i = 0; i < count; i++) {
+        out += "sphere";
+        for (float v : {coord(rng), coord(rng), coord(rng), unit(rng), unit(rng), unit(rng), 1.0f, 0.5f + unit(rng)}) {
+            char buffer[32];
+            out += ' ';
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), v).ptr);
+        }
+        out += '\n';
+        if (out.size() > (1 << 20)) {
+            std::fwrite(out.data(), 1, out.size(), file);
+            out.clear();
+        }
+    }
+    std::fwrite(out.data(), 1, out.size(), file);
+    std::fclose(file);
+}
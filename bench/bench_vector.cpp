@@ -0,0 +1,70 @@
+// VectorData<float> element-wise add and dot product throughput (elements per
+// nanosecond) for growing lengths: the old get()/set() loop against the
+// vector kernels at every SIMD level this CPU supports.
+#include "bench_util.hpp"
+#include "vector.hpp"
+#include "vector_kernels.hpp"
+#include <cstdio>
+#include <functional>
+#include <random>
+
+
+static double elementsPerNs(std::size_t n, const std::function<void()>& fn) {
+    int reps = 0;
+    Timer timer;
+    do {
+        fn();
+        reps++;
+    } while (timer.seconds() < 0.1);
+    return double(n) * reps / timer.seconds() / 1e9;
+}
+
+// What VectorData::operator+ and VectorND::dot used to cost per element.
+static void legacyAdd(const VectorData<float>& a, const VectorData<float>& b, VectorData<float>& out) {
+    for (std::size_t i = 0; i < a.length(); i++) out.set(i, a.get(i) + b.get(i));
+}
+static float legacyDot(const VectorData<float>& a, const VectorData<float>& b) {
+    float total = 0;
+    for (std::size_t i = 0; i < a.length(); i++) total += a.get(i) * b.get(i);
+    return total;
+}
+
+int main() {
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> value(-1, 1);
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level <= detectSimdLevel()) levels.push_back(level);
+    }
+
+    for (const char* kernel : {"add", "dot"}) {
+        std::printf("%s, elements/ns\n%10s %10s", kernel, "n", "get/set");
+        for (SimdLevel level : levels) std::printf(" %10s", simdLevelName(level));
+        std::printf("\n");
+        for (std::size_t n = 64; n <= (1u << 22); n *= 8) {
+            std::vector<float> av(n), bv(n);
+            for (std::size_t i = 0; i < n; i++) {
+                av[i] = value(rng);
+                bv[i] = value(rng);
+            }
+            VectorData<float> a(av), b(bv), out(n);
+            bool add = kernel[0] == 'a';
+
+            std::printf("%10zu %10.3f", n, elementsPerNs(n, [&] {
+                if (add) legacyAdd(a, b, out);
+                else doNotOptimize(legacyDot(a, b));
+                doNotOptimize(out);
+            }));
+            for (SimdLevel level : levels) {
+                std::printf(" %10.3f", elementsPerNs(n, [&] {
+                    if (add) vector_kernels::binary(VectorOp::Add, a.data(), b.data(), out.data(), n, level);
+                    else doNotOptimize(vector_kernels::dot(a.data(), b.data(), n, level));
+                    doNotOptimize(out);
+                }));
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Closest-hit rays per second through the binary BVH versus the same tree
+// collapsed into BVH4 and BVH8, with leaves tested by the sphere kernel.
+#include "bench_util.hpp"
+#include "scene.hpp"
+#include "sphere_kernels.hpp"
+#include "wide_bvh.hpp"
+#include <cstdio>
+#include <random>
+
+
+template <typename Query>
+static double raysPerSecond(const std::vector<Ray>& rays, int& hits, Query&& query) {
+    Timer timer;
+    int passes = 0;
+    do {
+        hits = 0;
+        for (const Ray& ray : rays) hits += query(ray);
+        passes++;
+    } while (timer.seconds() < 0.3);
+    return rays.size() * passes / timer.seconds();
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-100, 100);
+    std::uniform_real_distribution<float> radius(0.5, 4);
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 4000; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+
+    std::printf("%9s %13s %13s %7s %13s %7s %10s %10s %10s\n", "spheres", "binary ray/s", "bvh4 ray/s", "speedup",
+                "bvh8 ray/s", "speedup", "binary KiB", "bvh4 KiB", "bvh8 KiB");
+    for (int count = 1000; count <= 1000000; count *= 10) {
+        // Keep the density roughly constant so hit rates are comparable.
+        float scale = std::cbrt(count / 1000.0f);
+        std::vector<std::unique_ptr<SceneObject>> objects;
+        objects.reserve(count);
+        for (int i = 0; i < count; i++) {
+            objects.push_back(std::make_unique<SphereSceneObject>(coord(rng) * scale, coord(rng) * scale, coord(rng) * scale,
+                                                                  1, 1, 1, 1, radius(rng)));
+        }
+        BVH bvh(objects);
+        WideBVH<4> bvh4(bvh);
+        WideBVH<8> bvh8(bvh);
+
+        // Spheres in leaf order, as Scene keeps them.
+        std::vector<float> cx, cy, cz, r;
+        for (std::uint32_t idx : bvh.indices()) {
+            cx.push_back(objects[idx]->position().x());
+            cy.push_back(objects[idx]->position().y());
+            cz.push_back(objects[idx]->position().z());
+            r.push_back(objects[idx]->radius());
+        }
+        SphereArrays spheres{cx.data(), cy.data(), cz.data(), r.data(), bvh.indices().data()};
+
+        std::vector<Ray> scaled = rays;
+        for (Ray& ray : scaled) ray.origin = ray.origin * scale;
+
+        int binaryHits, hits4, hits8;
+        double binary = raysPerSecond(scaled, binaryHits, [&](const Ray& ray) {
+            return bvh_detail::closestLeafHit(bvh.nodes().data(), ray,
+                                              [&](std::uint32_t first, std::uint32_t n, std::optional<PrimitiveHit>& best) {
+                sphere_kernels::nearest(spheres, first, first + n, ray, best);
+            }).has_value();
+        });
+        auto wideRate = [&](const auto& wide, int& hits) {
+            return raysPerSecond(scaled, hits, [&](const Ray& ray) {
+                std::optional<PrimitiveHit> best;
+                wide.closestLeafHit(ray, best, [&](std::uint32_t first, std::uint32_t n, std::optional<PrimitiveHit>& closest) {
+                    sphere_kernels::nearest(spheres, first, first + n, ray, closest);
+                });
+                return best.has_value();
+            });
+        };
+        double wide4 = wideRate(bvh4, hits4);
+        double wide8 = wideRate(bvh8, hits8);
+        std::printf("%9d %13.0f %13.0f %6.2fx %13.0f %6.2fx %10zu %10zu %10zu%s\n", count, binary, wide4, wide4 / binary,
+                    wide8, wide8 / binary, bvh.nodes().size() * sizeof(BVH::Node) / 1024,
+                    bvh4.nodes().size() * sizeof(WideNode<4>) / 1024, bvh8.nodes().size() * sizeof(WideNode<8>) / 1024,
+                    binaryHits == hits4 && binaryHits == hits8 ? "" : "  MISMATCH");
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+
+// Axis-aligned bounding box. An empty box has min > max on every axis, so
+// growing it by any point or box yields exactly that point or box.
+struct AABB {
+    float min[3] = { std::numeric_limits<float>::infinity(),  std::numeric_limits<float>::infinity(),  std::numeric_limits<float>::infinity()};
+    float max[3] = {-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+
+    AABB() {}
+    AABB(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+        : min{minX, minY, minZ}, max{maxX, maxY, maxZ} {}
+
+    bool empty() const { return min[0] > max[0] || min[1] > max[1] || min[2] > max[2]; }
+
+    void grow(const AABB& other) {
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], other.min[axis]);
+            max[axis] = std::max(max[axis], other.max[axis]);
+        }
+    }
+    void grow(float x, float y, float z) { grow(AABB(x, y, z, x, y, z)); }
+
+    float centroid(int axis) const { return 0.5f * (min[axis] + max[axis]); }
+    float extent(int axis) const { return max[axis] - min[axis]; }
+    int largestAxis() const {
+        int axis = extent(1) > extent(0) ? 1 : 0;
+        return extent(2) > extent(axis) ? 2 : axis;
+    }
+    float surfaceArea() const {
+        if (empty()) return 0;
+        return 2 * (extent(0) * extent(1) + extent(1) * extent(2) + extent(2) * extent(0));
+    }
+
+    // Squared distance from p to the closest point of the box (0 inside).
+    float distanceSquared(const float p[3]) const {
+        float total = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            float d = std::max({min[axis] - p[axis], 0.0f, p[axis] - max[axis]});
+            total += d * d;
+        }
+        return total;
+    }
+
+    // Slab test of the line origin + t*dir against the box for t in [tMin, tMax].
+    // invDir is 1/dir per axis; a zero direction component gives an infinite
+    // inverse, and the NaN that appears when the origin sits exactly on a slab
+    // plane fails both comparisons, so that axis simply doesn't constrain t.
+    bool intersects(const float origin[3], const float invDir[3], float tMin, float tMax) const {
+        for (int axis = 0; axis < 3; axis++) {
+            float t0 = (min[axis] - origin[axis]) * invDir[axis];
+            float t1 = (max[axis] - origin[axis]) * invDir[axis];
+            if (t0 > t1) std::swap(t0, t1);
+            if (t0 > tMin) tMin = t0;
+            if (t1 < tMax) tMax = t1;
+            if (tMin > tMax) return false;
+        }
+        return true;
+    }
+};
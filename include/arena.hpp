@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+
+// Bump-pointer std::pmr::memory_resource for short-lived math temporaries,
+// e.g. everything one render tile or one batch item allocates. Allocation
+// is a pointer bump inside the current block, deallocation is a no-op, and
+// reset() rewinds to the first block in O(1) so the same blocks are reused
+// by the next tile without going back to the upstream allocator. Not
+// thread-safe: give each thread its own arena.
+//
+// Unlike std::pmr::monotonic_buffer_resource, which can only release its
+// memory upstream, the blocks survive reset(). Anything allocated from the
+// arena must be gone before reset() or release().
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t kDefaultBlockSize = std::size_t(1) << 16;
+
+    explicit ArenaResource(std::size_t blockSize = kDefaultBlockSize,
+                           std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~ArenaResource() override;
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Forgets every allocation but keeps the blocks for reuse.
+    void reset();
+    // Forgets every allocation and returns the blocks upstream.
+    void release();
+
+    // Bytes handed out (including alignment padding) since the last reset.
+    std::size_t bytesUsed() const { return _used; }
+    // Bytes held in blocks.
+    std::size_t capacity() const;
+    std::size_t blockCount() const { return _blocks.size(); }
+
+private:
+    struct Block {
+        unsigned char* data;
+        std::size_t size;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    void enterBlock(std::size_t idx);
+
+    std::pmr::memory_resource* _upstream;
+    std::size_t _blockSize;
+    std::vector<Block> _blocks;
+    std::size_t _current = 0;
+    unsigned char* _cursor = nullptr;
+    unsigned char* _end = nullptr;
+    std::size_t _used = 0;
+};
+
+// Resource VectorData and MatrixND allocate from when none is passed
+// explicitly. It is per thread and defaults to new/delete; install an arena
+// for a scope with ScopedMathResource.
+std::pmr::memory_resource* currentMathResource();
+
+class ScopedMathResource {
+public:
+    explicit ScopedMathResource(std::pmr::memory_resource* resource);
+    ~ScopedMathResource();
+    ScopedMathResource(const ScopedMathResource&) = delete;
+    ScopedMathResource& operator=(const ScopedMathResource&) = delete;
+
+private:
+    std::pmr::memory_resource* _previous;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "vector.hpp"
+#include <functional>
+#include <string>
+
+
+// Headless rendering: frames go straight to image files, no display needed.
+struct BatchOptions {
+    RenderSettings settings;
+    // Output file; the extension picks the format (see image_io.hpp). May hold
+    // one integer conversion, %d, %4d or %04d, for the frame number.
+    std::string output;
+    int frames = 1;
+    // The camera moves by this much after every frame.
+    Vector3D cameraStep{0, 0, 0};
+    // Called before each frame is rendered, e.g. to move objects with
+    // Scene::setPosition(); the BVH is then refit (or rebuilt) to match.
+    std::function<void(Scene&, int frame)> animate;
+    // Builds the BVH when the scene has none, and refits or rebuilds it after
+    // animate. A null pool runs that work on the renderer's threads.
+    BVHBuildOptions bvh;
+    // Frames allowed to wait for the encoder before rendering blocks.
+    std::size_t maxPendingWrites = 2;
+};
+
+struct BatchReport {
+    int frames = 0;
+    double renderSeconds = 0; // time spent in Renderer::render
+    double writeSeconds = 0;  // time the encoder thread was busy
+    double bvhSeconds = 0;    // time spent in Scene::updateBVH
+    int bvhRebuilds = 0;
+    double wallSeconds = 0;
+};
+
+// Path of frame number frame out of frames. A pattern without a conversion
+// gets _NNNN inserted before the extension when frames > 1. Any '%' other
+// than one %d, %Nd or %0Nd (N up to 99) or a %% throws std::invalid_argument.
+std::string framePath(const std::string& pattern, int frame, int frames);
+
+// Renders options.frames frames of scene and writes each to disk. The thread
+// pool, the BVH and the framebuffers are set up once and reused for every
+// frame, and encoding runs on a background thread, overlapping the next
+// frame's render. Throws if an image cannot be written, without rendering
+// the frames after it.
+BatchReport renderBatch(Scene& scene, const BatchOptions& options);
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "ray.hpp"
+#include "ray_packet.hpp"
+#include "scene_object.hpp"
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+
+class ThreadPool;
+
+// How BVH construction trades build time for tree quality.
+enum class BVHQuality {
+    Median,   // object median on the widest centroid axis, serial (the original builder)
+    Fast,     // LBVH: sort along a Morton curve, split on the highest differing bit
+    Balanced, // binned SAH for the top levels, LBVH below lbvhThreshold primitives
+    High,     // binned SAH all the way down
+};
+
+const char* bvhQualityName(BVHQuality quality);
+// Inverse of bvhQualityName(); throws std::invalid_argument for unknown names.
+BVHQuality bvhQualityFromName(std::string_view name);
+
+struct BVHBuildOptions {
+    BVHQuality quality = BVHQuality::Balanced;
+    std::uint32_t lbvhThreshold = 4096;
+    int sahBins = 16; // per axis, at most 64
+    // Splits the top levels (binning big nodes in chunks) and then builds
+    // whole subtrees on this pool; null builds on the calling thread. The
+    // tree is the same either way.
+    ThreadPool* pool = nullptr;
+    // Scene::updateBVH() rebuilds instead of refitting once sahCost() has
+    // grown by this factor since the tree was built.
+    float rebuildSahGrowth = 1.25f;
+};
+
+// Bounding volume hierarchy over a list of scene objects, stored as one flat
+// node array. Children of an interior node sit next to each other
+// (leftFirst, leftFirst + 1); a leaf covers count entries of indices()
+// starting at leftFirst.
+class BVH {
+public:
+    struct Node {
+        AABB bounds;
+        std::uint32_t leftFirst = 0;
+        std::uint32_t count = 0;
+
+        bool isLeaf() const { return count > 0; }
+    };
+
+    static constexpr std::uint32_t kMaxLeafSize = 4;
+    // Levels, counting the root as 1. Builds stay within it and the
+    // traversal stacks are sized for it.
+    static constexpr int kMaxDepth = 64;
+
+    BVH() {}
+    explicit BVH(SceneObjectList objects,
+                 const BVHBuildOptions& options = BVHBuildOptions());
+    // Adopts a tree built earlier, e.g. one loaded from a scene cache.
+    BVH(std::vector<Node> nodes, std::vector<std::uint32_t> indices)
+        : _nodes(std::move(nodes)), _indices(std::move(indices)), _weightedArea(weightedArea()) {}
+
+    bool empty() const { return _nodes.empty(); }
+    const std::vector<Node>& nodes() const { return _nodes; }
+    const std::vector<std::uint32_t>& indices() const { return _indices; }
+
+    // Surface area heuristic cost of the tree, relative to the root's area:
+    // one unit per interior node and per primitive a random ray's line would
+    // visit. Lower is better; the Median builder is a typical baseline.
+    float sahCost() const;
+
+    // Recomputes the bounds of the leaves holding the changed objects and of
+    // every node above them, keeping the topology. Levels are refit deepest
+    // first, each split across pool when it is wide enough. Returns the
+    // updated nodes, children before parents; objects must be the list the
+    // BVH was built from.
+    std::vector<std::uint32_t> refit(SceneObjectList objects,
+                                     const std::vector<std::uint32_t>& changed, ThreadPool* pool = nullptr);
+
+    // Closest hit among objects, which must be the list the BVH was built from.
+    // Hits are ranked by distance from the ray origin to the hit point, ties go
+    // to the lower object index, matching a linear scan over objects.
+    std::optional<HitInfo> intersect(const Ray& ray, SceneObjectList objects) const;
+
+private:
+    void subdivide(std::uint32_t nodeIdx, const std::vector<AABB>& bounds);
+    // Sum of surface area times cost weight over all nodes (see sahCost()).
+    double weightedArea() const;
+    void linkNodes();
+
+    std::vector<Node> _nodes;
+    std::vector<std::uint32_t> _indices;
+    double _weightedArea = 0; // kept up to date by refit()
+    // Built by the first refit(): parent and depth per node, leaf per object,
+    // and a per-node mark that is clear between refits.
+    std::vector<std::uint32_t> _parent, _depth, _leafOf;
+    std::vector<std::uint8_t> _marked;
+};
+
+// Nodes are written to and mapped from scene caches as raw bytes.
+static_assert(std::is_trivially_copyable_v<BVH::Node> && sizeof(BVH::Node) == 32);
+
+
+namespace bvh_detail {
+
+// Closest-hit traversal over a flat node array, shared by BVH, Scene's sphere
+// store and trees used in place from a mapped scene cache. leaf(first, count,
+// best) tests entries [first, first + count) of the leaf order and merges
+// their hits into best, so a whole leaf can go to a SIMD kernel at once; the
+// winner is returned unfinished so only it pays for a full HitInfo.
+//
+// This form walks the subtree under root and merges into an existing best.
+template <typename Leaf>
+void closestLeafHit(const BVH::Node* nodes, std::uint32_t root, const Ray& ray, std::optional<PrimitiveHit>& best,
+                    Leaf&& leaf) {
+    const float origin[3] = {ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    const float invDir[3] = {1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z()};
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    const float dirLengthSq = ray.direction.lengthSquared();
+    float bestDistSq = best ? best->t * best->t * dirLengthSq * (1 + 1e-5f) : inf;
+
+    // intersect() may report points on either side of the origin, so boxes are
+    // tested against the whole line and pruned by distance to the origin.
+    std::uint32_t stack[BVH::kMaxDepth];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const BVH::Node& node = nodes[stack[--top]];
+        if (node.bounds.distanceSquared(origin) > bestDistSq) continue;
+        if (!node.bounds.intersects(origin, invDir, -inf, inf)) continue;
+
+        if (node.isLeaf()) {
+            leaf(node.leftFirst, node.count, best);
+            // Slightly loose so rounding never prunes an equally close hit.
+            if (best) bestDistSq = best->t * best->t * dirLengthSq * (1 + 1e-5f);
+            continue;
+        }
+
+        // Visit the child closer to the origin first so it can prune the other.
+        std::uint32_t nearChild = node.leftFirst;
+        std::uint32_t farChild = node.leftFirst + 1;
+        if (nodes[farChild].bounds.distanceSquared(origin) < nodes[nearChild].bounds.distanceSquared(origin)) {
+            std::swap(nearChild, farChild);
+        }
+        stack[top++] = farChild;
+        stack[top++] = nearChild;
+    }
+}
+
+template <typename Leaf>
+std::optional<PrimitiveHit> closestLeafHit(const BVH::Node* nodes, const Ray& ray, Leaf&& leaf) {
+    std::optional<PrimitiveHit> best;
+    closestLeafHit(nodes, 0, ray, best, leaf);
+    return best;
+}
+
+// Any-hit traversal for shadow and occlusion rays: whether leaf(first, count)
+// returns true for some leaf, where the callback reports a hit with
+// tMin < t < tMax among those entries. A hit point lies in its leaf's box, so
+// only boxes the line crosses for t in that range are entered; the walk
+// stops at the first hit.
+template <typename Leaf>
+bool anyLeafHit(const BVH::Node* nodes, const Ray& ray, float tMin, float tMax, Leaf&& leaf) {
+    const float origin[3] = {ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    const float invDir[3] = {1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z()};
+    // Slightly loose so rounding never prunes a box holding a counted hit.
+    const float lower = tMin - std::abs(tMin) * 1e-5f;
+    const float upper = tMax + std::abs(tMax) * 1e-5f;
+
+    std::uint32_t stack[BVH::kMaxDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVH::Node& node = nodes[stack[--top]];
+        if (!node.bounds.intersects(origin, invDir, lower, upper)) continue;
+        if (node.isLeaf()) {
+            if (leaf(node.leftFirst, node.count)) return true;
+            continue;
+        }
+        stack[top++] = node.leftFirst + 1;
+        stack[top++] = node.leftFirst;
+    }
+    return false;
+}
+
+// Below this many live rays a packet stops paying for itself, and the rays
+// left finish the subtree one at a time.
+constexpr int kMinPacketRays = 4;
+
+// closestLeafHit() for every ray of a packet at once: a node's box is tested
+// against all rays still interested in it, and the rays that enter continue
+// into the children together. Every ray is tested against the same boxes with
+// the same pruning as on its own, so best[i] ends up as closestLeafHit() would
+// return for packet.ray(i). leaf(ray, first, count, best) works like the
+// single-ray leaf callback for ray index ray.
+template <typename Leaf>
+void closestLeafHits(const BVH::Node* nodes, const RayPacket& packet, std::optional<PrimitiveHit>* best,
+                     Leaf&& leaf) {
+    float bestDistSq[RayPacket::kMaxRays];
+    float dirLengthSq[RayPacket::kMaxRays];
+    for (int i = 0; i < packet.count; i++) {
+        best[i].reset();
+        bestDistSq[i] = std::numeric_limits<float>::infinity();
+        dirLengthSq[i] = packet.ray(i).direction.lengthSquared();
+    }
+    auto updateBound = [&](int i) {
+        if (best[i]) bestDistSq[i] = best[i]->t * best[i]->t * dirLengthSq[i] * (1 + 1e-5f);
+    };
+
+    struct Entry {
+        std::uint32_t node;
+        std::uint64_t rays;
+    };
+    Entry stack[BVH::kMaxDepth];
+    int top = 0;
+    stack[top++] = {0, packet.all()};
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        const BVH::Node& node = nodes[entry.node];
+        const std::uint64_t rays = ray_packet::boxMask(node.bounds, packet, bestDistSq, entry.rays);
+        if (rays == 0) continue;
+
+        if (node.isLeaf()) {
+            for (std::uint64_t rest = rays; rest != 0; rest &= rest - 1) {
+                int i = std::countr_zero(rest);
+                leaf(i, node.leftFirst, node.count, best[i]);
+                updateBound(i);
+            }
+            continue;
+        }
+        if (std::popcount(rays) < kMinPacketRays) {
+            for (std::uint64_t rest = rays; rest != 0; rest &= rest - 1) {
+                int i = std::countr_zero(rest);
+                closestLeafHit(nodes, entry.node, packet.ray(i), best[i],
+                               [&](std::uint32_t first, std::uint32_t count, std::optional<PrimitiveHit>& closest) {
+                    leaf(i, first, count, closest);
+                });
+                updateBound(i);
+            }
+            continue;
+        }
+
+        // Order the children by the first live ray; any order gives the same hits.
+        const int lead = std::countr_zero(rays);
+        const float origin[3] = {packet.ox[lead], packet.oy[lead], packet.oz[lead]};
+        std::uint32_t nearChild = node.leftFirst;
+        std::uint32_t farChild = node.leftFirst + 1;
+        if (nodes[farChild].bounds.distanceSquared(origin) < nodes[nearChild].bounds.distanceSquared(origin)) {
+            std::swap(nearChild, farChild);
+        }
+        stack[top++] = {farChild, rays};
+        stack[top++] = {nearChild, rays};
+    }
+}
+
+// closestLeafHit() one primitive at a time: distance(idx, t) reports whether
+// primitive idx is hit and sets t.
+template <typename Distance>
+std::optional<PrimitiveHit> closestPrimitive(const BVH::Node* nodes, const std::uint32_t* indices, const Ray& ray,
+                                             Distance&& distance) {
+    return closestLeafHit(nodes, ray, [&](std::uint32_t first, std::uint32_t count, std::optional<PrimitiveHit>& best) {
+        for (std::uint32_t i = first; i < first + count; i++) {
+            PrimitiveHit hit;
+            hit.index = indices[i];
+            if (!distance(hit.index, hit.t)) continue;
+            if (!best.has_value() || hit.closerThan(*best)) best = hit;
+        }
+    });
+}
+
+}
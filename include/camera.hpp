@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vector.hpp"
+#include "trace.hpp"
 
 class Camera {
 public:
@@ -23,10 +24,8 @@ public:
     void setSizeOfLens(float s) { _sizeOfLens = s; }
 
     Vector3D getRayOrigin(int height, int width, int i, int j) const {
-        std::cout << "getRayOrigin0 " << position().toString() << orientation().toString() << std::endl;
         // Get a vector perpendicular to the orientation
         Vector3D planeNormal = orientation().cross(Vector3D{1, 0, 0}).normalize();
-        std::cout << "getRayOrigin1 " << planeNormal.toString() << std::endl;
         // Get the plane equation
         float d = -planeNormal.dot(position());
 
@@ -37,6 +36,7 @@ public:
 
         float t = (d - planeNormal.dot(v)) / (planeNormal.dot(planeNormal));
         Vector3D proj = v*_sizeOfLens + planeNormal * t;
+        TRACE(Verbose, Camera, "pixel (%d, %d) ray origin (%g, %g, %g)", i, j, proj.x(), proj.y(), proj.z());
         return proj;
     }
 
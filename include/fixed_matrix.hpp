@@ -0,0 +1,186 @@
+#pragma once
+
+#include "fixed_vector.hpp"
+#include "matrix.hpp"
+
+
+// Row-major R x C matrix with both dimensions in the type, the fixed-size
+// counterpart of MatrixND. Products only exist between matching shapes, so a
+// dimension mismatch fails to compile.
+template <typename T, std::size_t R, std::size_t C>
+class MatN {
+    static_assert(R > 0 && C > 0, "MatN needs at least one row and column");
+
+public:
+    constexpr MatN() = default;
+    // One VecN per row.
+    template <typename... Rows>
+        requires(sizeof...(Rows) == R && (std::is_same_v<Rows, VecN<T, C>> && ...))
+    constexpr MatN(const Rows&... rows) : _rows{rows...} {}
+
+    static constexpr MatN identity() requires(R == C) {
+        MatN result;
+        fixed_detail::unroll<R>([&](std::size_t i) { result._rows[i][i] = T(1); });
+        return result;
+    }
+
+    // Throws std::length_error unless mat is exactly R x C.
+    explicit MatN(const MatrixND<T>& mat) {
+        if (mat.rows() != R || mat.cols() != C) {
+            throw std::length_error("Matrix dimension mismatch.");
+        }
+        for (std::size_t i = 0; i < R; i++) {
+            fixed_detail::unroll<C>([&](std::size_t j) { _rows[i][j] = mat.get(i, j); });
+        }
+    }
+    explicit operator MatrixND<T>() const {
+        MatrixND<T> result(R, C);
+        for (std::size_t i = 0; i < R; i++) {
+            std::copy(_rows[i].data(), _rows[i].data() + C, result.rowPtr(i));
+        }
+        return result;
+    }
+
+    static constexpr std::size_t rows() { return R; }
+    static constexpr std::size_t cols() { return C; }
+    constexpr T operator()(std::size_t r, std::size_t c) const { return _rows[r][c]; }
+    constexpr T& operator()(std::size_t r, std::size_t c) { return _rows[r][c]; }
+    constexpr T get(std::size_t r, std::size_t c) const {
+        if (r >= R || c >= C) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        return _rows[r][c];
+    }
+    constexpr void set(std::size_t r, std::size_t c, T val) {
+        if (r >= R || c >= C) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        _rows[r][c] = val;
+    }
+    constexpr const VecN<T, C>& row(std::size_t r) const { return _rows[r]; }
+    constexpr VecN<T, R> col(std::size_t c) const {
+        VecN<T, R> result;
+        fixed_detail::unroll<R>([&](std::size_t i) { result[i] = _rows[i][c]; });
+        return result;
+    }
+
+    constexpr MatN add(const MatN& other) const { return zipRows(other, [](auto& a, auto& b) { return a + b; }); }
+    constexpr MatN operator+(const MatN& other) const { return add(other); }
+    constexpr MatN sub(const MatN& other) const { return zipRows(other, [](auto& a, auto& b) { return a - b; }); }
+    constexpr MatN operator-(const MatN& other) const { return sub(other); }
+    constexpr MatN mul(T scalar) const { return zipRows(*this, [&](auto& a, auto&) { return a * scalar; }); }
+    constexpr MatN operator*(T scalar) const { return mul(scalar); }
+    constexpr MatN div(T scalar) const { return zipRows(*this, [&](auto& a, auto&) { return a / scalar; }); }
+    constexpr MatN operator/(T scalar) const { return div(scalar); }
+
+    template <std::size_t K>
+    constexpr MatN<T, R, K> mul(const MatN<T, C, K>& other) const {
+        MatN<T, R, K> result;
+        fixed_detail::unroll<R>([&](std::size_t i) {
+            VecN<T, K> acc;
+            fixed_detail::unroll<C>([&](std::size_t p) { acc = acc + other.row(p) * _rows[i][p]; });
+            fixed_detail::unroll<K>([&](std::size_t j) { result(i, j) = acc[j]; });
+        });
+        return result;
+    }
+    template <std::size_t K>
+    constexpr MatN<T, R, K> operator*(const MatN<T, C, K>& other) const { return mul(other); }
+
+    // Matrix times column vector.
+    constexpr VecN<T, R> dot(const VecN<T, C>& vec) const {
+        VecN<T, R> result;
+        fixed_detail::unroll<R>([&](std::size_t i) { result[i] = _rows[i].dot(vec); });
+        return result;
+    }
+    constexpr VecN<T, R> operator*(const VecN<T, C>& vec) const { return dot(vec); }
+
+    constexpr bool operator==(const MatN& other) const {
+        bool equal = true;
+        fixed_detail::unroll<R>([&](std::size_t i) { equal = equal && _rows[i] == other._rows[i]; });
+        return equal;
+    }
+
+    constexpr MatN<T, C, R> transpose() const {
+        MatN<T, C, R> result;
+        for (std::size_t i = 0; i < R; i++) {
+            fixed_detail::unroll<C>([&](std::size_t j) { result(j, i) = _rows[i][j]; });
+        }
+        return result;
+    }
+
+    constexpr MatN<T, R - 1, C - 1> minorMat(std::size_t row, std::size_t col) const requires(R > 1 && C > 1) {
+        MatN<T, R - 1, C - 1> result;
+        for (std::size_t i = 0, ri = 0; i < R; i++) {
+            if (i == row) continue;
+            for (std::size_t j = 0, rj = 0; j < C; j++) {
+                if (j == col) continue;
+                result(ri, rj++) = _rows[i][j];
+            }
+            ri++;
+        }
+        return result;
+    }
+
+    constexpr T trace() const requires(R == C) {
+        T sum = T(0);
+        fixed_detail::unroll<R>([&](std::size_t i) { sum += _rows[i][i]; });
+        return sum;
+    }
+
+    // Cofactor expansion, unrolled per size. Exact for integers and cheap
+    // for the 2x2..4x4 transforms this type is meant for; use MatrixND::lu()
+    // for anything large.
+    constexpr T determinant() const requires(R == C) {
+        if constexpr (R == 1) {
+            return _rows[0][0];
+        } else if constexpr (R == 2) {
+            return _rows[0][0] * _rows[1][1] - _rows[0][1] * _rows[1][0];
+        } else {
+            T det = T(0);
+            fixed_detail::unroll<C>([&](std::size_t j) {
+                T term = _rows[0][j] * minorMat(0, j).determinant();
+                det += j % 2 == 0 ? term : -term;
+            });
+            return det;
+        }
+    }
+
+    constexpr MatN adjoint() const requires(R == C) {
+        if constexpr (R == 1) {
+            return identity();
+        } else {
+            MatN result;
+            for (std::size_t i = 0; i < R; i++) {
+                for (std::size_t j = 0; j < C; j++) {
+                    T minor = minorMat(i, j).determinant();
+                    result(j, i) = (i + j) % 2 == 0 ? minor : -minor;
+                }
+            }
+            return result;
+        }
+    }
+
+    // Throws std::domain_error for a singular matrix.
+    constexpr MatN inverse() const requires(R == C && std::is_floating_point_v<T>) {
+        T det = determinant();
+        if (det == T(0)) {
+            throw std::domain_error("Matrix is singular.");
+        }
+        return adjoint().div(det);
+    }
+
+private:
+    template <typename F>
+    constexpr MatN zipRows(const MatN& other, F f) const {
+        MatN result;
+        fixed_detail::unroll<R>([&](std::size_t i) { result._rows[i] = f(_rows[i], other._rows[i]); });
+        return result;
+    }
+
+    VecN<T, C> _rows[R] = {};
+};
+
+using Mat3f = MatN<float, 3, 3>;
+using Mat4f = MatN<float, 4, 4>;
+using Mat3d = MatN<double, 3, 3>;
+using Mat4d = MatN<double, 4, 4>;
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "vector.hpp"
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+
+namespace fixed_detail {
+
+// Calls f(0), f(1), ..., f(N - 1) as a fold expression, so the "loop" is
+// unrolled at compile time whatever the optimisation level.
+template <std::size_t N, typename F>
+constexpr void unroll(F&& f) {
+    [&]<std::size_t... I>(std::index_sequence<I...>) { (f(I), ...); }(std::make_index_sequence<N>{});
+}
+
+template <typename T>
+constexpr T abs(T value) { return value < T(0) ? -value : value; }
+
+}
+
+// Vector with its dimension in the type. Lives on the stack, is usable in
+// constant expressions, and mixing dimensions is a compile error instead of
+// an assert. Converts explicitly to and from VectorND (and Vector3D for
+// VecN<float, 3>) so code can move over piece by piece.
+template <typename T, std::size_t N>
+class VecN {
+    static_assert(N > 0, "VecN needs at least one component");
+
+public:
+    constexpr VecN() = default;
+    template <typename... Args>
+        requires(sizeof...(Args) == N && (std::is_convertible_v<Args, T> && ...))
+    constexpr VecN(Args... args) : _v{static_cast<T>(args)...} {}
+
+    static constexpr VecN filled(T value) {
+        VecN result;
+        fixed_detail::unroll<N>([&](std::size_t i) { result._v[i] = value; });
+        return result;
+    }
+
+    // Throws std::length_error when vec does not have exactly N components.
+    explicit VecN(const VectorND<T>& vec) {
+        if (vec.size() != N) {
+            throw std::length_error("Vector dimension mismatch.");
+        }
+        fixed_detail::unroll<N>([&](std::size_t i) { _v[i] = vec.get(i); });
+    }
+    explicit operator VectorND<T>() const {
+        return VectorND<T>(std::make_unique<VectorData<T>>(std::vector<T>(_v, _v + N)));
+    }
+    explicit VecN(const Vector3D& vec)
+        requires(std::is_same_v<T, float> && N == 3)
+        : _v{vec.x(), vec.y(), vec.z()} {}
+    explicit operator Vector3D() const
+        requires(std::is_same_v<T, float> && N == 3)
+    {
+        return Vector3D(_v[0], _v[1], _v[2]);
+    }
+
+    static constexpr std::size_t size() { return N; }
+    constexpr T operator[](std::size_t pos) const { return _v[pos]; }
+    constexpr T& operator[](std::size_t pos) { return _v[pos]; }
+    constexpr T get(std::size_t pos) const {
+        if (pos >= N) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        return _v[pos];
+    }
+    constexpr void set(std::size_t pos, T val) {
+        if (pos >= N) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        _v[pos] = val;
+    }
+    constexpr const T* data() const { return _v; }
+
+    constexpr T x() const requires(N >= 1) { return _v[0]; }
+    constexpr T y() const requires(N >= 2) { return _v[1]; }
+    constexpr T z() const requires(N >= 3) { return _v[2]; }
+    constexpr T w() const requires(N >= 4) { return _v[3]; }
+
+    std::string toString() const {
+        std::stringstream ss;
+        ss << "VecN(";
+        for (std::size_t i = 0; i < N; i++) {
+            ss << (i ? ", " : "") << _v[i];
+        }
+        ss << ")";
+        return ss.str();
+    }
+
+    constexpr VecN add(T scalar) const { return map([&](T a) { return a + scalar; }); }
+    constexpr VecN operator+(T scalar) const { return add(scalar); }
+    constexpr VecN add(const VecN& other) const { return zip(other, [](T a, T b) { return a + b; }); }
+    constexpr VecN operator+(const VecN& other) const { return add(other); }
+
+    constexpr VecN sub(T scalar) const { return map([&](T a) { return a - scalar; }); }
+    constexpr VecN operator-(T scalar) const { return sub(scalar); }
+    constexpr VecN sub(const VecN& other) const { return zip(other, [](T a, T b) { return a - b; }); }
+    constexpr VecN operator-(const VecN& other) const { return sub(other); }
+    constexpr VecN operator-() const { return map([](T a) { return -a; }); }
+
+    constexpr VecN mul(T scalar) const { return map([&](T a) { return a * scalar; }); }
+    constexpr VecN operator*(T scalar) const { return mul(scalar); }
+    // Component-wise product.
+    constexpr VecN mul(const VecN& other) const { return zip(other, [](T a, T b) { return a * b; }); }
+
+    constexpr VecN div(T scalar) const { return map([&](T a) { return a / scalar; }); }
+    constexpr VecN operator/(T scalar) const { return div(scalar); }
+
+    constexpr bool operator==(const VecN& other) const {
+        bool equal = true;
+        fixed_detail::unroll<N>([&](std::size_t i) { equal = equal && _v[i] == other._v[i]; });
+        return equal;
+    }
+
+    constexpr T dot(const VecN& other) const {
+        T sum = T(0);
+        fixed_detail::unroll<N>([&](std::size_t i) { sum += _v[i] * other._v[i]; });
+        return sum;
+    }
+    constexpr T lengthSquared() const { return dot(*this); }
+    T magnitude() const { return std::sqrt(lengthSquared()); }
+    T distance(const VecN& other) const { return sub(other).magnitude(); }
+    VecN normalize() const { return div(magnitude()); }
+
+    constexpr T l1Norm() const {
+        T sum = T(0);
+        fixed_detail::unroll<N>([&](std::size_t i) { sum += fixed_detail::abs(_v[i]); });
+        return sum;
+    }
+    constexpr T linfNorm() const {
+        T best = T(0);
+        fixed_detail::unroll<N>([&](std::size_t i) { best = std::max(best, fixed_detail::abs(_v[i])); });
+        return best;
+    }
+
+    constexpr VecN cross(const VecN& other) const requires(N == 3) {
+        return VecN(
+            _v[1] * other._v[2] - _v[2] * other._v[1],
+            _v[2] * other._v[0] - _v[0] * other._v[2],
+            _v[0] * other._v[1] - _v[1] * other._v[0]
+        );
+    }
+
+private:
+    template <typename F>
+    constexpr VecN map(F f) const {
+        VecN result;
+        fixed_detail::unroll<N>([&](std::size_t i) { result._v[i] = f(_v[i]); });
+        return result;
+    }
+    template <typename F>
+    constexpr VecN zip(const VecN& other, F f) const {
+        VecN result;
+        fixed_detail::unroll<N>([&](std::size_t i) { result._v[i] = f(_v[i], other._v[i]); });
+        return result;
+    }
+
+    T _v[N] = {};
+};
+
+template <typename T, std::size_t N>
+constexpr VecN<T, N> operator*(T scalar, const VecN<T, N>& vec) { return vec.mul(scalar); }
+
+using Vec2f = VecN<float, 2>;
+using Vec3f = VecN<float, 3>;
+using Vec4f = VecN<float, 4>;
+using Vec3d = VecN<double, 3>;
+using Vec4d = VecN<double, 4>;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+
+enum class PixelFormat {
+    RGB8,    // 3 x uint8 per pixel
+    RGBA32F, // 4 x float per pixel, linear 0..1
+};
+
+std::size_t bytesPerPixel(PixelFormat format);
+std::size_t channelCount(PixelFormat format);
+
+// Rectangular window into a Framebuffer. Tiles cut from one framebuffer at
+// disjoint rectangles can be written from different threads without locking.
+class FramebufferTile {
+public:
+    FramebufferTile(std::uint8_t* origin, std::size_t stride, PixelFormat format, int x0, int y0, int width, int height)
+        : _origin(origin), _stride(stride), _format(format), _x0(x0), _y0(y0), _width(width), _height(height) {}
+
+    int x0() const { return _x0; }
+    int y0() const { return _y0; }
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    // x and y are relative to the tile's top-left corner.
+    void setPixel(int x, int y, const std::array<std::uint8_t, 3>& rgb);
+    void setPixel(int x, int y, const std::array<float, 4>& rgba);
+
+private:
+    std::uint8_t* pixel(int x, int y) const { return _origin + y * _stride + x * bytesPerPixel(_format); }
+
+    std::uint8_t* _origin;
+    std::size_t _stride;
+    PixelFormat _format;
+    int _x0, _y0, _width, _height;
+};
+
+// One contiguous, 64-byte aligned image buffer. Rows are padded to a multiple
+// of 64 bytes, so every row starts on a cache line and stride() may be larger
+// than width() * bytesPerPixel(). The memory can be handed to OpenCV without
+// copying (see framebuffer_cv.hpp) or to an image encoder row by row.
+class Framebuffer {
+public:
+    static constexpr std::size_t kAlignment = 64;
+
+    explicit Framebuffer(int width = 0, int height = 0, PixelFormat format = PixelFormat::RGB8,
+                         std::pmr::memory_resource* resource = std::pmr::new_delete_resource());
+    Framebuffer(Framebuffer&&) noexcept = default;
+    Framebuffer& operator=(Framebuffer&&) noexcept = default;
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    PixelFormat format() const { return _format; }
+    // Bytes between the starts of consecutive rows.
+    std::size_t stride() const { return _stride; }
+    std::size_t byteSize() const { return _stride * _height; }
+
+    std::uint8_t* data() { return _pixels.get(); }
+    const std::uint8_t* data() const { return _pixels.get(); }
+    std::uint8_t* row(int y) { return data() + y * _stride; }
+    const std::uint8_t* row(int y) const { return data() + y * _stride; }
+
+    // Reallocates only when the size or format changes. Contents are unspecified afterwards.
+    void resize(int width, int height, PixelFormat format);
+    void resize(int width, int height) { resize(width, height, _format); }
+    // Zeroes every pixel, padding included.
+    void clear();
+
+    // Window over [x0, x0 + width) x [y0, y0 + height), clipped to the image.
+    FramebufferTile tile(int x0, int y0, int width, int height);
+
+    void setPixel(int x, int y, const std::array<std::uint8_t, 3>& rgb) { tile(x, y, 1, 1).setPixel(0, 0, rgb); }
+    // The pixel converted to 8-bit RGB; float channels are clamped to 0..1.
+    std::array<std::uint8_t, 3> pixelRGB8(int x, int y) const;
+    // The pixel as floats; 8-bit channels are scaled to 0..1 with alpha 1.
+    std::array<float, 4> pixelRGBA32F(int x, int y) const;
+
+private:
+    struct Deleter {
+        std::pmr::memory_resource* resource = nullptr;
+        std::size_t bytes = 0;
+        void operator()(std::uint8_t* ptr) const { resource->deallocate(ptr, bytes, kAlignment); }
+    };
+
+    int _width = 0;
+    int _height = 0;
+    PixelFormat _format = PixelFormat::RGB8;
+    std::size_t _stride = 0;
+    std::pmr::memory_resource* _resource;
+    std::unique_ptr<std::uint8_t[], Deleter> _pixels;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include <opencv2/core.hpp>
+
+
+// cv::Mat header over the framebuffer's memory; nothing is copied, so the
+// Mat is only valid while the framebuffer is alive and not resized. Channels
+// keep their stored order, which OpenCV's display and I/O functions read as BGR.
+inline cv::Mat asMat(Framebuffer& frame) {
+    int type = frame.format() == PixelFormat::RGB8 ? CV_8UC3 : CV_32FC4;
+    return cv::Mat(frame.height(), frame.width(), type, frame.data(), frame.stride());
+}
+
+inline const cv::Mat asMat(const Framebuffer& frame) {
+    return asMat(const_cast<Framebuffer&>(frame));
+}
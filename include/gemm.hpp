@@ -0,0 +1,162 @@
+#pragma once
+
+#include "arena.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+
+
+// General matrix multiply, C += A * B, for row-major A (m x k), B (k x n) and
+// C (m x n) with leading dimensions lda, ldb and ldc.
+//
+// The driver follows the usual Goto/BLIS layering: B is packed in KC x NC
+// blocks (sized for L3) into NR-wide column panels, A in MC x KC blocks
+// (sized for L2) into MR-tall row panels, and an MR x NR microkernel
+// multiplies one panel pair while the B panel stays in L1. float and double
+// pick an AVX2/FMA microkernel at runtime when the CPU has it.
+
+enum class GemmKernel { Scalar, AVX2 };
+
+// Best kernel this CPU supports, detected once with cpuid.
+GemmKernel detectGemmKernel();
+const char* gemmKernelName(GemmKernel kernel);
+
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+          const float* a, std::size_t lda, const float* b, std::size_t ldb, float* c, std::size_t ldc,
+          GemmKernel kernel = detectGemmKernel());
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+          const double* a, std::size_t lda, const double* b, std::size_t ldb, double* c, std::size_t ldc,
+          GemmKernel kernel = detectGemmKernel());
+
+
+namespace gemm_detail {
+
+constexpr std::size_t kKC = 256;
+constexpr std::size_t kMC = 120;
+constexpr std::size_t kNC = 2048;
+constexpr std::size_t kPanelAlignment = 64;
+
+template <typename T>
+struct AlignedDelete {
+    std::pmr::memory_resource* resource = nullptr;
+    std::size_t bytes = 0;
+    void operator()(T* ptr) const { resource->deallocate(ptr, bytes, kPanelAlignment); }
+};
+template <typename T>
+using PanelBuffer = std::unique_ptr<T[], AlignedDelete<T>>;
+
+// Packing scratch comes from the thread's math resource, like the matrices.
+template <typename T>
+PanelBuffer<T> allocatePanel(std::size_t count) {
+    std::pmr::memory_resource* resource = currentMathResource();
+    return PanelBuffer<T>(static_cast<T*>(resource->allocate(count * sizeof(T), kPanelAlignment)),
+                          AlignedDelete<T>{resource, count * sizeof(T)});
+}
+
+// MR-tall row panels of an mc x kc block of A, k-major inside each panel and
+// zero-padded past the last row.
+template <typename T, std::size_t MR>
+void packA(std::size_t mc, std::size_t kc, const T* a, std::size_t lda, T* packed) {
+    for (std::size_t i = 0; i < mc; i += MR) {
+        std::size_t rows = std::min(MR, mc - i);
+        for (std::size_t p = 0; p < kc; p++) {
+            for (std::size_t r = 0; r < MR; r++) {
+                *packed++ = r < rows ? a[(i + r) * lda + p] : T(0);
+            }
+        }
+    }
+}
+
+// NR-wide column panels of a kc x nc block of B, zero-padded past the last column.
+template <typename T, std::size_t NR>
+void packB(std::size_t kc, std::size_t nc, const T* b, std::size_t ldb, T* packed) {
+    for (std::size_t j = 0; j < nc; j += NR) {
+        std::size_t cols = std::min(NR, nc - j);
+        for (std::size_t p = 0; p < kc; p++) {
+            const T* src = b + p * ldb + j;
+            for (std::size_t c = 0; c < NR; c++) {
+                *packed++ = c < cols ? src[c] : T(0);
+            }
+        }
+    }
+}
+
+// C[MR x NR] += A panel * B panel.
+template <typename T, std::size_t MR, std::size_t NR>
+void scalarKernel(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc) {
+    T acc[MR][NR] = {};
+    for (std::size_t p = 0; p < kc; p++) {
+        for (std::size_t r = 0; r < MR; r++) {
+            T ar = a[p * MR + r];
+            for (std::size_t col = 0; col < NR; col++) {
+                acc[r][col] += ar * b[p * NR + col];
+            }
+        }
+    }
+    for (std::size_t r = 0; r < MR; r++) {
+        for (std::size_t col = 0; col < NR; col++) {
+            c[r * ldc + col] += acc[r][col];
+        }
+    }
+}
+
+template <typename T, std::size_t MR, std::size_t NR, typename Kernel>
+void blockedGemm(std::size_t m, std::size_t n, std::size_t k,
+                 const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                 Kernel kernel) {
+    if (m == 0 || n == 0 || k == 0) return;
+
+    const std::size_t kcMax = std::min(kKC, k);
+    const std::size_t mcMax = std::min(kMC, (m + MR - 1) / MR * MR);
+    const std::size_t ncMax = std::min(kNC, (n + NR - 1) / NR * NR);
+    PanelBuffer<T> packedA = allocatePanel<T>(mcMax * kcMax);
+    PanelBuffer<T> packedB = allocatePanel<T>(kcMax * ncMax);
+    T edge[MR * NR];
+
+    for (std::size_t jc = 0; jc < n; jc += kNC) {
+        std::size_t nc = std::min(kNC, n - jc);
+        for (std::size_t pc = 0; pc < k; pc += kKC) {
+            std::size_t kc = std::min(kKC, k - pc);
+            packB<T, NR>(kc, nc, b + pc * ldb + jc, ldb, packedB.get());
+
+            for (std::size_t ic = 0; ic < m; ic += kMC) {
+                std::size_t mc = std::min(kMC, m - ic);
+                packA<T, MR>(mc, kc, a + ic * lda + pc, lda, packedA.get());
+
+                for (std::size_t jr = 0; jr < nc; jr += NR) {
+                    std::size_t nr = std::min(NR, nc - jr);
+                    const T* bPanel = packedB.get() + jr * kc;
+                    for (std::size_t ir = 0; ir < mc; ir += MR) {
+                        std::size_t mr = std::min(MR, mc - ir);
+                        const T* aPanel = packedA.get() + ir * kc;
+                        T* cTile = c + (ic + ir) * ldc + jc + jr;
+                        if (mr == MR && nr == NR) {
+                            kernel(kc, aPanel, bPanel, cTile, ldc);
+                            continue;
+                        }
+                        // Edge tile: run the full kernel into scratch, keep the valid part.
+                        std::fill(edge, edge + MR * NR, T(0));
+                        kernel(kc, aPanel, bPanel, edge, NR);
+                        for (std::size_t r = 0; r < mr; r++) {
+                            for (std::size_t col = 0; col < nr; col++) {
+                                cTile[r * ldc + col] += edge[r * NR + col];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
+
+// Any other element type (e.g. the integer matrices) uses the same blocking
+// with the portable microkernel.
+template <typename T>
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+          const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc) {
+    gemm_detail::blockedGemm<T, 4, 8>(m, n, k, a, lda, b, ldb, c, ldc, gemm_detail::scalarKernel<T, 4, 8>);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Image files the headless renderer can produce without any image library:
+// PNG (8-bit RGB, uncompressed deflate), binary PPM (P6) and PFM (float RGB).
+enum class ImageFormat { PNG, PPM, PFM };
+
+// Picks the format from the file extension; throws std::invalid_argument for
+// anything else.
+ImageFormat imageFormatFromPath(const std::string& path);
+const char* imageFormatName(ImageFormat format);
+// Framebuffer format that holds the image without loss: RGBA32F for PFM, RGB8 otherwise.
+PixelFormat pixelFormatFor(ImageFormat format);
+
+// Encodes frame into memory. Float pixels are clamped for the 8-bit formats,
+// 8-bit pixels are scaled to 0..1 for PFM.
+std::vector<std::uint8_t> encodeImage(const Framebuffer& frame, ImageFormat format);
+// Encodes and writes frame; throws std::runtime_error if the file cannot be written.
+void writeImage(const Framebuffer& frame, const std::string& path, ImageFormat format);
+void writeImage(const Framebuffer& frame, const std::string& path);
+
+
+// Encodes and writes images on a background thread so the next frame can
+// render meanwhile. Finished framebuffers are kept and handed back through
+// recycle(), so a batch reuses the same few allocations for every frame.
+class AsyncImageWriter {
+public:
+    // submit() blocks while maxPending images are waiting to be written.
+    explicit AsyncImageWriter(std::size_t maxPending = 2);
+    // Writes everything still queued before returning.
+    ~AsyncImageWriter();
+
+    AsyncImageWriter(const AsyncImageWriter&) = delete;
+    AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+    void submit(Framebuffer frame, std::string path, ImageFormat format);
+    // A framebuffer the writer is done with, or an empty one.
+    Framebuffer recycle();
+    // Blocks until every submitted image is written; rethrows the first write error.
+    void wait();
+    // Rethrows the first write error so far, without waiting.
+    void check();
+
+    std::size_t written() const;
+    // Time the writer thread spent encoding and writing.
+    double busySeconds() const;
+
+private:
+    struct Job {
+        Framebuffer frame;
+        std::string path;
+        ImageFormat format;
+    };
+
+    void writerLoop();
+
+    const std::size_t _maxPending;
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _progress;
+    std::deque<Job> _queue;
+    std::vector<Framebuffer> _free;
+    bool _busy = false;
+    bool _stop = false;
+    std::size_t _written = 0;
+    double _busySeconds = 0;
+    std::exception_ptr _error;
+    std::thread _thread;
+};
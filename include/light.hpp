@@ -0,0 +1,50 @@
+#pragma once
+
+#include "vector.hpp"
+#include <cstdint>
+#include <type_traits>
+
+
+// Lights that shading samples directly: each shaded point picks one
+// direction toward the light and casts one occlusion ray along it, instead
+// of hoping its bounce ray happens to hit a Light sphere.
+//
+// Intensity is radiant intensity for point lights (irradiance falls off as
+// intensity / d^2), irradiance for directional lights, and for sphere lights
+// is spread over the surface so that from far away a sphere light looks like
+// a point light of the same intensity. Colours scale the intensity per channel.
+enum class LightType : std::uint32_t { Point, Directional, Sphere };
+
+// One sample of a light as seen from a shaded point.
+struct LightSample {
+    Vector3D direction;  // unit length, from the point toward the light
+    float distance = 0;  // to the sampled point on the light; infinity for directional lights
+    float weight[3] = {0, 0, 0}; // irradiance estimate per channel, before the n.l cosine
+};
+
+// Plain value type, stored in a flat array in Scene and raw in scene caches.
+struct AnalyticLight {
+    LightType type = LightType::Point;
+    float position[3] = {0, 0, 0};  // point and sphere lights
+    float direction[3] = {0, -1, 0}; // directional lights: the way the light travels, unit length
+    float radius = 0;               // sphere lights
+    float color[3] = {1, 1, 1};
+    float intensity = 1;
+
+    static AnalyticLight point(const Vector3D& position, float r, float g, float b, float intensity);
+    // direction is normalized here.
+    static AnalyticLight directional(const Vector3D& direction, float r, float g, float b, float intensity);
+    static AnalyticLight sphere(const Vector3D& center, float radius, float r, float g, float b, float intensity);
+
+    // Samples the light from p. u and v in [0, 1) pick the point on a sphere
+    // light, uniformly over the cone of directions it covers (or over all
+    // directions when p is inside it); the other types ignore them.
+    LightSample sample(const Vector3D& p, float u, float v) const;
+
+    bool operator==(const AnalyticLight&) const = default;
+};
+
+static_assert(std::is_trivially_copyable_v<AnalyticLight> && sizeof(AnalyticLight) == 48,
+              "AnalyticLight is stored raw in scene caches");
+
+const char* lightTypeName(LightType type);
@@ -1,184 +1,419 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include "vector.hpp"
+#include "gemm.hpp"
 
 
+template <typename T>
+class LUDecomposition;
+
+// Row-major matrix stored in one contiguous, cache-line aligned block. Rows
+// are ld() elements apart; ld() rounds cols() up to a whole number of cache
+// lines so every row starts aligned, and the padding is never read.
 template <typename T>
 class MatrixND {
 public:
-    MatrixND(std::size_t rows) { _data = std::vector<VectorND<T>>(rows); }
-    MatrixND(std::vector<VectorND<T>> data): _data(data) {}
+    static constexpr std::size_t kAlignment = 64;
 
-    std::size_t rows() const { return _data.size(); }
-    std::size_t cols() const { if(rows() > 0) return _data[0].size(); return 0; }
-    const VectorND<T>& get(std::size_t row) const { return _data[row]; }
-    T get(std::size_t row, std::size_t col) const { return get(row).get(col); }
-    void set(std::size_t row, std::size_t col, T val) { _data[row].set(col, val); }
-    void set(std::size_t row, const VectorND<T>& vec) { _data[row] = vec; }
-
-    MatrixND add(T scalar) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) + scalar);
+    // Storage comes from resource, by default the thread's currentMathResource().
+    explicit MatrixND(std::size_t rows, std::size_t cols = 0,
+                      std::pmr::memory_resource* resource = currentMathResource())
+        : _resource(resource) {
+        allocate(rows, cols);
+    }
+    MatrixND(std::vector<VectorND<T>> data) {
+        allocate(data.size(), data.empty() ? 0 : data[0].size());
+        for (std::size_t i = 0; i < rows(); i++) {
+            set(i, data[i]);
         }
-        return MatrixND(vecs);
     }
-    MatrixND operator+(T scalar) const { return add(scalar); };
-    MatrixND add(const VectorND<T>& other) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) + other);
+
+    MatrixND(const MatrixND& other) {
+        allocate(other.rows(), other.cols());
+        std::copy(other._data.get(), other._data.get() + _rows * _ld, _data.get());
+    }
+    MatrixND& operator=(const MatrixND& other) {
+        if (this != &other) {
+            allocate(other.rows(), other.cols());
+            std::copy(other._data.get(), other._data.get() + _rows * _ld, _data.get());
         }
-        return MatrixND(vecs);
+        return *this;
     }
-    MatrixND operator+(const VectorND<T>& other) const { return add(other); };
-    MatrixND add(const MatrixND& other) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) + other.get(i));
+    // A moved-from matrix is 0 x 0, as it was when storage was a std::vector.
+    MatrixND(MatrixND&& other) noexcept
+        : _resource(other._resource), _data(std::move(other._data)), _rows(std::exchange(other._rows, 0)),
+          _cols(std::exchange(other._cols, 0)), _ld(std::exchange(other._ld, 0)) {}
+    MatrixND& operator=(MatrixND&& other) noexcept {
+        if (this != &other) {
+            _rows = std::exchange(other._rows, 0);
+            _cols = std::exchange(other._cols, 0);
+            _ld = std::exchange(other._ld, 0);
+            _resource = other._resource;
+            _data = std::move(other._data);
         }
-        return MatrixND(vecs);
+        return *this;
     }
-    MatrixND operator+(const MatrixND& other) const { return add(other); };
 
-    MatrixND sub(T scalar) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) - scalar);
+    std::size_t rows() const { return _rows; }
+    std::size_t cols() const { return _cols; }
+    std::size_t ld() const { return _ld; }
+    std::pmr::memory_resource* resource() const { return _resource; }
+    T* data() { return _data.get(); }
+    const T* data() const { return _data.get(); }
+    T* rowPtr(std::size_t row) { return _data.get() + row * _ld; }
+    const T* rowPtr(std::size_t row) const { return _data.get() + row * _ld; }
+
+    // Zero-copy view of a row: the VectorND borrows the matrix storage, so it
+    // must not outlive the matrix, and writes through it land in the matrix.
+    VectorND<T> row(std::size_t row) {
+        return VectorND<T>(std::make_unique<VectorData<T>>(VectorData<T>::borrow(rowPtr(row), _cols)));
+    }
+    const VectorND<T> get(std::size_t row) const {
+        return VectorND<T>(std::make_unique<VectorData<T>>(VectorData<T>::borrow(const_cast<T*>(rowPtr(row)), _cols)));
+    }
+    // Non-owning views; a column view steps ld() elements per row.
+    VectorDataView<T> rowView(std::size_t row) { return VectorDataView<T>(rowPtr(row), _cols); }
+    VectorDataView<const T> rowView(std::size_t row) const { return VectorDataView<const T>(rowPtr(row), _cols); }
+    VectorDataView<T> colView(std::size_t col) { return VectorDataView<T>(data() + col, _rows, _ld); }
+    VectorDataView<const T> colView(std::size_t col) const { return VectorDataView<const T>(data() + col, _rows, _ld); }
+    T get(std::size_t row, std::size_t col) const { return rowPtr(row)[col]; }
+    void set(std::size_t row, std::size_t col, T val) { rowPtr(row)[col] = val; }
+    void set(std::size_t row, const VectorND<T>& vec) {
+        if (_cols == 0 && _rows > 0) {
+            // A matrix created with only a row count takes its width from the first row set.
+            allocate(_rows, vec.size());
+        }
+        assert(vec.size() == _cols);
+        T* dst = rowPtr(row);
+        for (std::size_t j = 0; j < _cols; j++) {
+            dst[j] = vec.get(j);
         }
-        return MatrixND(vecs);
     }
+
+    MatrixND add(T scalar) const { return map([scalar](T a) { return a + scalar; }); }
+    MatrixND operator+(T scalar) const { return add(scalar); };
+    MatrixND add(const VectorND<T>& other) const {
+        assert(other.size() == cols());
+        return mapRows(other, [](T a, T b) { return a + b; });
+    }
+    MatrixND operator+(const VectorND<T>& other) const { return add(other); };
+    MatrixND add(const MatrixND& other) const { return zip(other, [](T a, T b) { return a + b; }); }
+    MatrixND operator+(const MatrixND& other) const { return add(other); };
+
+    MatrixND sub(T scalar) const { return map([scalar](T a) { return a - scalar; }); }
     MatrixND operator-(T scalar) const { return sub(scalar); };
     MatrixND sub(const VectorND<T>& other) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) - other);
-        }
-        return MatrixND(vecs);
+        assert(other.size() == cols());
+        return mapRows(other, [](T a, T b) { return a - b; });
     }
     MatrixND operator-(const VectorND<T>& other) const { return sub(other); };
-    MatrixND sub(const MatrixND& other) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) - other.get(i));
-        }
-        return MatrixND(vecs);
-    }
+    MatrixND sub(const MatrixND& other) const { return zip(other, [](T a, T b) { return a - b; }); }
     MatrixND operator-(const MatrixND& other) const { return sub(other); };
 
-    MatrixND mul(T scalar) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) * scalar);
-        }
-        return MatrixND(vecs);
-    }
+    MatrixND mul(T scalar) const { return map([scalar](T a) { return a * scalar; }); }
     MatrixND operator*(T scalar) const { return mul(scalar); };
-    MatrixND div(T scalar) const {
-        std::vector<VectorND<T>> vecs;
-        for (size_t i = 0; i < rows(); i++) {
-            vecs.push_back(get(i) / scalar);
-        }
-        return MatrixND(vecs);
-    }
+    MatrixND div(T scalar) const { return map([scalar](T a) { return a / scalar; }); }
     MatrixND operator/(T scalar) const { return div(scalar); };
 
     VectorND<T> dot(const VectorND<T>& other) const {
-        assert(rows() == other.rows());
-        auto data = std::make_unique<VectorData<T>>(new unsigned char[rows()*sizeof(T)], rows());
-        for(size_t idx = 0; idx < rows(); idx++) {
-            data->set(idx, get(idx).dot(other));
+        assert(cols() == other.size());
+        auto data = std::make_unique<VectorData<T>>(rows());
+        VectorDataView<const T> vec = other.vectorData().view();
+        for (std::size_t i = 0; i < rows(); i++) {
+            data->set(i, rowView(i).dot(vec));
         }
-        return VectorND<T>(data);
+        return VectorND<T>(std::move(data));
     }
     MatrixND mul(const MatrixND& other) const {
-        assert(rows() == other.rows());
-        std::vector<VectorND<T>> vecs;
-        MatrixND other_t = other.transpose();
-        for (std::size_t i = 0; i < rows(); i++) {
-            auto data = std::make_unique<VectorData<T>>(new unsigned char[rows()*sizeof(T)], rows());
-            for (std::size_t j = 0; j < rows(); j++) {
-                data->set(j, _data[i].dot(other_t.get(j)));
-            }
-            vecs.push_back(VectorND<T>(std::move(data)));
-        }
-        return MatrixND(vecs);
+        assert(cols() == other.rows());
+        MatrixND result(rows(), other.cols());
+        gemm(rows(), other.cols(), cols(), data(), ld(), other.data(), other.ld(), result.data(), result.ld());
+        return result;
     }
     MatrixND operator*(const MatrixND& other) const {return mul(other);};
 
     MatrixND transpose() const {
-        assert(rows() == cols());
-        std::vector<VectorND<T>> vecs;
-        for(std::size_t i = 0; i < 3; i++) {
-            auto data = std::make_unique<VectorData<T>>(new unsigned char[rows()*sizeof(T)], rows());
-            for (std::size_t j = 0; j < rows(); j++) {
-                data->set(j, get(j).get(i));
+        MatrixND result(cols(), rows());
+        for (std::size_t i = 0; i < rows(); i++) {
+            const T* src = rowPtr(i);
+            for (std::size_t j = 0; j < cols(); j++) {
+                result.rowPtr(j)[i] = src[j];
             }
-            vecs.push_back(VectorND<T>(std::move(data)));
         }
-        return MatrixND(vecs);
+        return result;
     }
     MatrixND minorMat(size_t row, size_t col) const {
-        std::size_t height = rows()-1;
-        std::vector<VectorND<T>> vecs;
-        for (std::size_t i = 0; i < height; i++) {
-            std::size_t _i = i;
-            if (i >= row) _i++;
-            auto data = std::make_unique<VectorData<T>>(new unsigned char[(height)*sizeof(T)], height);
-            for (std::size_t j = 0; j < height; j++) {
-                std::size_t _j = j;
-                if (j >= col) _j++;
-                data->set(j, get(_i).get(_j));
-            }
-            vecs.push_back(VectorND<T>(std::move(data)));
+        MatrixND result(rows() - 1, cols() - 1);
+        for (std::size_t i = 0; i < result.rows(); i++) {
+            const T* src = rowPtr(i < row ? i : i + 1);
+            T* dst = result.rowPtr(i);
+            std::copy(src, src + col, dst);
+            std::copy(src + col + 1, src + cols(), dst + col);
         }
-        return MatrixND<T>(vecs);
-    }
-    T determinant() const {
-        // Use Laplace's formula to calculate
-        assert(rows() == cols());
-
-        // Base case
-        if (rows() == 2) {
-            // 2x2 matrix, can hardcode the formula
-            return _data[0].get(0) * _data[1].get(1) - _data[1].get(0) * _data[0].get(1);
-        }
-
-        // Recursion
-        T total = 0;
-        for (std::size_t col = 0; col < rows(); col++) {
-            MatrixND<T> subMatrix = minorMat(0, col);
-            std::int8_t sign = pow(-1, col % 2);
-            T subDet = subMatrix.determinant();
-            total += sign * get(0).get(col) * subDet;
-        }
-        return total;
+        return result;
     }
+    // LU factorisation with partial pivoting. Keep the result to reuse one
+    // factorisation for a determinant and several solves.
+    LUDecomposition<T> lu() const;
+    T determinant() const;
     MatrixND cofactor() const {
-        std::vector<VectorND<T>> vecs;
+        MatrixND result(rows(), cols());
         for(size_t i = 0; i < rows(); i++) {
-            auto data = std::make_unique<VectorData<T>>(new unsigned char[(rows())*sizeof(T)], rows());
-            for (size_t j = 0; j < rows(); j++) {
-                data->set(j, minorMat(i, j).determinant());
+            for (size_t j = 0; j < cols(); j++) {
+                T minor = minorMat(i, j).determinant();
+                result.set(i, j, (i + j) % 2 == 0 ? minor : -minor);
             }
-            vecs.push_back(VectorND<T>(std::move(data)));
         }
-        return MatrixND(vecs);
+        return result;
     }
     MatrixND adjoint() const { return cofactor().transpose(); };
-    MatrixND inverse() const { return adjoint() / determinant(); };
+    MatrixND inverse() const;
+    // x with A x = b, without forming the inverse.
+    VectorND<T> solve(const VectorND<T>& b) const;
+    MatrixND solve(const MatrixND& b) const;
 
-    bool isSquare() const { return rows() == 3; }
+    bool isSquare() const { return rows() == cols(); }
     T trace() const {
         T sum = 0;
         for(size_t i = 0; i < rows(); i++) {
-            sum += _data[i].get(i);
+            sum += get(i, i);
         }
         return sum;
     }
     MatrixND normalize() const { return div(determinant()); }
 
+    // Element-wise conversion to another element type.
+    template <typename U>
+    MatrixND<U> as() const {
+        MatrixND<U> result(rows(), cols());
+        for (std::size_t i = 0; i < rows(); i++) {
+            std::copy(rowPtr(i), rowPtr(i) + cols(), result.rowPtr(i));
+        }
+        return result;
+    }
+
+private:
+    struct AlignedDelete {
+        std::pmr::memory_resource* resource = nullptr;
+        std::size_t bytes = 0;
+        void operator()(T* ptr) const { resource->deallocate(ptr, bytes, kAlignment); }
+    };
+
+    void allocate(std::size_t rows, std::size_t cols) {
+        std::size_t perLine = kAlignment % sizeof(T) == 0 ? kAlignment / sizeof(T) : 1;
+        _rows = rows;
+        _cols = cols;
+        _ld = (cols + perLine - 1) / perLine * perLine;
+        std::size_t count = std::max<std::size_t>(_rows * _ld, 1);
+        _data = std::unique_ptr<T[], AlignedDelete>(static_cast<T*>(_resource->allocate(count * sizeof(T), kAlignment)),
+                                                    AlignedDelete{_resource, count * sizeof(T)});
+        std::fill(_data.get(), _data.get() + count, T(0));
+    }
+
+    template <typename F>
+    MatrixND map(F op) const {
+        MatrixND result(rows(), cols());
+        for (std::size_t i = 0; i < rows(); i++) {
+            const T* src = rowPtr(i);
+            T* dst = result.rowPtr(i);
+            for (std::size_t j = 0; j < cols(); j++) {
+                dst[j] = op(src[j]);
+            }
+        }
+        return result;
+    }
+    template <typename F>
+    MatrixND zip(const MatrixND& other, F op) const {
+        assert(rows() == other.rows() && cols() == other.cols());
+        MatrixND result(rows(), cols());
+        for (std::size_t i = 0; i < rows(); i++) {
+            const T* a = rowPtr(i);
+            const T* b = other.rowPtr(i);
+            T* dst = result.rowPtr(i);
+            for (std::size_t j = 0; j < cols(); j++) {
+                dst[j] = op(a[j], b[j]);
+            }
+        }
+        return result;
+    }
+    // Applies op(element, vec[col]) to every row.
+    template <typename F>
+    MatrixND mapRows(const VectorND<T>& vec, F op) const {
+        MatrixND result(rows(), cols());
+        for (std::size_t i = 0; i < rows(); i++) {
+            const T* src = rowPtr(i);
+            T* dst = result.rowPtr(i);
+            for (std::size_t j = 0; j < cols(); j++) {
+                dst[j] = op(src[j], vec.get(j));
+            }
+        }
+        return result;
+    }
+
+    std::pmr::memory_resource* _resource = currentMathResource();
+    std::unique_ptr<T[], AlignedDelete> _data;
+    std::size_t _rows = 0;
+    std::size_t _cols = 0;
+    std::size_t _ld = 0;
+};
+
+
+// P A = L U with partial pivoting, packed into one matrix: U on and above the
+// diagonal, the unit lower triangle of L below it. Factorising costs O(n^3);
+// each solve afterwards is O(n^2) per right-hand side.
+template <typename T>
+class LUDecomposition {
+public:
+    // Integer matrices are factorised in double.
+    using Real = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+    explicit LUDecomposition(const MatrixND<T>& a) : _lu(a.template as<Real>()), _perm(a.rows()) {
+        assert(a.isSquare());
+        std::iota(_perm.begin(), _perm.end(), 0);
+        const std::size_t n = size();
+        for (std::size_t k = 0; k < n; k++) {
+            std::size_t pivotRow = k;
+            for (std::size_t i = k + 1; i < n; i++) {
+                if (std::abs(_lu.get(i, k)) > std::abs(_lu.get(pivotRow, k))) pivotRow = i;
+            }
+            if (_lu.get(pivotRow, k) == Real(0)) {
+                _singular = true;
+                continue;
+            }
+            if (pivotRow != k) {
+                std::swap_ranges(_lu.rowPtr(k), _lu.rowPtr(k) + n, _lu.rowPtr(pivotRow));
+                std::swap(_perm[k], _perm[pivotRow]);
+                _sign = -_sign;
+            }
+
+            const Real* rowK = _lu.rowPtr(k);
+            for (std::size_t i = k + 1; i < n; i++) {
+                Real* rowI = _lu.rowPtr(i);
+                Real l = rowI[k] / rowK[k];
+                rowI[k] = l;
+                for (std::size_t j = k + 1; j < n; j++) {
+                    rowI[j] -= l * rowK[j];
+                }
+            }
+        }
+    }
+
+    std::size_t size() const { return _lu.rows(); }
+    bool singular() const { return _singular; }
+    const MatrixND<Real>& factors() const { return _lu; }
+    // Row i of P A is row permutation()[i] of A.
+    const std::vector<std::size_t>& permutation() const { return _perm; }
+
+    Real determinant() const {
+        if (_singular) return 0;
+        Real det = _sign;
+        for (std::size_t i = 0; i < size(); i++) {
+            det *= _lu.get(i, i);
+        }
+        return det;
+    }
+
+    VectorND<Real> solve(const VectorND<T>& b) const {
+        assert(b.size() == size());
+        MatrixND<Real> x(size(), 1);
+        for (std::size_t i = 0; i < size(); i++) {
+            x.set(i, 0, b.get(_perm[i]));
+        }
+        substitute(x);
+        auto data = std::make_unique<VectorData<Real>>(size());
+        for (std::size_t i = 0; i < size(); i++) {
+            data->set(i, x.get(i, 0));
+        }
+        return VectorND<Real>(std::move(data));
+    }
+
+    MatrixND<Real> solve(const MatrixND<T>& b) const {
+        assert(b.rows() == size());
+        MatrixND<Real> x(b.rows(), b.cols());
+        for (std::size_t i = 0; i < size(); i++) {
+            std::copy(b.rowPtr(_perm[i]), b.rowPtr(_perm[i]) + b.cols(), x.rowPtr(i));
+        }
+        substitute(x);
+        return x;
+    }
+
+    MatrixND<Real> inverse() const {
+        MatrixND<T> identity(size(), size());
+        for (std::size_t i = 0; i < size(); i++) {
+            identity.set(i, i, T(1));
+        }
+        return solve(identity);
+    }
+
 private:
-    std::vector<VectorND<T>> _data;
+    // Forward then back substitution on already permuted right-hand sides,
+    // done as whole-row updates so the inner loops stream contiguous memory.
+    void substitute(MatrixND<Real>& x) const {
+        if (_singular) {
+            throw std::domain_error("Matrix is singular.");
+        }
+        const std::size_t n = size();
+        const std::size_t cols = x.cols();
+        for (std::size_t i = 0; i < n; i++) {
+            Real* xi = x.rowPtr(i);
+            for (std::size_t k = 0; k < i; k++) {
+                Real l = _lu.get(i, k);
+                const Real* xk = x.rowPtr(k);
+                for (std::size_t j = 0; j < cols; j++) xi[j] -= l * xk[j];
+            }
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            Real* xi = x.rowPtr(i);
+            for (std::size_t k = i + 1; k < n; k++) {
+                Real u = _lu.get(i, k);
+                const Real* xk = x.rowPtr(k);
+                for (std::size_t j = 0; j < cols; j++) xi[j] -= u * xk[j];
+            }
+            Real pivot = _lu.get(i, i);
+            for (std::size_t j = 0; j < cols; j++) xi[j] /= pivot;
+        }
+    }
+
+    MatrixND<Real> _lu;
+    std::vector<std::size_t> _perm;
+    int _sign = 1;
+    bool _singular = false;
 };
+
+template <typename T>
+LUDecomposition<T> MatrixND<T>::lu() const { return LUDecomposition<T>(*this); }
+
+template <typename T>
+T MatrixND<T>::determinant() const {
+    assert(isSquare());
+    auto det = lu().determinant();
+    if constexpr (std::is_integral_v<T>) {
+        // Integer determinants are exact; only rounding error needs removing.
+        return static_cast<T>(std::llround(det));
+    } else {
+        return det;
+    }
+}
+
+template <typename T>
+MatrixND<T> MatrixND<T>::inverse() const { return lu().inverse().template as<T>(); }
+
+template <typename T>
+VectorND<T> MatrixND<T>::solve(const VectorND<T>& b) const {
+    auto x = lu().solve(b);
+    auto data = std::make_unique<VectorData<T>>(x.size());
+    for (std::size_t i = 0; i < x.size(); i++) {
+        data->set(i, static_cast<T>(x.get(i)));
+    }
+    return VectorND<T>(std::move(data));
+}
+
+template <typename T>
+MatrixND<T> MatrixND<T>::solve(const MatrixND& b) const { return lu().solve(b).template as<T>(); }
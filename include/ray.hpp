@@ -0,0 +1,9 @@
+#pragma once
+
+#include "vector.hpp"
+
+
+struct Ray {
+    Vector3D origin;
+    Vector3D direction;
+};
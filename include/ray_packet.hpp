@@ -0,0 +1,41 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "ray.hpp"
+#include "vector_kernels.hpp"
+#include <cstdint>
+
+
+// Up to 64 rays (an 8x8 block of primary rays) in structure-of-arrays form,
+// so a BVH node's box can be tested against 8 rays per AVX2 instruction.
+// Sets of rays are passed around as bit masks: ray i is bit i.
+struct RayPacket {
+    static constexpr int kMaxRays = 64;
+
+    int count = 0;
+    alignas(32) float ox[kMaxRays] = {};
+    alignas(32) float oy[kMaxRays] = {};
+    alignas(32) float oz[kMaxRays] = {};
+    alignas(32) float dx[kMaxRays] = {};
+    alignas(32) float dy[kMaxRays] = {};
+    alignas(32) float dz[kMaxRays] = {};
+    // 1 / direction, as the single-ray traversal computes it.
+    alignas(32) float invDx[kMaxRays] = {};
+    alignas(32) float invDy[kMaxRays] = {};
+    alignas(32) float invDz[kMaxRays] = {};
+
+    // Appends ray and returns its index; the packet must not be full.
+    int add(const Ray& ray);
+    Ray ray(int i) const { return Ray{Vector3D(ox[i], oy[i], oz[i]), Vector3D(dx[i], dy[i], dz[i])}; }
+    std::uint64_t all() const { return count == kMaxRays ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1; }
+};
+
+namespace ray_packet {
+
+// The rays of mask that would enter a node with this box in the single-ray
+// traversal (bvh_detail::closestLeafHit): the whole line crosses the box and
+// the box is no farther than bestDistSq[i] from the origin.
+std::uint64_t boxMask(const AABB& box, const RayPacket& packet, const float* bestDistSq, std::uint64_t mask,
+                      SimdLevel level = detectSimdLevel());
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include "scene.hpp"
+#include "thread_pool.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+
+constexpr int kMaxPacketSize = 8; // 8 x 8 rays fill a RayPacket
+// Largest settings the command line, scene files and scene caches accept.
+constexpr int kMaxImageSize = 1 << 16; // width, height and tileSize
+constexpr std::size_t kMaxThreads = 4096;
+
+struct RenderSettings {
+    int width = 100;
+    int height = 100;
+    int tileSize = 16;
+    std::size_t threads = 0; // 0 uses every hardware thread
+    // Primary rays of each packetSize x packetSize block are traced as one
+    // RayPacket; 1 traces them one at a time. Clamped to [1, kMaxPacketSize].
+    int packetSize = 8;
+};
+
+// Primary ray of pixel (i, j).
+Ray primaryRay(const Scene& scene, int height, int width, int i, int j);
+// Colour of pixel (i, j) given the closest hit of its primary ray: lit when
+// the bounce ray reaches one of scene.lights(), plus the diffuse light from
+// each of scene.analyticLights(), sampled once per pixel with one shadow ray.
+// The samples depend only on (i, j), not on the tile.
+std::array<std::uint8_t, 3> shadeHit(const Scene& scene, const std::optional<HitInfo>& hit, int i, int j);
+
+// Colour of pixel (i, j), where i walks the height and j the width: shadeHit()
+// of the closest hit along its primary ray.
+std::array<std::uint8_t, 3> shadePixel(const Scene& scene, int height, int width, int i, int j);
+
+// Splits the image into tileSize x tileSize tiles and shades them on a thread
+// pool, tracing the primary rays of each tile in packets. Tiles cover disjoint
+// pixels, so workers write straight into the shared Framebuffer through their
+// own FramebufferTile without locking, and every pixel goes through the same
+// shadeHit() as shadePixel(): the output is identical for any thread count and
+// packet size.
+class Renderer {
+public:
+    explicit Renderer(RenderSettings settings = RenderSettings());
+
+    const RenderSettings& settings() const { return _settings; }
+    std::size_t threads() const { return _pool.size(); }
+    // The workers render() runs on, free for other work between frames.
+    ThreadPool& pool() { return _pool; }
+
+    // Resizes frame to width x height, keeping its pixel format, and fills it;
+    // pixel (i, j) lands in row i, column j.
+    void render(const Scene& scene, Framebuffer& frame);
+
+private:
+    RenderSettings _settings;
+    ThreadPool _pool;
+};
@@ -2,23 +2,118 @@
 
 #include "scene_object.hpp"
 #include "camera.hpp"
+#include "light.hpp"
+#include "bvh.hpp"
+#include "ray.hpp"
+#include "ray_packet.hpp"
+#include "sphere_store.hpp"
+#include "wide_bvh.hpp"
 #include <memory>
+#include <optional>
 #include <vector>
 
 
+// What Scene::updateBVH() did.
+enum class BVHUpdate { None, Refit, Rebuild };
+
+// Objects are added through the polymorphic SceneObject API and stay
+// readable through objects(), but spheres are also mirrored into a
+// structure-of-arrays SphereStore with a material table, and intersect()
+// runs sphere_kernels over that store (or, with a BVH, over a copy of it in
+// leaf order); only objects of other kinds go through the virtual
+// SceneObject::intersect. Single rays traverse an 8-wide copy of the BVH,
+// ray packets the binary tree.
+//
+// Objects are moved only through setPosition() and setRadius(), which keep
+// the store in sync; objects() hands out const objects. Objects moved after
+// the BVH was built are tracked as dirty; updateBVH() refits just the nodes
+// above them, and rebuilds once the refit tree's SAH cost has grown too much.
+// Until then intersect() tests every object.
 class Scene {
 public:
     Scene() {};
 
     void addLight(std::unique_ptr<Light> light) { _lights.push_back(std::move(light)); }
     const std::vector<std::unique_ptr<Light>>& lights() const { return _lights; }
-    void addObject(std::unique_ptr<SceneObject> obj) { _objects.push_back(std::move(obj)); }
-    const std::vector<std::unique_ptr<SceneObject>>& objects() const { return _objects; }
+    // Lights shadeHit() samples directly, kept apart from the objects.
+    void addAnalyticLight(const AnalyticLight& light) { _analyticLights.push_back(light); }
+    const std::vector<AnalyticLight>& analyticLights() const { return _analyticLights; }
+    void addObject(std::unique_ptr<SceneObject> obj);
+    SceneObjectList objects() const { return _objects; }
+    void reserveObjects(std::size_t count);
+    void setPosition(std::size_t idx, float x, float y, float z);
+    void setRadius(std::size_t idx, float radius);
     void setCamera(std::unique_ptr<Camera> cam) { _cam = std::move(cam); }
     const std::unique_ptr<Camera>& cam() const { return _cam; }
 
+    const SphereStore& spheres() const { return _spheres; }
+    // Slot of object idx in spheres(), or SphereStore::kNoSlot for non-spheres.
+    std::uint32_t sphereSlot(std::size_t idx) const { return _sphereSlot[idx]; }
+    // Materials referenced by SphereStore::material(). Objects added one
+    // after another with the same colour share a material.
+    const std::vector<Material>& materials() const { return _materials; }
+    // Material of object idx: its sphere's entry in materials(), or one
+    // holding the object's colour for other objects.
+    Material material(std::size_t idx) const;
+
+    // Builds the BVH over objects(). Adding an object drops it again, and
+    // intersect() falls back to testing every object until it is rebuilt.
+    void buildBVH(const BVHBuildOptions& options = BVHBuildOptions()) { setBVH(BVH(_objects, options)); }
+    // Installs a tree built earlier over exactly these objects (e.g. from a
+    // scene cache). Throws std::invalid_argument unless its indices name
+    // every object exactly once; the nodes are trusted.
+    void setBVH(BVH bvh);
+    const BVH& bvh() const { return _bvh; }
+    // True while objects have changed since the BVH was last built or refit.
+    bool bvhDirty() const { return !_dirty.empty(); }
+    // Refits the BVH around the dirty objects, or rebuilds it with options
+    // when its SAH cost has passed options.rebuildSahGrowth times the cost at
+    // build time. Does nothing without a BVH or dirty objects.
+    BVHUpdate updateBVH(const BVHBuildOptions& options = BVHBuildOptions());
+
+    // Closest hit along ray, nearest to the ray origin.
+    std::optional<HitInfo> intersect(const Ray& ray) const;
+    // intersect() for every ray of packet, with hits[i] for packet.ray(i); with
+    // a BVH the rays share one traversal. Results are identical either way.
+    void intersect(const RayPacket& packet, std::optional<HitInfo>* hits) const;
+    // Any-hit query for shadow rays: whether the ray crosses an object other
+    // than ignore (typically the one it leaves from) at some tmin < t < tmax,
+    // t being signed: a sphere's surface by sphereCrossings(), other objects
+    // at the t their intersect() reports. A shadow ray passes tmin >= 0 so
+    // nothing behind its origin counts. Stops at the first blocker and builds
+    // no HitInfo for spheres.
+    bool occluded(const Vector3D& origin, const Vector3D& dir, float tmin, float tmax,
+                  std::uint32_t ignore = HitInfo::kNoObject) const;
+
 private:
+    std::uint32_t materialFor(const SceneObject& obj);
+    // Re-reads object idx into the sphere store after it changed, and marks
+    // it for the next updateBVH().
+    void refreshObject(std::size_t idx);
+    void dropBVH();
+    // Merges the hits of BVH leaf entries [first, first + count) into best.
+    void leafHits(const Ray& ray, std::uint32_t first, std::uint32_t count, std::optional<PrimitiveHit>& best) const;
+    std::optional<HitInfo> finishHit(const Ray& ray, const std::optional<PrimitiveHit>& best) const;
+    // Whether an object that is not a sphere, other than ignore, is hit by ray
+    // with tmin < t < tmax.
+    bool otherBlocks(std::uint32_t idx, const Ray& ray, float tmin, float tmax, std::uint32_t ignore) const;
+
     std::vector<std::unique_ptr<Light>> _lights;
+    std::vector<AnalyticLight> _analyticLights;
     std::vector<std::unique_ptr<SceneObject>> _objects;
     std::unique_ptr<Camera> _cam;
+    BVH _bvh;
+    WideBVH<8> _wideBvh;
+    float _builtSahCost = 0;
+    std::vector<std::uint32_t> _dirty;
+    std::vector<bool> _isDirty;              // per object, while a BVH exists
+
+    SphereStore _spheres;
+    std::vector<std::uint32_t> _sphereSlot;    // per object
+    std::vector<std::uint32_t> _otherObjects;  // objects that are not spheres
+    std::vector<Material> _materials;
+    // Spheres in BVH leaf order, so each leaf is one contiguous kernel call;
+    // entries for other objects have a NaN radius.
+    SphereStore _leafSpheres;
+    std::vector<std::uint32_t> _leafPosition; // per object, its entry in _leafSpheres
 };
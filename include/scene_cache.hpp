@@ -0,0 +1,125 @@
+#pragma once
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+
+// Binary scene cache: the spheres, lights, camera, render settings and the
+// BVH of a Scene in flat, offset-addressed sections of one file. The file is
+// mmap'ed and its sections read as arrays with no parsing. SceneCache::intersect
+// traces rays straight against the mapped records and nodes. toScene(), which
+// main uses to render, still copies the records into a Scene (one object per
+// sphere, plus its sphere store). It installs the stored BVH, so the cost
+// saved is the parse and the BVH build, not the copy.
+//
+// Layout: a Header at offset 0, then each section at a 64-byte aligned
+// offset. Offsets are relative to the start of the file, values are in host
+// byte order (checked through Header::byteOrder), and any change to the
+// records bumps kVersion.
+namespace scene_cache {
+
+constexpr char kMagic[8] = {'R', 'T', 'S', 'C', 'A', 'C', 'H', 'E'};
+constexpr std::uint32_t kVersion = 2;
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::size_t kSectionAlignment = 64;
+
+struct Section {
+    std::uint64_t offset = 0;
+    std::uint64_t count = 0;
+};
+
+struct SphereRecord {
+    float center[3];
+    float radius;
+    float color[4];
+};
+
+struct CameraRecord {
+    float position[3];
+    float orientation[3];
+    float sizeOfLens;
+    std::uint32_t present;
+};
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint64_t fileSize;
+    std::int32_t width, height, tileSize;
+    std::uint32_t threads;
+    CameraRecord camera;
+    Section spheres;
+    Section lights;  // SphereRecords; alpha is unused
+    Section analyticLights; // AnalyticLights, stored as they are
+    Section nodes;   // BVH::Node over spheres
+    Section indices; // BVH::indices()
+};
+
+static_assert(sizeof(SphereRecord) == 32 && sizeof(CameraRecord) == 32 && sizeof(Header) == 152);
+
+}
+
+// Writes scene to path, reusing scene.bvh() when it is built. Only spheres
+// can be stored; other objects throw std::invalid_argument.
+void writeSceneCache(const std::string& path, const Scene& scene, const RenderSettings& settings);
+
+// Read-only mapping of a scene cache. Opening checks the header, including
+// that the render settings are within the limits scene files have, and that
+// every section lies inside the file; verify() additionally walks the BVH.
+// Throws std::runtime_error on I/O errors and malformed files.
+class SceneCache {
+public:
+    explicit SceneCache(const std::string& path);
+    ~SceneCache();
+    SceneCache(SceneCache&& other) noexcept;
+    SceneCache& operator=(SceneCache&& other) noexcept;
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    RenderSettings settings() const;
+    bool hasCamera() const { return header().camera.present != 0; }
+    Camera camera() const;
+
+    std::span<const scene_cache::SphereRecord> spheres() const { return section<scene_cache::SphereRecord>(header().spheres); }
+    std::span<const scene_cache::SphereRecord> lights() const { return section<scene_cache::SphereRecord>(header().lights); }
+    std::span<const AnalyticLight> analyticLights() const { return section<AnalyticLight>(header().analyticLights); }
+    std::span<const BVH::Node> nodes() const { return section<BVH::Node>(header().nodes); }
+    std::span<const std::uint32_t> indices() const { return section<std::uint32_t>(header().indices); }
+
+    // Closest hit among the cached spheres, identical to Scene::intersect on
+    // the scene the cache was written from. Works on the mapping directly,
+    // and only on a verified file: call verify() first, or a damaged file
+    // can make it read outside the mapping.
+    std::optional<HitInfo> intersect(const Ray& ray) const;
+
+    // Checks that the BVH is a tree the traversals can walk safely: children
+    // after their parent, each node reached once, at most BVH::kMaxDepth
+    // levels, leaf ranges and indices in bounds, every sphere indexed once.
+    // Also checks that every light type is known. Throws std::runtime_error
+    // if not. intersect() assumes a verified file.
+    void verify() const;
+
+    // Verifies the file, then appends copies of the cached objects and lights
+    // to scene, sets its camera and installs a copy of the cached BVH instead
+    // of building a new one. The scene does not refer to the mapping afterwards.
+    void toScene(Scene& scene) const;
+
+private:
+    const scene_cache::Header& header() const { return *static_cast<const scene_cache::Header*>(_data); }
+    template <typename T>
+    std::span<const T> section(const scene_cache::Section& s) const {
+        return std::span<const T>(reinterpret_cast<const T*>(static_cast<const std::uint8_t*>(_data) + s.offset), s.count);
+    }
+    void unmap();
+
+    void* _data = nullptr;
+    std::size_t _size = 0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "renderer.hpp"
+#include "scene.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Text scene description, one record per line, fields separated by blanks,
+// '#' starts a comment:
+//
+//   render      <width> <height> [tileSize] [threads]
+//   camera      <x> <y> <z> <angleX> <angleY> <angleZ> <sizeOfLens>
+//   sphere      <x> <y> <z> <r> <g> <b> <alpha> <radius>
+//   light       <x> <y> <z> <r> <g> <b> <radius>
+//   pointlight  <x> <y> <z> <r> <g> <b> <intensity>
+//   dirlight    <dx> <dy> <dz> <r> <g> <b> <intensity>
+//   spherelight <x> <y> <z> <r> <g> <b> <intensity> <radius>
+//
+// Spheres become SphereSceneObjects (Scene::addObject), lights Lights
+// (Scene::addLight), the other *light records AnalyticLights
+// (Scene::addAnalyticLight; dirlight directions are normalized), the camera
+// Scene::setCamera and render the RenderSettings, with sizes up to
+// kMaxImageSize and at most kMaxThreads threads (0 for every hardware
+// thread). Later records of the same kind add to (objects, lights) or
+// replace (camera, render) earlier ones.
+
+struct SceneFileStats {
+    std::size_t bytes = 0;
+    std::size_t lines = 0;
+    std::size_t objects = 0;
+    std::size_t lights = 0;
+};
+
+// Streaming parser: text arrives in arbitrary chunks through feed() and is
+// parsed in place with std::from_chars, so parsing allocates nothing beyond
+// the objects it creates. Only a line split across two chunks is copied, into
+// a fixed carry buffer. Malformed input throws std::runtime_error naming the
+// line.
+class SceneParser {
+public:
+    static constexpr std::size_t kMaxLineLength = 1024;
+
+    SceneParser(Scene& scene, RenderSettings& settings);
+
+    void feed(const char* data, std::size_t size);
+    // Parses a last line without a trailing newline.
+    void finish();
+
+    const SceneFileStats& stats() const { return _stats; }
+
+private:
+    void parseLine(std::string_view line);
+    [[noreturn]] void fail(const char* message) const;
+
+    Scene& _scene;
+    RenderSettings& _settings;
+    SceneFileStats _stats;
+    char _carry[kMaxLineLength];
+    std::size_t _carrySize = 0;
+};
+
+// Reads path in fixed-size chunks through a SceneParser.
+SceneFileStats loadScene(const std::string& path, Scene& scene, RenderSettings& settings);
+SceneFileStats loadSceneFromString(std::string_view text, Scene& scene, RenderSettings& settings);
+
+// Writes scene and settings in the format above, with shortest round-trip
+// floats. Throws std::invalid_argument for objects other than spheres.
+void saveScene(const std::string& path, const Scene& scene, const RenderSettings& settings);
+std::string sceneToString(const Scene& scene, const RenderSettings& settings);
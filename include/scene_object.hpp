@@ -1,21 +1,145 @@
 #pragma once
 
 #include "vector.hpp"
-#include <vector>
+#include "aabb.hpp"
+#include "trace.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <type_traits>
+#include <vector>
 
 
+// Flat, trivially copyable hit record. t is the signed distance along the
+// ray in units of its direction, so point == origin + direction * t.
+// intersect() leaves objectId unset; Scene and BVH fill in the index of the
+// object in Scene::objects().
 struct HitInfo {
-    std::unique_ptr<Vector3D> hitPoint;
-    std::unique_ptr<Vector3D> bounceDir; 
+    static constexpr std::uint32_t kNoObject = std::numeric_limits<std::uint32_t>::max();
+
+    float t = std::numeric_limits<float>::infinity();
+    Vector3D point;
+    Vector3D normal;
+    Vector3D bounceDir;
+    std::uint32_t objectId = kNoObject;
+
+    // Closest-hit order. intersect() may report points behind the origin,
+    // so the smaller |t| wins; equal distances go to the lower object id.
+    bool closerThan(const HitInfo& other) const {
+        float a = std::abs(t);
+        float b = std::abs(other.t);
+        return a < b || (a == b && objectId < other.objectId);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<HitInfo>, "HitInfo must stay a plain value type");
+
+// Winner of a closest-hit search before its HitInfo is filled in: the
+// primitive's index and t, ordered like HitInfo::closerThan.
+struct PrimitiveHit {
+    std::uint32_t index = HitInfo::kNoObject;
+    float t = std::numeric_limits<float>::infinity();
+
+    bool closerThan(const PrimitiveHit& other) const {
+        float a = std::abs(t);
+        float b = std::abs(other.t);
+        return a < b || (a == b && index < other.index);
+    }
 };
 
 
+// Ray-sphere test behind SphereSceneObject::intersect, split so sphere data
+// that lives outside any SceneObject (Scene's SoA store, a mapped scene
+// cache) can find the closest t first and fill in the rest for the winner only.
+//
+// Distance part: t of the hit intersectSphere() would report, or false.
+inline bool sphereHitDistance(const Vector3D& center, float radius, const Vector3D& origin, const Vector3D& direction,
+                              float& t) {
+    // Vector from origin to sphere center
+    Vector3D toCenter = center - origin;
+
+    // Length squared of toCenter vector
+    float distSq = toCenter.lengthSquared();
+
+    // Radius squared
+    float radiusSq = radius * radius;
+
+    // Projection of toCenter onto direction
+    float proj = toCenter.dot(direction);
+
+    // Distance squared from projected point to sphere center
+    float x = distSq - proj*proj;
+
+    // Check if projected point is outside sphere
+    if (x > radiusSq) {
+        return false;
+    }
+
+    // Distance squared from origin to projected point
+    float y = std::sqrt(radiusSq - x);
+
+    // Check if origin is outside sphere
+    if (distSq > y*y) {
+        return false;
+    }
+
+    t = proj - y;
+    return true;
+}
+
+// Where the line origin + t * direction crosses the sphere's surface, as
+// signed tNear <= tFar, or false when it misses. Unlike sphereHitDistance()
+// this does not need the origin inside the sphere; shadow rays use it.
+inline bool sphereCrossings(const Vector3D& center, float radius, const Vector3D& origin, const Vector3D& direction,
+                            float& tNear, float& tFar) {
+    Vector3D toCenter = center - origin;
+    float distSq = toCenter.lengthSquared();
+    float radiusSq = radius * radius;
+    float proj = toCenter.dot(direction);
+    float x = distSq - proj * proj;
+    if (!(x <= radiusSq)) return false;
+    float y = std::sqrt(radiusSq - x);
+    tNear = proj - y;
+    tFar = proj + y;
+    return true;
+}
+
+// The full hit record for a t found by sphereHitDistance(). radius is only
+// read by the trace line, which TRACE_LEVEL=0 compiles out.
+inline HitInfo sphereHitInfo(const Vector3D& center, [[maybe_unused]] float radius, const Vector3D& origin,
+                             const Vector3D& direction, float t) {
+    // Hit point is ray origin + ray direction * distance
+    HitInfo hit;
+    hit.t = t;
+    hit.point = origin + direction * hit.t;
+
+    // Normal at hit point
+    hit.normal = (hit.point - center).normalize();
+
+    // Bounce direction
+    hit.bounceDir = direction.cross(hit.normal).normalize();
+    TRACE(Verbose, Intersect, "sphere (%g, %g, %g) r=%g hit t=%g at (%g, %g, %g)",
+          center.x(), center.y(), center.z(), radius, hit.t,
+          hit.point.x(), hit.point.y(), hit.point.z());
+    return hit;
+}
+
+inline std::optional<HitInfo> intersectSphere(const Vector3D& center, float radius, const Vector3D& origin,
+                                              const Vector3D& direction) {
+    float t;
+    if (!sphereHitDistance(center, radius, origin, direction, t)) return std::nullopt;
+    return sphereHitInfo(center, radius, origin, direction, t);
+}
+
+
 class SceneObject {
 public:
     SceneObject(float x, float y, float z, float r, float g, float b, float alpha):
         _position(Vector3D(x, y, z)), _color(std::move(std::make_unique<VectorData<float>>(std::vector<float>{r, g, b, alpha}))) {};
-    
+    virtual ~SceneObject() = default;
+
     const Vector3D& position() const { return _position; }
     const VectorND<float>& color() const { return _color; }
     void setPosition(float x, float y, float z) {
@@ -33,6 +157,11 @@ public:
     virtual float radius() const { return 0; }
     virtual void setRadius(float newR) {}
 
+    // Box enclosing every point intersect() can report.
+    virtual AABB bounds() const {
+        return AABB(position().x(), position().y(), position().z(), position().x(), position().y(), position().z());
+    }
+
     virtual std::optional<HitInfo> intersect(const Vector3D& origin, const Vector3D& direction) const { return std::nullopt;; }
 
 private:
@@ -50,59 +179,13 @@ public:
     float radius() const { return _radius; }
     void setRadius(float newR) { _radius = newR; }
 
+    AABB bounds() const {
+        const Vector3D& c = position();
+        return AABB(c.x() - _radius, c.y() - _radius, c.z() - _radius, c.x() + _radius, c.y() + _radius, c.z() + _radius);
+    }
+
     std::optional<HitInfo> intersect(const Vector3D& origin, const Vector3D& direction) const {
-        std::cout << "intersect1" << std::endl;
-        // Vector from origin to sphere center
-        Vector3D toCenter = position() - origin; 
-        std::cout << "intersect2 " << position().toString() << " " << origin.toString() << " " << toCenter.toString() << std::endl;
-        
-        // Length squared of toCenter vector
-        float distSq = toCenter.lengthSquared();
-        std::cout << "intersect3" << std::endl;
-        
-        // Radius squared
-        float radiusSq = radius() * radius();
-        std::cout << "intersect4" << std::endl;
-        
-        // Projection of toCenter onto direction
-        float proj = toCenter.dot(direction);
-        std::cout << "intersect5" << std::endl;
-
-        // Distance squared from projected point to sphere center
-        float x = distSq - proj*proj;
-        std::cout << "intersect6" << std::endl;
-
-        // Check if projected point is outside sphere
-        if (x > radiusSq) {
-            return std::nullopt;; 
-        }
-        std::cout << "intersect7" << std::endl;
-
-        // Distance squared from origin to projected point
-        float y = std::sqrt(radiusSq - x);
-        std::cout << "intersect8" << std::endl;
-
-        // Check if origin is outside sphere
-        if (distSq > y*y) {
-            return std::nullopt;
-        }
-        std::cout << "intersect9" << std::endl;
-
-        // Hit point is ray origin + ray direction * distance
-        HitInfo hit;
-        hit.hitPoint = std::make_unique<Vector3D>(std::move(origin + direction * (proj - y)));
-        std::cout << "intersect10" << std::endl;
-
-        // Normal at hit point
-        Vector3D normal = (*hit.hitPoint - position()).normalize();
-        std::cout << "intersect11 " << direction.toString() << normal.toString() << std::endl;
-
-        // Bounce direction
-        hit.bounceDir = std::make_unique<Vector3D>(std::move(direction.cross(normal).normalize()));
-        std::cout << "intersect12" << std::endl;
-        std::cout << "intersect post " << hit.hitPoint->toString() << std::endl;
-        std::cout << "intersect post " << hit.bounceDir->toString() << std::endl;
-        return std::make_optional(std::move(hit));
+        return intersectSphere(position(), radius(), origin, direction);
     }
 
 private:
@@ -116,3 +199,32 @@ public:
 private:
 };
 
+
+// Read-only view of a list of owned objects: element i is a const
+// SceneObject*, so code handed one can inspect the objects but not move them.
+// Scene::objects() returns one so every change goes through Scene.
+class SceneObjectList {
+public:
+    using Owned = std::vector<std::unique_ptr<SceneObject>>;
+
+    class Iterator {
+    public:
+        explicit Iterator(Owned::const_iterator it): _it(it) {}
+        const SceneObject* operator*() const { return _it->get(); }
+        Iterator& operator++() { ++_it; return *this; }
+        bool operator==(const Iterator& other) const { return _it == other._it; }
+    private:
+        Owned::const_iterator _it;
+    };
+
+    SceneObjectList(const Owned& objects): _objects(&objects) {}
+
+    std::size_t size() const { return _objects->size(); }
+    bool empty() const { return _objects->empty(); }
+    const SceneObject* operator[](std::size_t i) const { return (*_objects)[i].get(); }
+    Iterator begin() const { return Iterator(_objects->begin()); }
+    Iterator end() const { return Iterator(_objects->end()); }
+
+private:
+    const Owned* _objects;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ray.hpp"
+#include "scene_object.hpp"
+#include "vector_kernels.hpp"
+#include <cstdint>
+#include <optional>
+
+
+// One ray against many spheres held as parallel arrays (a SphereStore, or a
+// copy of one in BVH leaf order). The AVX2 kernel tests 8 spheres per step
+// and the SSE kernel 4, keeping the nearest hit per lane and reducing the
+// lanes at the end; both load a short final block with the missing lanes
+// masked off, so a BVH leaf of a few spheres is still a single step.
+//
+// Every level performs the same IEEE operations as sphereHitDistance(), or
+// sphereCrossings() for any() (no FMA), so for finite inputs they agree bit
+// for bit with the scalar tests and with SphereSceneObject::intersect.
+// AVX-512 machines run the AVX2 kernel.
+
+struct SphereArrays {
+    const float* cx = nullptr;
+    const float* cy = nullptr;
+    const float* cz = nullptr;
+    const float* radius = nullptr;
+    // Reported as PrimitiveHit::index; a sphere with a NaN radius never hits,
+    // which callers use to leave holes for other kinds of objects.
+    const std::uint32_t* id = nullptr;
+};
+
+namespace sphere_kernels {
+
+// Closest hit among spheres [first, last), merged into best with
+// PrimitiveHit::closerThan (nearest |t|, ties to the lower id).
+void nearest(const SphereArrays& spheres, std::uint32_t first, std::uint32_t last, const Ray& ray,
+             std::optional<PrimitiveHit>& best, SimdLevel level = detectSimdLevel());
+
+// Shadow-ray test: whether the line crosses the surface of some sphere in
+// [first, last) other than id ignore at a t with tMin < t < tMax, using
+// sphereCrossings() rather than the closest-hit test above, which only
+// reports spheres around the origin. Stops at the first block of lanes with
+// a crossing.
+bool any(const SphereArrays& spheres, std::uint32_t first, std::uint32_t last, const Ray& ray, float tMin, float tMax,
+         std::uint32_t ignore = HitInfo::kNoObject, SimdLevel level = detectSimdLevel());
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ray.hpp"
+#include "scene_object.hpp"
+#include "sphere_kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+
+// Surface description shared by any number of primitives.
+struct Material {
+    float color[4] = {0, 0, 0, 0};
+
+    bool operator==(const Material&) const = default;
+};
+
+// Structure-of-arrays sphere storage: one contiguous array per field, so a
+// closest-hit scan streams through centres and radii instead of chasing one
+// heap node per object. Each slot also records the material and the index of
+// the SceneObject it mirrors, which is the objectId reported in hits.
+class SphereStore {
+public:
+    static constexpr std::uint32_t kNoSlot = std::numeric_limits<std::uint32_t>::max();
+
+    std::size_t size() const { return _radius.size(); }
+    bool empty() const { return _radius.empty(); }
+    void reserve(std::size_t count);
+
+    std::uint32_t add(const Vector3D& center, float radius, std::uint32_t material, std::uint32_t objectId);
+    void set(std::uint32_t slot, const Vector3D& center, float radius);
+    void setMaterial(std::uint32_t slot, std::uint32_t material) { _material[slot] = material; }
+
+    const float* cx() const { return _cx.data(); }
+    const float* cy() const { return _cy.data(); }
+    const float* cz() const { return _cz.data(); }
+    const float* radius() const { return _radius.data(); }
+    const std::uint32_t* material() const { return _material.data(); }
+    const std::uint32_t* objectId() const { return _objectId.data(); }
+    Vector3D center(std::uint32_t slot) const { return Vector3D(_cx[slot], _cy[slot], _cz[slot]); }
+    // The arrays in the form sphere_kernels takes, with object ids as indices.
+    SphereArrays arrays() const { return {cx(), cy(), cz(), radius(), objectId()}; }
+
+    // sphereHitDistance() for one slot.
+    bool distance(std::uint32_t slot, const Ray& ray, float& t) const {
+        return sphereHitDistance(center(slot), _radius[slot], ray.origin, ray.direction, t);
+    }
+    // Closest hit among slots [first, last), merged into best by the SIMD
+    // kernel; the returned PrimitiveHit::index is the object id, not the slot.
+    void nearest(const Ray& ray, std::uint32_t first, std::uint32_t last, std::optional<PrimitiveHit>& best) const;
+    // HitInfo of slot hit at t, with objectId set.
+    HitInfo hitInfo(std::uint32_t slot, const Ray& ray, float t) const;
+
+private:
+    std::vector<float> _cx, _cy, _cz, _radius;
+    std::vector<std::uint32_t> _material;
+    std::vector<std::uint32_t> _objectId;
+};
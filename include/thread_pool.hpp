@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fixed-size pool of worker threads with one work queue per worker.
+// A worker drains its own queue front-to-back and, once empty, steals from the
+// back of the other queues, so uneven work (e.g. tiles full of geometry next to
+// empty sky) still keeps every thread busy.
+class ThreadPool {
+public:
+    // threads == 0 uses every hardware thread. The calling thread always takes
+    // part in parallelFor, so a pool of size 1 spawns no threads at all.
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return _queues.size(); }
+
+    // Runs fn(idx) once for every idx in [0, count) and blocks until all calls
+    // returned. The first exception thrown by fn is rethrown here.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> items;
+    };
+
+    void workerLoop(std::size_t slot);
+    void runJob(std::size_t slot, const std::function<void(std::size_t)>& fn);
+    bool popLocal(std::size_t slot, std::size_t& idx);
+    bool steal(std::size_t thief, std::size_t& idx);
+
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const std::function<void(std::size_t)>* _job = nullptr;
+    std::size_t _generation = 0;
+    std::size_t _active = 0;
+    std::atomic<std::size_t> _remaining{0};
+    std::exception_ptr _error;
+    bool _stop = false;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+
+// Levelled, categorised tracing for the hot paths (camera, intersection,
+// shading), replacing the old std::cout/std::endl logging.
+//
+// TRACE(level, category, fmt, ...) is compiled in only for levels up to
+// TRACE_LEVEL (0 = off, the default; build with e.g. make TRACE_LEVEL=5 for
+// everything). Compiled-out calls do not evaluate their arguments. Enabled
+// calls are filtered at runtime by level, category mask, 1-in-N sampling and
+// a per-category rate limit, then formatted into a lock-free per-thread ring
+// buffer. A background thread drains every ring, orders the batch by time
+// and writes it to the sink with one flush per batch. A full ring drops the
+// event and counts it instead of blocking the renderer.
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+
+namespace trace {
+
+enum class Level : int { Off = 0, Error = 1, Warn = 2, Info = 3, Debug = 4, Verbose = 5 };
+
+enum Category : std::uint32_t {
+    Camera = 1u << 0,
+    Intersect = 1u << 1,
+    Shade = 1u << 2,
+    Render = 1u << 3,
+    AllCategories = 0xFu,
+};
+
+struct Config {
+    Level level = Level::Info;
+    std::uint32_t categories = AllCategories;
+    // Keep one event in sampleEvery, counted per thread and category.
+    std::uint32_t sampleEvery = 1;
+    // Events per second per thread and category; 0 means unlimited.
+    std::uint32_t maxPerSecond = 0;
+    std::FILE* sink = stderr;
+    std::chrono::milliseconds drainInterval{20};
+};
+
+struct Stats {
+    std::uint64_t recorded = 0;  // accepted into a ring
+    std::uint64_t dropped = 0;   // ring was full
+    std::uint64_t written = 0;   // drained to the sink
+};
+
+void configure(const Config& config);
+Config config();
+// Cheap runtime filter on level and category.
+bool enabled(Level level, Category category);
+void emit(Level level, Category category, const char* format, ...) __attribute__((format(printf, 3, 4)));
+// Drains every ring to the sink now; returns once the events emitted before
+// the call have been written.
+void flush();
+Stats stats();
+const char* levelName(Level level);
+const char* categoryName(Category category);
+
+}
+
+#if TRACE_LEVEL > 0
+#define TRACE(level, category, ...) \
+    do { \
+        if constexpr (static_cast<int>(::trace::Level::level) <= TRACE_LEVEL) { \
+            if (::trace::enabled(::trace::Level::level, ::trace::category)) { \
+                ::trace::emit(::trace::Level::level, ::trace::category, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+#else
+#define TRACE(level, category, ...) ((void)0)
+#endif
@@ -4,10 +4,14 @@
 #include <cstddef>
 #include <memory>
 #include <cmath>
+#include <cassert>
 #include <algorithm>
 #include <cstring>
+#include <functional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 
 
 template <typename T>
@@ -18,6 +22,23 @@ public:
     VectorND(std::unique_ptr<VectorData<T>> data): _data(std::move(data)) {}
 
     VectorND(const VectorND& other): _data(std::make_unique<VectorData<T>>(*other._data)) {}
+    VectorND(VectorND&& other) noexcept = default;
+    VectorND& operator=(const VectorND& other) {
+        if (this != &other) _data = std::make_unique<VectorData<T>>(*other._data);
+        return *this;
+    }
+    VectorND& operator=(VectorND&& other) noexcept = default;
+    // Materialises an explicit expression (see vector_expr.hpp); the result
+    // is allocated once, here or in the assignment below.
+    template <VectorExpression E>
+        requires std::is_same_v<typename E::value_type, T>
+    VectorND(const E& expr): _data(std::make_unique<VectorData<T>>(expr)) {}
+    template <VectorExpression E>
+        requires std::is_same_v<typename E::value_type, T>
+    VectorND& operator=(const E& expr) {
+        _data = std::make_unique<VectorData<T>>(expr);
+        return *this;
+    }
 
     size_t size() const { return _data->length(); }
 
@@ -26,6 +47,9 @@ public:
     const VectorData<T>& vectorData() const { return *_data; }
 
     T distance(const VectorND& other) const {
+        if constexpr (vector_kernels::supports<T>) {
+            if (contiguousWith(other)) return std::sqrt(vector_kernels::distanceSquared(_data->data(), other._data->data(), size()));
+        }
         T sumSq = 0;
         for(size_t i = 0; i < size(); i++) {
             sumSq += pow(get(i) - other.get(i), 2);
@@ -33,6 +57,9 @@ public:
         return std::sqrt(sumSq);
     }
     T magnitude() const {
+        if constexpr (vector_kernels::supports<T>) {
+            if (contiguousWith(*this)) return std::sqrt(vector_kernels::dot(_data->data(), _data->data(), size()));
+        }
         T sumSq = 0;
         for(size_t i = 0; i < size(); i++) {
             sumSq += pow(get(i), 2);
@@ -40,36 +67,50 @@ public:
         return std::sqrt(sumSq);
     }
 
-    VectorND add(T scalar) const {
-        return VectorND(vectorData() + scalar);
-    }
-    VectorND operator+(T scalar) const { return add(scalar); };
+    VectorND add(T scalar) const { return *this + scalar; }
     VectorND add(const VectorND& other) const {
         assert (size() == other.size());
-        return VectorND(vectorData() + other.vectorData());
+        return *this + other;
     }
-    VectorND operator+(const VectorND& other) const { return add(other); };
 
-    VectorND sub(T scalar) const {
-        return VectorND(vectorData() - scalar);
-    }
-    VectorND operator-(T scalar) const { return sub(scalar); };
+    VectorND sub(T scalar) const { return *this - scalar; }
     VectorND sub(const VectorND& other) const {
         assert (size() == other.size());
-        return VectorND(vectorData() - other.vectorData());
+        return *this - other;
     }
-    VectorND operator-(const VectorND& other) const { return sub(other); };
 
-    VectorND mul(T scalar) const { return VectorND(vectorData() * scalar); }
-    VectorND operator*(T scalar) const { return mul(scalar); };
+    VectorND mul(T scalar) const { return *this * scalar; }
+    VectorND div(T scalar) const { return *this / scalar; }
+
+    // The operators return an evaluated VectorND. A temporary operand lends
+    // its buffer to the result, so a + b * 2 - 1 allocates once; wrap the
+    // operands in asVectorExpr() for a single fused loop instead.
+#define DEFINE_VECTOR_ND_OP(OP, KIND, FUNC) \
+    friend VectorND operator OP(const VectorND& a, const VectorND& b) { \
+        return VectorND(asVectorExpr(a) OP asVectorExpr(b)); \
+    } \
+    friend VectorND operator OP(VectorND&& a, const VectorND& b) { return combineInto<FUNC>(std::move(a), a, b, KIND); } \
+    friend VectorND operator OP(const VectorND& a, VectorND&& b) { return combineInto<FUNC>(std::move(b), a, b, KIND); } \
+    friend VectorND operator OP(VectorND&& a, VectorND&& b) { return combineInto<FUNC>(std::move(a), a, b, KIND); } \
+    friend VectorND operator OP(const VectorND& a, T s) { return VectorND(asVectorExpr(a) OP s); } \
+    friend VectorND operator OP(VectorND&& a, T s) { return scalarInto<FUNC, false>(std::move(a), s, KIND); } \
+    friend VectorND operator OP(T s, const VectorND& a) { return VectorND(s OP asVectorExpr(a)); } \
+    friend VectorND operator OP(T s, VectorND&& a) { return scalarInto<FUNC, true>(std::move(a), s, KIND); }
 
-    VectorND div(T scalar) const { return VectorND(vectorData() / scalar); }
-    VectorND operator/(T scalar) const { return div(scalar); };
+    DEFINE_VECTOR_ND_OP(+, VectorOp::Add, std::plus<>)
+    DEFINE_VECTOR_ND_OP(-, VectorOp::Sub, std::minus<>)
+    DEFINE_VECTOR_ND_OP(*, VectorOp::Mul, std::multiplies<>)
+    DEFINE_VECTOR_ND_OP(/, VectorOp::Div, std::divides<>)
+
+#undef DEFINE_VECTOR_ND_OP
 
     // Complex operations
     T dot(const VectorND& other) const {
         assert (size() == other.size());
-        return (vectorData() * other.vectorData()).sum();
+        if constexpr (vector_kernels::supports<T>) {
+            if (contiguousWith(other)) return vector_kernels::dot(_data->data(), other._data->data(), size());
+        }
+        return (asVectorExpr(*this) * asVectorExpr(other)).sum();
     }
     T angle(const VectorND& other) const {
         // a * b = |a| * |b| * cos(theta)
@@ -100,54 +141,86 @@ public:
     VectorND normalize() const { return div(norm()); }
 
 protected:
+    // a op b written into target's buffer, target being a or b, unless that
+    // buffer is borrowed (e.g. a matrix row); then the result is fresh.
+    template <typename Op>
+    static VectorND combineInto(VectorND&& target, const VectorND& a, const VectorND& b, VectorOp kind) {
+        if (target._data->borrowed()) {
+            return VectorND(VectorBinaryExpr<VectorExprRef<T>, VectorExprRef<T>, Op>(asVectorExpr(a), asVectorExpr(b)));
+        }
+        if (a.size() != b.size()) throw std::length_error("Vectors must be the same length.");
+        T* out = target._data->data();
+        if constexpr (vector_kernels::supports<T>) {
+            if (a.contiguousWith(b) && target._data->stride() == 1) {
+                vector_kernels::binary(kind, a._data->data(), b._data->data(), out, a.size());
+                return std::move(target);
+            }
+        }
+        const std::size_t stride = target._data->stride();
+        for (std::size_t i = 0; i < a.size(); i++) out[i * stride] = Op{}(a.get(i), b.get(i));
+        return std::move(target);
+    }
+    template <typename Op, bool ScalarFirst>
+    static VectorND scalarInto(VectorND&& target, T s, VectorOp kind) {
+        if (target._data->borrowed()) {
+            return VectorND(VectorScalarExpr<VectorExprRef<T>, Op, ScalarFirst>(asVectorExpr(target), s));
+        }
+        if constexpr (!ScalarFirst) {
+            target._data->binary_op_inplace(s, kind, Op{});
+            return std::move(target);
+        }
+        T* out = target._data->data();
+        const std::size_t stride = target._data->stride();
+        for (std::size_t i = 0; i < target.size(); i++) out[i * stride] = Op{}(s, out[i * stride]);
+        return std::move(target);
+    }
+
+    bool contiguousWith(const VectorND& other) const {
+        return _data->stride() == 1 && other._data->stride() == 1 && size() == other.size();
+    }
+
     std::unique_ptr<VectorData<T>> _data;
 };
 
-class Vector3D : public VectorND<float> {
+// Three floats stored inline: no heap, trivially copyable. It used to derive
+// from VectorND<float>, which costs two allocations per vector; it keeps the
+// same interface and converts to and from VectorND<float> where needed.
+class Vector3D {
 public:
 
-    Vector3D() : VectorND<float>(std::make_unique<VectorData<float>>(new unsigned char[3*sizeof(float)] {0, 0, 0}, 3)) {}
-    Vector3D(float x, float y, float z) {
-        std::unique_ptr<unsigned char[]> arr(new unsigned char[3*sizeof(float)]);
-        std::memcpy(arr.get(), &x, sizeof(float));
-        std::memcpy(arr.get() + sizeof(float), &y, sizeof(float));
-        std::memcpy(arr.get() + 2*sizeof(float), &z, sizeof(float));
-        _data = std::make_unique<VectorData<float>>(std::move(arr), 3);
-    }
+    Vector3D() : _v{0, 0, 0} {}
+    Vector3D(float x, float y, float z) : _v{x, y, z} {}
 
-    Vector3D(const VectorND<float>& vec) : VectorND<float>(vec) {
-        assert(size() == 3);
-        // The data is already copied in the VectorND<float> copy constructor, so no need to set here
+    Vector3D(const VectorND<float>& vec) {
+        assert(vec.size() == 3);
+        _v[0] = vec.get(0);
+        _v[1] = vec.get(1);
+        _v[2] = vec.get(2);
+    }
+    operator VectorND<float>() const {
+        return VectorND<float>(std::make_unique<VectorData<float>>(std::vector<float>{_v[0], _v[1], _v[2]}));
     }
-    Vector3D(const Vector3D& vec) {
-        std::unique_ptr<unsigned char[]> arr(new unsigned char[3*sizeof(float)]);
-        _data = std::make_unique<VectorData<float>>(std::move(arr), 3);
 
-        setX(vec.x());
-        setY(vec.y());
-        setZ(vec.z());
+    size_t size() const { return 3; }
+    float get(std::size_t pos) const {
+        if (pos >= 3) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        return _v[pos];
     }
-    Vector3D& operator=(const Vector3D& vec) {
-        // Check for self-assignment
-        if (this == &vec) {
-            return *this;
+    void set(std::size_t pos, float val) {
+        if (pos >= 3) {
+            throw std::out_of_range("Index out of bounds.");
         }
-
-        // Copy data from vec
-        std::unique_ptr<unsigned char[]> arr(new unsigned char[3*sizeof(float)]);
-        _data = std::make_unique<VectorData<float>>(std::move(arr), 3);
-        setX(vec.x());
-        setY(vec.y());
-        setZ(vec.z());
-        return *this;
+        _v[pos] = val;
     }
 
-    float x() const { return get(0); };
-    float y() const { return get(1); };
-    float z() const { return get(2); };
-    void setX(float x) { set(0, x); };
-    void setY(float y) { set(1, y); };
-    void setZ(float z) { set(2, z); };
+    float x() const { return _v[0]; };
+    float y() const { return _v[1]; };
+    float z() const { return _v[2]; };
+    void setX(float x) { _v[0] = x; };
+    void setY(float y) { _v[1] = y; };
+    void setZ(float z) { _v[2] = z; };
 
     std::string toString() const {
         std::stringstream ss;
@@ -155,20 +228,52 @@ public:
         return ss.str();
     }
 
-    float lengthSquared() const {
-        return get(0)*get(0) + get(1)*get(1) + get(2)*get(2);
+    Vector3D add(float scalar) const { return Vector3D(x() + scalar, y() + scalar, z() + scalar); }
+    Vector3D operator+(float scalar) const { return add(scalar); };
+    Vector3D add(const Vector3D& other) const { return Vector3D(x() + other.x(), y() + other.y(), z() + other.z()); }
+    Vector3D operator+(const Vector3D& other) const { return add(other); };
+
+    Vector3D sub(float scalar) const { return Vector3D(x() - scalar, y() - scalar, z() - scalar); }
+    Vector3D operator-(float scalar) const { return sub(scalar); };
+    Vector3D sub(const Vector3D& other) const { return Vector3D(x() - other.x(), y() - other.y(), z() - other.z()); }
+    Vector3D operator-(const Vector3D& other) const { return sub(other); };
+
+    Vector3D mul(float scalar) const { return Vector3D(x() * scalar, y() * scalar, z() * scalar); }
+    Vector3D operator*(float scalar) const { return mul(scalar); };
+
+    Vector3D div(float scalar) const { return Vector3D(x() / scalar, y() / scalar, z() / scalar); }
+    Vector3D operator/(float scalar) const { return div(scalar); };
+
+    float dot(const Vector3D& other) const { return x() * other.x() + y() * other.y() + z() * other.z(); }
+    float lengthSquared() const { return dot(*this); }
+    float magnitude() const { return std::sqrt(lengthSquared()); }
+    float distance(const Vector3D& other) const { return sub(other).magnitude(); }
+    float angle(const Vector3D& other) const {
+        // a * b = |a| * |b| * cos(theta)
+        return std::acos(dot(other) / (magnitude() * other.magnitude()));
     }
+
+    // Norms
+    float l1Norm() const { return std::abs(x()) + std::abs(y()) + std::abs(z()); }
+    float l2Norm() const { return magnitude(); }
+    float linfNorm() const { return std::max({std::abs(x()), std::abs(y()), std::abs(z())}); }
+    float norm() const { return std::max(std::max(l1Norm(), l2Norm()), linfNorm()); }
+
     Vector3D normalize() const {
         return div(magnitude());
     }
 
     Vector3D cross(const Vector3D& other) const {
         //(a2b3 - a3b2), (a1b3 - a3b1), (a1b2 - a2b1)
-        // TODO OPTIMIZATION: Calculate x,y,z in parallel?
         return Vector3D(
             y() * other.z() - z() * other.y(),
             z() * other.x() - x() * other.z(),
             x() * other.y() - y() * other.x()
         );
     }
+
+private:
+    float _v[3];
 };
+
+static_assert(std::is_trivially_copyable_v<Vector3D>, "Vector3D must stay a plain value type");
@@ -1,55 +1,92 @@
 #pragma once
 
+#include "arena.hpp"
+#include "vector_expr.hpp"
+#include "vector_kernels.hpp"
+#include "vector_data_view.hpp"
 #include <stdexcept>
 #include <memory>
+#include <memory_resource>
 #include <iterator>
 #include <cstdint>
 #include <algorithm>
+#include <vector>
+#include <string>
+#include <functional>
 
 
+// Strided array of T over a byte buffer. Owned buffers come from a
+// std::pmr::memory_resource: the one passed in, or else currentMathResource()
+// at the time of allocation (new/delete unless an arena is installed). That
+// includes the results of arithmetic and copies, so a chain of temporaries
+// inside a ScopedMathResource never touches the global heap.
 template <typename T>
 class VectorData {
 public:
     VectorData(std::unique_ptr<unsigned char[]> data, size_t length, size_t stride = 1)
-        : _data(std::move(data)), _length(length), _stride(stride) {}
-    VectorData(const unsigned char* data, size_t length, size_t stride = 1)
-        : _data(std::make_unique<unsigned char[]>(stride * sizeof(T) * length)), _length(length), _stride(stride) {
+        : _data(data.release()), _ptr(_data.get()), _length(length), _stride(stride) {}
+    VectorData(const unsigned char* data, size_t length, size_t stride = 1,
+               std::pmr::memory_resource* resource = currentMathResource())
+        : _data(allocateBuffer(stride * sizeof(T) * length, resource)), _ptr(_data.get()), _length(length), _stride(stride) {
         std::copy(data, data + stride * sizeof(T) * length, _data.get());
     }
 
-    VectorData(size_t size) : _length(size), _stride(1) {
-        _data = std::make_unique<unsigned char[]>(size * sizeof(T));
+    VectorData(size_t size, std::pmr::memory_resource* resource = currentMathResource())
+        : VectorData(size, resource, UninitializedTag{}) {
+        std::fill(_ptr, _ptr + size * sizeof(T), 0);
     }
-    VectorData(const std::vector<T>& vec) : VectorData(vec.size()) {
-        for (size_t i = 0; i < vec.size(); ++i) {
-            set(i, vec[i]);
+    VectorData(const std::vector<T>& vec, std::pmr::memory_resource* resource = currentMathResource())
+        : VectorData(vec.size(), resource, UninitializedTag{}) {
+        std::copy(vec.begin(), vec.end(), data());
+    }
+
+    // Materialises a vector expression: one allocation, one fused loop.
+    template <VectorExpression E>
+        requires std::is_same_v<typename E::value_type, T>
+    VectorData(const E& expr) : VectorData(expr.length(), currentMathResource(), UninitializedTag{}) {
+        T* out = data();
+        for (size_t i = 0; i < _length; ++i) {
+            out[i] = expr[i];
         }
     }
 
-    VectorData(const VectorData& other): _length(other._length), _stride(other._stride) {
-        // Calculate total bytes
-        size_t total_bytes = other.byteSize() * other.length();
+    // Non-owning vector over memory someone else keeps alive, e.g. a matrix
+    // row. Reads and writes go straight to that memory; copying a borrowed
+    // VectorData produces an owning copy, moving it keeps the borrow.
+    static VectorData borrow(T* data, size_t length, size_t stride = 1) {
+        return VectorData(reinterpret_cast<unsigned char*>(data), length, stride, BorrowTag{});
+    }
+    bool borrowed() const { return _data == nullptr && _ptr != nullptr; }
+    // Where the owned buffer came from; null when borrowed or adopted from a unique_ptr.
+    std::pmr::memory_resource* resource() const { return _data ? _data.get_deleter().resource : nullptr; }
 
-        // Allocate new array on the heap
-        _data = std::make_unique<unsigned char[]>(total_bytes);
+    // Zero-copy view of the elements, honouring the stride.
+    VectorDataView<T> view() { return VectorDataView<T>(data(), _length, _stride); }
+    VectorDataView<const T> view() const { return VectorDataView<const T>(data(), _length, _stride); }
 
-        // Copy data from the other object
-        std::copy(other._data.get(), other._data.get() + total_bytes, _data.get());
-    }
+    VectorData(const VectorData& other) { copyFrom(other); }
 
     VectorData& operator=(const VectorData& other) {
         if (this != &other) {
-            _length = other._length;
-            _stride = other._stride;
-
-            // Calculate total bytes
-            size_t total_bytes = byteSize() * _length;
+            copyFrom(other);
+        }
+        return *this;
+    }
 
-            // Allocate new array on the heap
-            _data = std::make_unique<unsigned char[]>(total_bytes);
+    VectorData(VectorData&& other) noexcept
+        : _data(std::move(other._data)), _ptr(other._ptr), _length(other._length), _stride(other._stride) {
+        other._ptr = nullptr;
+        other._length = 0;
+    }
 
-            // Copy data from the other object
-            std::copy(other._data.get(), other._data.get() + total_bytes, _data.get());
+    VectorData& operator=(VectorData&& other) noexcept {
+        if (this != &other) {
+            _data = std::move(other._data);
+            _ptr = other._ptr;
+            _length = other._length;
+            _stride = other._stride;
+            other._ptr = nullptr;
+            other._length = 0;
         }
         return *this;
     }
@@ -57,11 +94,34 @@ public:
     const size_t length() const { return _length; };
     const size_t stride() const { return _stride; };
     const size_t byteSize() const { return _stride * sizeof(T); };
+    // First element; element i lives at data()[i * stride()].
+    T* data() { return reinterpret_cast<T*>(_ptr); }
+    const T* data() const { return reinterpret_cast<const T*>(_ptr); }
 
+    // A strided borrow is gathered into a zeroed stride-1 buffer, since only
+    // (length - 1) * stride + 1 of its elements are guaranteed to exist.
     void resize(size_t new_length) {
-        std::unique_ptr<unsigned char[]> new_data = std::make_unique<unsigned char[]>(byteSize() * new_length);
-        std::copy(_data.get(), _data.get() + std::min(_length, new_length) * byteSize(), new_data.get());
+        std::pmr::memory_resource* from = resource() ? resource() : currentMathResource();
+        if (borrowed() && _stride != 1) {
+            Buffer gathered = allocateBuffer(new_length * sizeof(T), from);
+            T* dst = reinterpret_cast<T*>(gathered.get());
+            const T* src = data();
+            size_t kept = std::min(_length, new_length);
+            for (size_t idx = 0; idx < kept; ++idx) {
+                dst[idx] = src[idx * _stride];
+            }
+            std::fill(dst + kept, dst + new_length, T{});
+            _data = std::move(gathered);
+            _ptr = _data.get();
+            _length = new_length;
+            _stride = 1;
+            return;
+        }
+        Buffer new_data = allocateBuffer(byteSize() * new_length, from);
+        std::fill(new_data.get(), new_data.get() + byteSize() * new_length, 0);
+        std::copy(_ptr, _ptr + std::min(_length, new_length) * byteSize(), new_data.get());
         _data = std::move(new_data);
+        _ptr = _data.get();
         _length = new_length;
     }
 
@@ -129,101 +189,179 @@ public:
             throw std::out_of_range("Index out of bounds.");
         }
         size_t start_idx = idx * byteSize();
-        return *reinterpret_cast<const T*>(_data.get() + start_idx);
+        return *reinterpret_cast<const T*>(_ptr + start_idx);
     }
 
     void set(size_t idx, T val) {
         if (idx >= _length) {
             throw std::out_of_range("Index out of bounds.");
         }
-        *reinterpret_cast<T*>(&_data[idx * byteSize()]) = val;
+        *reinterpret_cast<T*>(&_ptr[idx * byteSize()]) = val;
     }
 
-    // Arithmetic
+    // Arithmetic. Contiguous float/double data goes through the SIMD
+    // kernels in vector_kernels.hpp; everything else walks the elements.
     T sum() const {
+        if constexpr (vector_kernels::supports<T>) {
+            if (_stride == 1) return vector_kernels::sum(data(), _length);
+        }
         T total = 0;
-        for(auto it = begin(); it != end(); ++it) {
-            total += *it;
+        const T* src = data();
+        for (size_t idx = 0; idx < _length; ++idx) {
+            total += src[idx * _stride];
         }
         return total;
     }
 
     template<typename F>
     VectorData binary_op(T constant, F op) const {
-        size_t step_size = byteSize();
-        std::unique_ptr<unsigned char[]> new_data = std::make_unique<unsigned char[]>(step_size * _length);
+        VectorData result(_length * _stride, currentMathResource());
+        result._length = _length;
+        result._stride = _stride;
+        const T* src = data();
+        T* dst = result.data();
         for(size_t idx = 0; idx < _length; ++idx) {
-            *reinterpret_cast<T*>(&new_data[idx*step_size]) = op(get(idx), constant);
+            dst[idx * _stride] = op(src[idx * _stride], constant);
         }
-        return VectorData(std::move(new_data), _length, _stride);
+        return result;
+    }
+    template<typename F>
+    VectorData binary_op(T constant, VectorOp kind, F op) const {
+        if constexpr (vector_kernels::supports<T>) {
+            if (_stride == 1) {
+                VectorData result(_length, currentMathResource(), UninitializedTag{});
+                vector_kernels::binaryScalar(kind, data(), constant, result.data(), _length);
+                return result;
+            }
+        }
+        return binary_op(constant, op);
     }
 
     template<typename F>
-    void binary_op_inplace(T constant, F op) {
-        size_t step_size = byteSize();
+    void binary_op_inplace(T constant, VectorOp kind, F op) {
+        if constexpr (vector_kernels::supports<T>) {
+            if (_stride == 1) {
+                vector_kernels::binaryScalar(kind, data(), constant, data(), _length);
+                return;
+            }
+        }
+        T* dst = data();
         for(size_t idx = 0; idx < _length; ++idx) {
-            *reinterpret_cast<T*>(&_data[idx*step_size]) = op(get(idx), constant);
+            dst[idx * _stride] = op(dst[idx * _stride], constant);
         }
     }
 
-    #define DEFINE_BINARY_OP(OP, FUNC) \
+    #define DEFINE_BINARY_OP(OP, KIND, FUNC) \
         VectorData operator OP(T constant) const { \
-            return binary_op(constant, FUNC); \
+            return binary_op(constant, KIND, FUNC); \
         }
-    #define DEFINE_BINARY_OP_INPLACE(OP, FUNC) \
+    #define DEFINE_BINARY_OP_INPLACE(OP, KIND, FUNC) \
         void operator OP(T constant) { \
-            binary_op_inplace(constant, FUNC); \
+            binary_op_inplace(constant, KIND, FUNC); \
         }
 
-    DEFINE_BINARY_OP(+, [](T a, T b) { return a + b; })
-    DEFINE_BINARY_OP(-, [](T a, T b) { return a - b; })
-    DEFINE_BINARY_OP(*, [](T a, T b) { return a * b; })
-    DEFINE_BINARY_OP(/, [](T a, T b) { return a / b; })
-    DEFINE_BINARY_OP(%, [](T a, T b) { return a % b; })
+    DEFINE_BINARY_OP(+, VectorOp::Add, [](T a, T b) { return a + b; })
+    DEFINE_BINARY_OP(-, VectorOp::Sub, [](T a, T b) { return a - b; })
+    DEFINE_BINARY_OP(*, VectorOp::Mul, [](T a, T b) { return a * b; })
+    DEFINE_BINARY_OP(/, VectorOp::Div, [](T a, T b) { return a / b; })
+    VectorData operator%(T constant) const { return binary_op(constant, [](T a, T b) { return a % b; }); }
 
-    DEFINE_BINARY_OP_INPLACE(+=, [](T a, T b) { return a + b; })
-    DEFINE_BINARY_OP_INPLACE(-=, [](T a, T b) { return a - b; })
-    DEFINE_BINARY_OP_INPLACE(*=, [](T a, T b) { return a * b; })
-    DEFINE_BINARY_OP_INPLACE(/=, [](T a, T b) { return a / b; })
+    DEFINE_BINARY_OP_INPLACE(+=, VectorOp::Add, [](T a, T b) { return a + b; })
+    DEFINE_BINARY_OP_INPLACE(-=, VectorOp::Sub, [](T a, T b) { return a - b; })
+    DEFINE_BINARY_OP_INPLACE(*=, VectorOp::Mul, [](T a, T b) { return a * b; })
+    DEFINE_BINARY_OP_INPLACE(/=, VectorOp::Div, [](T a, T b) { return a / b; })
 
     #undef DEFINE_BINARY_OP_INPLACE
     #undef DEFINE_BINARY_OP
 
+    // Element-wise; each builds its result in a single pass.
     VectorData operator+(const VectorData& other) const {
-        if (_length != other._length) {
-            throw std::length_error("Vectors must be the same length for addition.");
-        }
-        VectorData sum = VectorData(*this);
-        for(size_t i = 0; i < length(); i++) {
-            sum.set(i, get(i) + other.get(i));
-        }
-        return sum;
+        return elementwise<std::plus<>>(other, VectorOp::Add, "addition");
+    }
+    VectorData operator-(const VectorData& other) const {
+        return elementwise<std::minus<>>(other, VectorOp::Sub, "subtraction");
     }
-    VectorData operator-(const VectorData& other) const { return operator+(other * -1); }
-
     VectorData operator*(const VectorData& other) const {
+        return elementwise<std::multiplies<>>(other, VectorOp::Mul, "multiplication");
+    }
+    VectorData operator/(const VectorData& other) const {
+        return elementwise<std::divides<>>(other, VectorOp::Div, "division");
+    }
+
+private:
+    template <typename Op>
+    VectorData elementwise(const VectorData& other, VectorOp kind, const char* what) const {
         if (_length != other._length) {
-            throw std::length_error("Vectors must be the same length for multiplication.");
+            throw std::length_error(std::string("Vectors must be the same length for ") + what + ".");
         }
-        VectorData prod = VectorData(*this);
-        for(size_t i = 0; i < length(); i++) {
-            prod.set(i, get(i) * other.get(i));
+        if constexpr (vector_kernels::supports<T>) {
+            if (_stride == 1 && other._stride == 1) {
+                VectorData result(_length, currentMathResource(), UninitializedTag{});
+                vector_kernels::binary(kind, data(), other.data(), result.data(), _length);
+                return result;
+            }
         }
-        return prod;
+        return VectorData(VectorBinaryExpr<VectorExprRef<T>, VectorExprRef<T>, Op>(
+            VectorExprRef<T>(*this), VectorExprRef<T>(other)));
     }
-    VectorData operator/(const VectorData& other) const {
-        if (_length != other._length) {
-            throw std::length_error("Vectors must be the same length for division.");
+
+    // An owned buffer holds stride * length elements and is copied whole. A
+    // borrow only guarantees (length - 1) * stride + 1 of them, so it is
+    // gathered into a compact stride-1 buffer instead.
+    void copyFrom(const VectorData& other) {
+        if (other.borrowed() && other._stride != 1) {
+            Buffer copy = allocateBuffer(other._length * sizeof(T), currentMathResource());
+            T* dst = reinterpret_cast<T*>(copy.get());
+            const T* src = other.data();
+            for (size_t idx = 0; idx < other._length; ++idx) {
+                dst[idx] = src[idx * other._stride];
+            }
+            _data = std::move(copy);
+            _stride = 1;
+        } else {
+            size_t total_bytes = other.byteSize() * other._length;
+            Buffer copy = allocateBuffer(total_bytes, currentMathResource());
+            std::copy(other._ptr, other._ptr + total_bytes, copy.get());
+            _data = std::move(copy);
+            _stride = other._stride;
         }
-        VectorData prod = VectorData(*this);
-        for(size_t i = 0; i < length(); i++) {
-            prod.set(i, get(i) / other.get(i));
+        _ptr = _data.get();
+        _length = other._length;
+    }
+
+    static constexpr size_t kBufferAlignment = alignof(std::max_align_t);
+
+    // Frees with the resource the buffer came from; a null resource means
+    // the buffer was adopted from a std::unique_ptr<unsigned char[]>.
+    struct BufferDeleter {
+        std::pmr::memory_resource* resource = nullptr;
+        size_t bytes = 0;
+        void operator()(unsigned char* ptr) const {
+            if (resource) {
+                resource->deallocate(ptr, bytes, kBufferAlignment);
+            } else {
+                delete[] ptr;
+            }
         }
-        return prod;
+    };
+    using Buffer = std::unique_ptr<unsigned char[], BufferDeleter>;
+
+    static Buffer allocateBuffer(size_t bytes, std::pmr::memory_resource* resource) {
+        return Buffer(static_cast<unsigned char*>(resource->allocate(bytes, kBufferAlignment)),
+                      BufferDeleter{resource, bytes});
     }
 
-private:
-    std::unique_ptr<unsigned char[]> _data;
+    // For results that are overwritten right away.
+    struct UninitializedTag {};
+    VectorData(size_t size, std::pmr::memory_resource* resource, UninitializedTag)
+        : _data(allocateBuffer(size * sizeof(T), resource)), _ptr(_data.get()), _length(size), _stride(1) {}
+
+    struct BorrowTag {};
+    VectorData(unsigned char* data, size_t length, size_t stride, BorrowTag)
+        : _ptr(data), _length(length), _stride(stride) {}
+
+    Buffer _data; // null when borrowed
+    unsigned char* _ptr = nullptr;
     size_t _length;
     size_t _stride;
 };
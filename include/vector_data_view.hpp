@@ -0,0 +1,127 @@
+#pragma once
+
+#include "vector_expr.hpp"
+#include "vector_kernels.hpp"
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+
+// Random-access iterator stepping stride elements at a time.
+template <typename T>
+class StridedIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type   = std::ptrdiff_t;
+    using value_type        = std::remove_const_t<T>;
+    using pointer           = T*;
+    using reference         = T&;
+
+    StridedIterator() = default;
+    StridedIterator(T* ptr, std::size_t stride) : _ptr(ptr), _stride(static_cast<difference_type>(stride)) {}
+
+    reference operator*() const { return *_ptr; }
+    pointer operator->() const { return _ptr; }
+    reference operator[](difference_type n) const { return _ptr[n * _stride]; }
+
+    StridedIterator& operator++() { _ptr += _stride; return *this; }
+    StridedIterator operator++(int) { StridedIterator tmp = *this; _ptr += _stride; return tmp; }
+    StridedIterator& operator--() { _ptr -= _stride; return *this; }
+    StridedIterator operator--(int) { StridedIterator tmp = *this; _ptr -= _stride; return tmp; }
+    StridedIterator& operator+=(difference_type n) { _ptr += n * _stride; return *this; }
+    StridedIterator& operator-=(difference_type n) { _ptr -= n * _stride; return *this; }
+    friend StridedIterator operator+(StridedIterator it, difference_type n) { return it += n; }
+    friend StridedIterator operator+(difference_type n, StridedIterator it) { return it += n; }
+    friend StridedIterator operator-(StridedIterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const StridedIterator& a, const StridedIterator& b) {
+        return (a._ptr - b._ptr) / a._stride;
+    }
+    friend bool operator==(const StridedIterator& a, const StridedIterator& b) { return a._ptr == b._ptr; }
+    friend auto operator<=>(const StridedIterator& a, const StridedIterator& b) { return a._ptr <=> b._ptr; }
+
+private:
+    T* _ptr = nullptr;
+    difference_type _stride = 1;
+};
+
+// Non-owning window onto length elements spaced stride apart, e.g. a matrix
+// column or every Nth element of a VectorData. Nothing is copied: reads and
+// writes go to the underlying memory, which must outlive the view. Use
+// VectorDataView<const T> for read-only access.
+template <typename T>
+class VectorDataView {
+public:
+    using value_type = std::remove_const_t<T>;
+    using iterator = StridedIterator<T>;
+
+    VectorDataView() = default;
+    VectorDataView(T* data, std::size_t length, std::size_t stride = 1)
+        : _ptr(data), _length(length), _stride(stride) {}
+    // A mutable view converts to a read-only one.
+    template <typename U>
+        requires(std::is_const_v<T> && std::is_same_v<const U, T>)
+    VectorDataView(const VectorDataView<U>& other) : VectorDataView(other.data(), other.length(), other.stride()) {}
+
+    std::size_t length() const { return _length; }
+    std::size_t size() const { return _length; }
+    std::size_t stride() const { return _stride; }
+    bool empty() const { return _length == 0; }
+    T* data() const { return _ptr; }
+
+    T& operator[](std::size_t idx) const { return _ptr[idx * _stride]; }
+    T& get(std::size_t idx) const {
+        if (idx >= _length) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        return _ptr[idx * _stride];
+    }
+    void set(std::size_t idx, value_type val) const requires(!std::is_const_v<T>) { get(idx) = val; }
+
+    iterator begin() const { return iterator(_ptr, _stride); }
+    iterator end() const { return iterator(_ptr + _length * _stride, _stride); }
+
+    // count elements starting at first, taking every step-th one.
+    VectorDataView slice(std::size_t first, std::size_t count, std::size_t step = 1) const {
+        if (count > 0 && first + (count - 1) * step >= _length) {
+            throw std::out_of_range("Slice out of bounds.");
+        }
+        return VectorDataView(_ptr + first * _stride, count, _stride * step);
+    }
+
+    value_type sum() const {
+        if constexpr (vector_kernels::supports<value_type>) {
+            if (_stride == 1) return vector_kernels::sum(_ptr, _length);
+        }
+        value_type total = 0;
+        for (std::size_t i = 0; i < _length; i++) total += (*this)[i];
+        return total;
+    }
+    value_type dot(VectorDataView<const value_type> other) const {
+        if (_length != other.length()) {
+            throw std::length_error("Vectors must be the same length for dot product.");
+        }
+        if constexpr (vector_kernels::supports<value_type>) {
+            if (_stride == 1 && other.stride() == 1) return vector_kernels::dot(_ptr, other.data(), _length);
+        }
+        value_type total = 0;
+        for (std::size_t i = 0; i < _length; i++) total += (*this)[i] * other[i];
+        return total;
+    }
+
+    // Writes an expression (or another vector) into the viewed elements.
+    template <typename E>
+        requires(!std::is_const_v<T> && VectorOperand<E>)
+    void assign(const E& source) const {
+        const auto& expr = asVectorExpr(source);
+        if (expr.length() != _length) {
+            throw std::length_error("Vectors must be the same length for assignment.");
+        }
+        for (std::size_t i = 0; i < _length; i++) (*this)[i] = expr[i];
+    }
+
+private:
+    T* _ptr = nullptr;
+    std::size_t _length = 0;
+    std::size_t _stride = 1;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+
+// Lazy element-wise expressions over VectorData / VectorND / VectorDataView.
+//
+// asVectorExpr(a) + b * 2 builds a small tree of nodes instead of a
+// VectorData per operator; nothing is computed until the tree is converted
+// to a VectorData or VectorND (or reduced with sum()), which allocates the
+// result once and fills it in one fused loop. Nodes keep references to
+// their leaf vectors, so an expression must not outlive the vectors it was
+// built from: assign it (or call eval()) in the same statement rather than
+// storing it in an auto variable.
+//
+// Because of that, only expressions and views build nodes on their own.
+// VectorData and VectorND operators return evaluated vectors as they always
+// have, so auto r = a + b is a copy; they join an expression when the other
+// operand already is one. asVectorExpr() opts a vector in.
+
+template <typename T>
+class VectorData;
+template <typename T>
+class VectorND;
+template <typename T>
+class VectorDataView;
+
+struct VectorExprBase {};
+
+template <typename E>
+concept VectorExpression = std::is_base_of_v<VectorExprBase, E>;
+
+// Shared interface of every node: Derived provides length() and an
+// unchecked operator[].
+template <typename Derived, typename T>
+class VectorExpr : public VectorExprBase {
+public:
+    using value_type = T;
+
+    size_t size() const { return self().length(); }
+    T get(size_t idx) const {
+        if (idx >= self().length()) {
+            throw std::out_of_range("Index out of bounds.");
+        }
+        return self()[idx];
+    }
+    T sum() const {
+        T total = 0;
+        for (size_t i = 0; i < self().length(); i++) {
+            total += self()[i];
+        }
+        return total;
+    }
+    VectorData<T> eval() const { return VectorData<T>(self()); }
+
+private:
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+// Leaf: reads a VectorData or VectorDataView in place, honouring its stride.
+template <typename T>
+class VectorExprRef : public VectorExpr<VectorExprRef<T>, T> {
+public:
+    explicit VectorExprRef(const VectorData<T>& data)
+        : _ptr(data.data()), _length(data.length()), _stride(data.stride()) {}
+    VectorExprRef(const T* ptr, size_t length, size_t stride) : _ptr(ptr), _length(length), _stride(stride) {}
+
+    size_t length() const { return _length; }
+    T operator[](size_t idx) const { return _ptr[idx * _stride]; }
+
+private:
+    const T* _ptr;
+    size_t _length;
+    size_t _stride;
+};
+
+template <typename L, typename R, typename Op>
+class VectorBinaryExpr : public VectorExpr<VectorBinaryExpr<L, R, Op>, typename L::value_type> {
+public:
+    VectorBinaryExpr(const L& lhs, const R& rhs) : _lhs(lhs), _rhs(rhs) {
+        if (lhs.length() != rhs.length()) {
+            throw std::length_error("Vectors must be the same length.");
+        }
+    }
+
+    size_t length() const { return _lhs.length(); }
+    typename L::value_type operator[](size_t idx) const { return Op{}(_lhs[idx], _rhs[idx]); }
+
+private:
+    L _lhs;
+    R _rhs;
+};
+
+// Element op scalar; ScalarFirst flips the operands for scalar op element.
+template <typename L, typename Op, bool ScalarFirst = false>
+class VectorScalarExpr : public VectorExpr<VectorScalarExpr<L, Op, ScalarFirst>, typename L::value_type> {
+public:
+    using T = typename L::value_type;
+    VectorScalarExpr(const L& lhs, T scalar) : _lhs(lhs), _scalar(scalar) {}
+
+    size_t length() const { return _lhs.length(); }
+    T operator[](size_t idx) const {
+        if constexpr (ScalarFirst) {
+            return Op{}(_scalar, _lhs[idx]);
+        } else {
+            return Op{}(_lhs[idx], _scalar);
+        }
+    }
+
+private:
+    L _lhs;
+    T _scalar;
+};
+
+template <typename T>
+VectorExprRef<T> asVectorExpr(const VectorData<T>& data) { return VectorExprRef<T>(data); }
+template <typename T>
+VectorExprRef<T> asVectorExpr(const VectorND<T>& vec) { return VectorExprRef<T>(vec.vectorData()); }
+template <typename T>
+VectorExprRef<std::remove_const_t<T>> asVectorExpr(const VectorDataView<T>& view) {
+    return VectorExprRef<std::remove_const_t<T>>(view.data(), view.length(), view.stride());
+}
+template <VectorExpression E>
+const E& asVectorExpr(const E& expr) { return expr; }
+
+template <typename A>
+concept VectorOperand = requires(const A& a) { asVectorExpr(a); };
+
+template <typename A>
+inline constexpr bool isVectorDataView = false;
+template <typename T>
+inline constexpr bool isVectorDataView<VectorDataView<T>> = true;
+
+// Operands that build nodes by themselves; VectorData and VectorND only join
+// a node next to one of these (their own operators evaluate).
+template <typename A>
+concept LazyLeaf = VectorExpression<A> || isVectorDataView<A>;
+
+template <typename A, typename B>
+concept LazyVectorOperands = VectorOperand<A> && VectorOperand<B> && (LazyLeaf<A> || LazyLeaf<B>);
+
+template <typename A, typename B, typename Op>
+auto makeVectorBinaryExpr(const A& a, const B& b) {
+    using L = std::remove_cvref_t<decltype(asVectorExpr(a))>;
+    using R = std::remove_cvref_t<decltype(asVectorExpr(b))>;
+    static_assert(std::is_same_v<typename L::value_type, typename R::value_type>,
+                  "Vector expressions must share an element type");
+    return VectorBinaryExpr<L, R, Op>(asVectorExpr(a), asVectorExpr(b));
+}
+
+template <typename A, typename Op, bool ScalarFirst = false>
+auto makeVectorScalarExpr(const A& a, typename std::remove_cvref_t<decltype(asVectorExpr(a))>::value_type s) {
+    using L = std::remove_cvref_t<decltype(asVectorExpr(a))>;
+    return VectorScalarExpr<L, Op, ScalarFirst>(asVectorExpr(a), s);
+}
+
+template <typename A>
+concept LazyScalarOperand = VectorOperand<A> && LazyLeaf<A>;
+
+template <typename A>
+using VectorValueType = typename std::remove_cvref_t<decltype(asVectorExpr(std::declval<const A&>()))>::value_type;
+
+#define DEFINE_VECTOR_EXPR_OP(OP, FUNC) \
+    template <typename A, typename B> requires LazyVectorOperands<A, B> \
+    auto operator OP(const A& a, const B& b) { return makeVectorBinaryExpr<A, B, FUNC>(a, b); } \
+    template <typename A> requires LazyScalarOperand<A> \
+    auto operator OP(const A& a, std::type_identity_t<VectorValueType<A>> s) { \
+        return makeVectorScalarExpr<A, FUNC>(a, s); \
+    } \
+    template <typename A> requires LazyScalarOperand<A> \
+    auto operator OP(std::type_identity_t<VectorValueType<A>> s, const A& a) { \
+        return makeVectorScalarExpr<A, FUNC, true>(a, s); \
+    }
+
+DEFINE_VECTOR_EXPR_OP(+, std::plus<>)
+DEFINE_VECTOR_EXPR_OP(-, std::minus<>)
+DEFINE_VECTOR_EXPR_OP(*, std::multiplies<>)
+DEFINE_VECTOR_EXPR_OP(/, std::divides<>)
+
+#undef DEFINE_VECTOR_EXPR_OP
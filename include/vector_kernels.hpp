@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+
+// Element-wise and reduction kernels for contiguous float/double data, used
+// by VectorData and VectorND whenever the stride is 1. Each entry point runs
+// the widest instruction set the CPU supports (detected once with cpuid);
+// pass a lower level to force a narrower path, e.g. to compare against the
+// scalar loop. Strided data keeps going through the generic element loop.
+
+enum class SimdLevel { Scalar, SSE, AVX2, AVX512 };
+
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+enum class VectorOp { Add, Sub, Mul, Div };
+
+namespace vector_kernels {
+
+template <typename T>
+inline constexpr bool supports = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+// out[i] = a[i] op b[i]; out may alias a or b.
+void binary(VectorOp op, const float* a, const float* b, float* out, std::size_t n, SimdLevel level = detectSimdLevel());
+void binary(VectorOp op, const double* a, const double* b, double* out, std::size_t n, SimdLevel level = detectSimdLevel());
+// out[i] = a[i] op s; out may alias a.
+void binaryScalar(VectorOp op, const float* a, float s, float* out, std::size_t n, SimdLevel level = detectSimdLevel());
+void binaryScalar(VectorOp op, const double* a, double s, double* out, std::size_t n, SimdLevel level = detectSimdLevel());
+
+// Reductions accumulate in vector lanes, so the rounding differs slightly
+// from a left-to-right scalar sum.
+float sum(const float* a, std::size_t n, SimdLevel level = detectSimdLevel());
+double sum(const double* a, std::size_t n, SimdLevel level = detectSimdLevel());
+float dot(const float* a, const float* b, std::size_t n, SimdLevel level = detectSimdLevel());
+double dot(const double* a, const double* b, std::size_t n, SimdLevel level = detectSimdLevel());
+float distanceSquared(const float* a, const float* b, std::size_t n, SimdLevel level = detectSimdLevel());
+double distanceSquared(const double* a, const double* b, std::size_t n, SimdLevel level = detectSimdLevel());
+
+}
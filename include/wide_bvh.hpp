@@ -0,0 +1,169 @@
+#pragma once
+
+#include "bvh.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+
+// Wide BVH node: the bounds of up to Width children as one array per
+// coordinate, so a single SIMD slab test covers every child. A child slot is
+// either another node (count 0, child is its node index), a leaf (count > 0,
+// child is the first entry of the binary BVH's leaf order) or unused
+// (count kEmptySlot). Nodes are aligned to cache lines: a BVH4 node is two
+// lines, a BVH8 node four.
+template <int Width>
+struct alignas(64) WideNode {
+    static constexpr std::uint32_t kEmptySlot = std::numeric_limits<std::uint32_t>::max();
+
+    float minX[Width], minY[Width], minZ[Width];
+    float maxX[Width], maxY[Width], maxZ[Width];
+    std::uint32_t child[Width];
+    std::uint32_t count[Width];
+
+    AABB bounds(int slot) const {
+        return AABB(minX[slot], minY[slot], minZ[slot], maxX[slot], maxY[slot], maxZ[slot]);
+    }
+    void setBounds(int slot, const AABB& box) {
+        minX[slot] = box.min[0];
+        minY[slot] = box.min[1];
+        minZ[slot] = box.min[2];
+        maxX[slot] = box.max[0];
+        maxY[slot] = box.max[1];
+        maxZ[slot] = box.max[2];
+    }
+};
+
+static_assert(sizeof(WideNode<4>) == 128 && sizeof(WideNode<8>) == 256);
+
+namespace wide_bvh_detail {
+
+// Bit per child slot the single-ray traversal would enter (see
+// bvh_detail::closestLeafHit: the line crosses the box for some t in
+// [tMin, tMax] and the box is no farther than bestDistSq), with each child's
+// squared distance in distSq. BVH4 nodes use SSE, BVH8 nodes AVX2 when the
+// CPU has it.
+std::uint32_t enterMask(const WideNode<4>& node, const float origin[3], const float invDir[3], float tMin, float tMax,
+                        float bestDistSq, float distSq[4]);
+std::uint32_t enterMask(const WideNode<8>& node, const float origin[3], const float invDir[3], float tMin, float tMax,
+                        float bestDistSq, float distSq[8]);
+
+}
+
+// A binary BVH collapsed into a Width-ary tree stored as one flat, cache-line
+// aligned node array. Leaves stay the binary tree's leaves, so a wide BVH
+// shares its indices() and any data kept in its leaf order. Each interior
+// node pulls up the largest-area grandchildren until it has Width children.
+template <int Width>
+class WideBVH {
+public:
+    using Node = WideNode<Width>;
+
+    WideBVH() {}
+    explicit WideBVH(const BVH& bvh);
+
+    bool empty() const { return _nodes.empty(); }
+    const std::vector<Node>& nodes() const { return _nodes; }
+
+    // Copies the bounds of the given nodes of bvh, the tree this one was
+    // collapsed from, e.g. the nodes BVH::refit() returned.
+    void refit(const BVH& bvh, const std::vector<std::uint32_t>& binaryNodes);
+
+    // bvh_detail::closestLeafHit() over the wide tree: the same leaf callback,
+    // the same pruning, and the same result. Children are visited near to far.
+    template <typename Leaf>
+    void closestLeafHit(const Ray& ray, std::optional<PrimitiveHit>& best, Leaf&& leaf) const;
+    // bvh_detail::anyLeafHit() over the wide tree.
+    template <typename Leaf>
+    bool anyLeafHit(const Ray& ray, float tMin, float tMax, Leaf&& leaf) const;
+
+private:
+    std::uint32_t collapse(const std::vector<BVH::Node>& binary, std::uint32_t binaryIdx);
+
+    std::vector<Node> _nodes;
+    // Per binary node, node * Width + slot of the slot holding its bounds,
+    // or kNoSlot for the interior nodes that were collapsed away.
+    static constexpr std::uint32_t kNoSlot = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> _slotOf;
+};
+
+
+template <int Width>
+template <typename Leaf>
+void WideBVH<Width>::closestLeafHit(const Ray& ray, std::optional<PrimitiveHit>& best, Leaf&& leaf) const {
+    if (empty()) return;
+    const float origin[3] = {ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    const float invDir[3] = {1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z()};
+    const float dirLengthSq = ray.direction.lengthSquared();
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    float bestDistSq = best ? best->t * best->t * dirLengthSq * (1 + 1e-5f) : inf;
+
+    // A node pushes at most Width - 1 entries more than it pops, and trees are
+    // at most BVH::kMaxDepth levels deep like the binary traversal assumes.
+    struct Entry {
+        std::uint32_t child;
+        std::uint32_t count;
+        float distSq;
+    };
+    Entry stack[(Width - 1) * BVH::kMaxDepth + 1];
+    int top = 0;
+    stack[top++] = {0, 0, 0.0f};
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        // The bound may have shrunk since the entry was pushed.
+        if (entry.distSq > bestDistSq) continue;
+        if (entry.count > 0) {
+            leaf(entry.child, entry.count, best);
+            // Slightly loose so rounding never prunes an equally close hit.
+            if (best) bestDistSq = best->t * best->t * dirLengthSq * (1 + 1e-5f);
+            continue;
+        }
+
+        const Node& node = _nodes[entry.child];
+        float distSq[Width];
+        std::uint32_t mask = wide_bvh_detail::enterMask(node, origin, invDir, -inf, inf, bestDistSq, distSq);
+        // Push far to near so the nearest child is popped first.
+        const int base = top;
+        for (; mask != 0; mask &= mask - 1) {
+            int slot = std::countr_zero(mask);
+            Entry child{node.child[slot], node.count[slot], distSq[slot]};
+            int i = top++;
+            for (; i > base && stack[i - 1].distSq < child.distSq; i--) stack[i] = stack[i - 1];
+            stack[i] = child;
+        }
+    }
+}
+
+template <int Width>
+template <typename Leaf>
+bool WideBVH<Width>::anyLeafHit(const Ray& ray, float tMin, float tMax, Leaf&& leaf) const {
+    if (empty()) return false;
+    const float origin[3] = {ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    const float invDir[3] = {1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z()};
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    // Slightly loose so rounding never prunes a box holding a counted hit.
+    const float lower = tMin - std::abs(tMin) * 1e-5f;
+    const float upper = tMax + std::abs(tMax) * 1e-5f;
+
+    // Any blocker will do, so children are pushed unsorted and leaves tested
+    // as soon as their node is.
+    std::uint32_t stack[(Width - 1) * BVH::kMaxDepth + 1];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+        float distSq[Width];
+        std::uint32_t mask = wide_bvh_detail::enterMask(node, origin, invDir, lower, upper, inf, distSq);
+        for (; mask != 0; mask &= mask - 1) {
+            int slot = std::countr_zero(mask);
+            if (node.count[slot] == 0) {
+                stack[top++] = node.child[slot];
+            } else if (leaf(node.child[slot], node.count[slot])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+
+ArenaResource::ArenaResource(std::size_t blockSize, std::pmr::memory_resource* upstream)
+    : _upstream(upstream), _blockSize(std::max<std::size_t>(blockSize, 64)) {}
+
+ArenaResource::~ArenaResource() { release(); }
+
+void ArenaResource::reset() {
+    _used = 0;
+    if (_blocks.empty()) return;
+    enterBlock(0);
+}
+
+void ArenaResource::release() {
+    for (const Block& block : _blocks) {
+        _upstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+    }
+    _blocks.clear();
+    _current = 0;
+    _cursor = _end = nullptr;
+    _used = 0;
+}
+
+std::size_t ArenaResource::capacity() const {
+    std::size_t total = 0;
+    for (const Block& block : _blocks) total += block.size;
+    return total;
+}
+
+void ArenaResource::enterBlock(std::size_t idx) {
+    _current = idx;
+    _cursor = _blocks[idx].data;
+    _end = _cursor + _blocks[idx].size;
+}
+
+void* ArenaResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    for (;;) {
+        if (_cursor != nullptr) {
+            auto address = reinterpret_cast<std::uintptr_t>(_cursor);
+            auto aligned = (address + alignment - 1) & ~std::uintptr_t(alignment - 1);
+            unsigned char* ptr = _cursor + (aligned - address);
+            if (ptr <= _end && bytes <= std::size_t(_end - ptr)) {
+                _used += (ptr + bytes) - _cursor;
+                _cursor = ptr + bytes;
+                return ptr;
+            }
+            // After a reset the blocks kept from earlier tiles come first.
+            if (_current + 1 < _blocks.size()) {
+                _used += _end - _cursor;
+                enterBlock(_current + 1);
+                continue;
+            }
+        }
+        std::size_t size = std::max(_blockSize, bytes + alignment);
+        auto* data = static_cast<unsigned char*>(_upstream->allocate(size, alignof(std::max_align_t)));
+        _blocks.push_back(Block{data, size});
+        if (_cursor != nullptr) _used += _end - _cursor;
+        enterBlock(_blocks.size() - 1);
+    }
+}
+
+namespace {
+thread_local std::pmr::memory_resource* tlsMathResource = nullptr;
+}
+
+std::pmr::memory_resource* currentMathResource() {
+    return tlsMathResource ? tlsMathResource : std::pmr::new_delete_resource();
+}
+
+ScopedMathResource::ScopedMathResource(std::pmr::memory_resource* resource) : _previous(tlsMathResource) {
+    tlsMathResource = resource;
+}
+
+ScopedMathResource::~ScopedMathResource() { tlsMathResource = _previous; }
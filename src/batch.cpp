@@ -0,0 +1,107 @@
+#include "batch.hpp"
+#include "image_io.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+
+std::string framePath(const std::string& pattern, int frame, int frames) {
+    if (pattern.find('%') != std::string::npos) {
+        // Parsed here rather than handed to printf, so only one integer
+        // conversion is ever expanded.
+        std::string path;
+        bool converted = false;
+        for (std::size_t i = 0; i < pattern.size(); i++) {
+            if (pattern[i] != '%') {
+                path += pattern[i];
+                continue;
+            }
+            if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+                path += '%';
+                i++;
+                continue;
+            }
+            std::size_t pos = i + 1;
+            bool zeroPad = pos < pattern.size() && pattern[pos] == '0';
+            if (zeroPad) pos++;
+            std::size_t widthStart = pos;
+            while (pos < pattern.size() && pattern[pos] >= '0' && pattern[pos] <= '9') pos++;
+            if (pos >= pattern.size() || pattern[pos] != 'd' || pos - widthStart > 2 || converted) {
+                throw std::invalid_argument("Output pattern '" + pattern +
+                                            "' may hold one %d, %Nd or %0Nd for the frame number (%% for a literal %)");
+            }
+            std::size_t width = pos > widthStart ? std::stoul(pattern.substr(widthStart, pos - widthStart)) : 0;
+            std::string number = std::to_string(frame);
+            if (number.size() < width) number.insert(frame < 0 && zeroPad ? 1 : 0, width - number.size(), zeroPad ? '0' : ' ');
+            path += number;
+            converted = true;
+            i = pos;
+        }
+        return path;
+    }
+    if (frames <= 1) return pattern;
+
+    std::string number = std::to_string(frame);
+    if (number.size() < 4) number.insert(0, 4 - number.size(), '0');
+    number.insert(0, 1, '_');
+    std::size_t dot = pattern.rfind('.');
+    std::size_t slash = pattern.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return pattern + number;
+    return pattern.substr(0, dot) + number + pattern.substr(dot);
+}
+
+BatchReport renderBatch(Scene& scene, const BatchOptions& options) {
+    const auto start = std::chrono::steady_clock::now();
+    const ImageFormat format = imageFormatFromPath(options.output);
+    const PixelFormat pixels = pixelFormatFor(format);
+    framePath(options.output, 0, options.frames); // rejects a bad pattern before any work
+
+    Renderer renderer(options.settings);
+    BVHBuildOptions bvhOptions = options.bvh;
+    if (!bvhOptions.pool) bvhOptions.pool = &renderer.pool();
+    if (scene.bvh().empty()) scene.buildBVH(bvhOptions);
+    AsyncImageWriter writer(options.maxPendingWrites);
+
+    BatchReport report;
+    for (int frame = 0; frame < options.frames; frame++) {
+        // Stop at the first frame that could not be written.
+        writer.check();
+        Framebuffer buffer = writer.recycle();
+        buffer.resize(options.settings.width, options.settings.height, pixels);
+
+        if (options.animate) {
+            options.animate(scene, frame);
+            auto updateStart = std::chrono::steady_clock::now();
+            report.bvhRebuilds += scene.updateBVH(bvhOptions) == BVHUpdate::Rebuild;
+            report.bvhSeconds += secondsSince(updateStart);
+        }
+
+        auto renderStart = std::chrono::steady_clock::now();
+        renderer.render(scene, buffer);
+        report.renderSeconds += secondsSince(renderStart);
+
+        std::string path = framePath(options.output, frame, options.frames);
+        TRACE(Info, Render, "frame %d rendered, writing %s", frame, path.c_str());
+        writer.submit(std::move(buffer), std::move(path), format);
+
+        Camera& cam = *scene.cam();
+        Vector3D next = cam.position() + options.cameraStep;
+        cam.setPosition(next.x(), next.y(), next.z());
+        report.frames++;
+    }
+    writer.wait();
+
+    report.writeSeconds = writer.busySeconds();
+    report.wallSeconds = secondsSince(start);
+    return report;
+}
@@ -0,0 +1,605 @@
+#include "bvh.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+
+const char* bvhQualityName(BVHQuality quality) {
+    switch (quality) {
+        case BVHQuality::Median: return "median";
+        case BVHQuality::Fast: return "fast";
+        case BVHQuality::Balanced: return "balanced";
+        case BVHQuality::High: return "high";
+    }
+    return "unknown";
+}
+
+BVHQuality bvhQualityFromName(std::string_view name) {
+    for (BVHQuality quality : {BVHQuality::Median, BVHQuality::Fast, BVHQuality::Balanced, BVHQuality::High}) {
+        if (name == bvhQualityName(quality)) return quality;
+    }
+    throw std::invalid_argument("Unknown BVH quality '" + std::string(name) + "'");
+}
+
+
+namespace {
+
+// Splits this deep fall back to the object median, which bounds the depth by
+// 32 + log2(primitives) and keeps traversal within its 64-entry stack.
+constexpr std::uint32_t kMaxSplitDepth = 32;
+// Nodes with more primitives than this are split breadth-first with chunked
+// binning until there are kTopTasks of them; everything below is built as
+// independent subtrees. Both are fixed so the tree never depends on the pool.
+constexpr std::uint32_t kParallelGrain = 1 << 16;
+constexpr std::size_t kTopTasks = 256;
+// Nodes per refit task when a level of the tree is refit in parallel.
+constexpr std::size_t kRefitGrain = 4096;
+constexpr int kMaxBins = 64;
+
+// Plain storage so a split only resets the bins it uses.
+struct Bins {
+    float min[3][kMaxBins][3], max[3][kMaxBins][3];
+    std::uint32_t count[3][kMaxBins];
+
+    void reset(int bins) {
+        constexpr float inf = std::numeric_limits<float>::infinity();
+        for (int axis = 0; axis < 3; axis++) {
+            for (int b = 0; b < bins; b++) {
+                for (int k = 0; k < 3; k++) {
+                    min[axis][b][k] = inf;
+                    max[axis][b][k] = -inf;
+                }
+                count[axis][b] = 0;
+            }
+        }
+    }
+    void add(int axis, int b, const AABB& box, std::uint32_t n = 1) {
+        for (int k = 0; k < 3; k++) {
+            min[axis][b][k] = std::min(min[axis][b][k], box.min[k]);
+            max[axis][b][k] = std::max(max[axis][b][k], box.max[k]);
+        }
+        count[axis][b] += n;
+    }
+    AABB bounds(int axis, int b) const {
+        return AABB(min[axis][b][0], min[axis][b][1], min[axis][b][2], max[axis][b][0], max[axis][b][1], max[axis][b][2]);
+    }
+    void merge(const Bins& other, int bins) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int b = 0; b < bins; b++) add(axis, b, other.bounds(axis, b), other.count[axis][b]);
+        }
+    }
+};
+
+// Spreads the low 10 bits of v three apart, for a 30-bit Morton code.
+std::uint32_t spreadBits(std::uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+class Builder {
+public:
+    Builder(const std::vector<AABB>& bounds, const BVHBuildOptions& options, std::vector<std::uint32_t>& indices)
+        : _bounds(bounds), _options(options), _indices(indices),
+          _bins(std::clamp(options.sahBins, 2, kMaxBins)), _prims(bounds.size()) {}
+
+    std::vector<BVH::Node> build();
+
+private:
+    // Everything a split reads about a primitive, kept in leaf order so
+    // passes over a range stream through memory instead of gathering
+    // through the indices.
+    struct Prim {
+        AABB bounds;
+        float centroid[3];
+        std::uint32_t index;
+    };
+
+    struct Task {
+        std::uint32_t node, first, count, depth;
+        bool morton; // [first, first + count) is sorted by _codes
+    };
+
+    // Runs fn(begin, end) over [first, first + count) in kParallelGrain chunks,
+    // on the pool when parallel is set; returns the chunk count.
+    template <typename Fn>
+    std::size_t forChunks(std::uint32_t first, std::uint32_t count, bool parallel, Fn&& fn);
+
+    AABB centroidBounds(std::uint32_t first, std::uint32_t count, bool parallel);
+    AABB leafBounds(std::uint32_t first, std::uint32_t count) const;
+    // Number of primitives that go to the left child; reorders the range.
+    std::uint32_t split(Task& task, bool parallel);
+    std::uint32_t medianSplit(const Task& task);
+    std::uint32_t sahSplit(const Task& task, bool parallel);
+    std::uint32_t mortonSplit(const Task& task) const;
+    void mortonSort(std::uint32_t first, std::uint32_t count, bool parallel);
+    void buildSubtree(std::vector<BVH::Node>& nodes, std::uint32_t nodeIdx, Task task);
+
+    const std::vector<AABB>& _bounds;
+    const BVHBuildOptions& _options;
+    std::vector<std::uint32_t>& _indices;
+    const int _bins;
+    std::vector<Prim> _prims;
+    std::vector<std::uint32_t> _codes; // Morton code of each position, where sorted
+};
+
+template <typename Fn>
+std::size_t Builder::forChunks(std::uint32_t first, std::uint32_t count, bool parallel, Fn&& fn) {
+    const std::size_t chunks = (count + kParallelGrain - 1) / kParallelGrain;
+    auto run = [&](std::size_t chunk) {
+        std::uint32_t begin = first + static_cast<std::uint32_t>(chunk * kParallelGrain);
+        fn(chunk, begin, std::min(begin + kParallelGrain, first + count));
+    };
+    if (parallel && _options.pool != nullptr && chunks > 1) {
+        _options.pool->parallelFor(chunks, run);
+    } else {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) run(chunk);
+    }
+    return chunks;
+}
+
+AABB Builder::centroidBounds(std::uint32_t first, std::uint32_t count, bool parallel) {
+    if (count <= kParallelGrain) {
+        AABB result;
+        for (std::uint32_t i = first; i < first + count; i++) {
+            const float* c = _prims[i].centroid;
+            result.grow(c[0], c[1], c[2]);
+        }
+        return result;
+    }
+    std::vector<AABB> partial((count + kParallelGrain - 1) / kParallelGrain);
+    forChunks(first, count, parallel, [&](std::size_t chunk, std::uint32_t begin, std::uint32_t end) {
+        for (std::uint32_t i = begin; i < end; i++) {
+            const float* c = _prims[i].centroid;
+            partial[chunk].grow(c[0], c[1], c[2]);
+        }
+    });
+    AABB result;
+    for (const AABB& box : partial) result.grow(box);
+    return result;
+}
+
+AABB Builder::leafBounds(std::uint32_t first, std::uint32_t count) const {
+    AABB result;
+    for (std::uint32_t i = first; i < first + count; i++) result.grow(_prims[i].bounds);
+    return result;
+}
+
+std::uint32_t Builder::split(Task& task, bool parallel) {
+    if (task.depth >= kMaxSplitDepth) return medianSplit(task);
+    if (!task.morton && _options.quality == BVHQuality::Balanced && task.count <= _options.lbvhThreshold) {
+        mortonSort(task.first, task.count, parallel);
+        task.morton = true;
+    }
+    if (task.morton) return mortonSplit(task);
+    return sahSplit(task, parallel);
+}
+
+std::uint32_t Builder::medianSplit(const Task& task) {
+    // A Morton-sorted range is already ordered along the curve.
+    if (task.morton) return task.count / 2;
+    int axis = centroidBounds(task.first, task.count, false).largestAxis();
+    auto first = _prims.begin() + task.first;
+    std::nth_element(first, first + task.count / 2, first + task.count, [&](const Prim& a, const Prim& b) {
+        float ca = a.centroid[axis];
+        float cb = b.centroid[axis];
+        return ca < cb || (ca == cb && a.index < b.index);
+    });
+    return task.count / 2;
+}
+
+std::uint32_t Builder::sahSplit(const Task& task, bool parallel) {
+    const AABB centroids = centroidBounds(task.first, task.count, parallel);
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        scale[axis] = centroids.extent(axis) > 0 ? _bins / centroids.extent(axis) : 0;
+    }
+    auto binOf = [&](const Prim& prim, int axis) {
+        int b = static_cast<int>((prim.centroid[axis] - centroids.min[axis]) * scale[axis]);
+        return std::min(b, _bins - 1);
+    };
+
+    auto fill = [&](Bins& bins, std::uint32_t begin, std::uint32_t end) {
+        bins.reset(_bins);
+        for (std::uint32_t i = begin; i < end; i++) {
+            for (int axis = 0; axis < 3; axis++) bins.add(axis, binOf(_prims[i], axis), _prims[i].bounds);
+        }
+    };
+    Bins local;
+    std::vector<Bins> partial;
+    if (task.count <= kParallelGrain) {
+        fill(local, task.first, task.first + task.count);
+    } else {
+        partial.resize((task.count + kParallelGrain - 1) / kParallelGrain);
+        forChunks(task.first, task.count, parallel, [&](std::size_t chunk, std::uint32_t begin, std::uint32_t end) {
+            fill(partial[chunk], begin, end);
+        });
+        for (std::size_t chunk = 1; chunk < partial.size(); chunk++) partial[0].merge(partial[chunk], _bins);
+    }
+    const Bins& bins = partial.empty() ? local : partial[0];
+
+    // Sweep each axis from both ends; the split after bin b costs
+    // area(left) * count(left) + area(right) * count(right).
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestAxis = -1, bestBin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (scale[axis] == 0) continue;
+        float rightCost[kMaxBins];
+        AABB right;
+        std::uint32_t rightCount = 0;
+        for (int b = _bins - 1; b > 0; b--) {
+            right.grow(bins.bounds(axis, b));
+            rightCount += bins.count[axis][b];
+            rightCost[b] = right.surfaceArea() * rightCount;
+        }
+        AABB left;
+        std::uint32_t leftCount = 0;
+        for (int b = 0; b < _bins - 1; b++) {
+            left.grow(bins.bounds(axis, b));
+            leftCount += bins.count[axis][b];
+            if (leftCount == 0 || leftCount == task.count) continue;
+            float cost = left.surfaceArea() * leftCount + rightCost[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+    // All centroids in one bin on every axis.
+    if (bestAxis < 0) return medianSplit(task);
+
+    auto first = _prims.begin() + task.first;
+    auto middle = std::partition(first, first + task.count,
+                                 [&](const Prim& prim) { return binOf(prim, bestAxis) <= bestBin; });
+    return static_cast<std::uint32_t>(middle - first);
+}
+
+void Builder::mortonSort(std::uint32_t first, std::uint32_t count, bool parallel) {
+    const AABB centroids = centroidBounds(first, count, parallel);
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        scale[axis] = centroids.extent(axis) > 0 ? 1024 / centroids.extent(axis) : 0;
+    }
+    forChunks(first, count, parallel, [&](std::size_t, std::uint32_t begin, std::uint32_t end) {
+        for (std::uint32_t i = begin; i < end; i++) {
+            std::uint32_t code = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                float q = (_prims[i].centroid[axis] - centroids.min[axis]) * scale[axis];
+                code |= spreadBits(std::min<std::uint32_t>(static_cast<std::uint32_t>(q), 1023)) << (2 - axis);
+            }
+            _codes[i] = code;
+        }
+    });
+
+    // Stable LSD radix sort of (code, position) pairs, 10 bits per pass, then
+    // one gather moves the primitives themselves.
+    std::vector<std::uint32_t> codes(_codes.begin() + first, _codes.begin() + first + count);
+    std::vector<std::uint32_t> indices(count);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<std::uint32_t> codesOut(count), indicesOut(count);
+    for (int shift = 0; shift < 30; shift += 10) {
+        std::uint32_t offsets[1025] = {};
+        for (std::uint32_t code : codes) offsets[((code >> shift) & 1023) + 1]++;
+        for (int b = 0; b < 1024; b++) offsets[b + 1] += offsets[b];
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::uint32_t slot = offsets[(codes[i] >> shift) & 1023]++;
+            codesOut[slot] = codes[i];
+            indicesOut[slot] = indices[i];
+        }
+        codes.swap(codesOut);
+        indices.swap(indicesOut);
+    }
+    std::copy(codes.begin(), codes.end(), _codes.begin() + first);
+    std::vector<Prim> sorted(count);
+    for (std::uint32_t i = 0; i < count; i++) sorted[i] = _prims[first + indices[i]];
+    std::copy(sorted.begin(), sorted.end(), _prims.begin() + first);
+}
+
+std::uint32_t Builder::mortonSplit(const Task& task) const {
+    const std::uint32_t* codes = _codes.data() + task.first;
+    std::uint32_t differ = codes[0] ^ codes[task.count - 1];
+    if (differ == 0) return task.count / 2;
+    // Codes share every bit above the highest differing one, so the ones
+    // with that bit clear form a prefix of the sorted range.
+    std::uint32_t bit = std::uint32_t(1) << (31 - std::countl_zero(differ));
+    return static_cast<std::uint32_t>(
+        std::partition_point(codes, codes + task.count, [&](std::uint32_t code) { return (code & bit) == 0; }) - codes);
+}
+
+void Builder::buildSubtree(std::vector<BVH::Node>& nodes, std::uint32_t nodeIdx, Task task) {
+    if (task.count <= BVH::kMaxLeafSize) {
+        nodes[nodeIdx].bounds = leafBounds(task.first, task.count);
+        nodes[nodeIdx].leftFirst = task.first;
+        nodes[nodeIdx].count = task.count;
+        return;
+    }
+    std::uint32_t leftCount = split(task, false);
+    std::uint32_t left = static_cast<std::uint32_t>(nodes.size());
+    nodes.resize(nodes.size() + 2);
+    nodes[nodeIdx].leftFirst = left;
+    nodes[nodeIdx].count = 0;
+    buildSubtree(nodes, left, {left, task.first, leftCount, task.depth + 1, task.morton});
+    buildSubtree(nodes, left + 1, {left + 1, task.first + leftCount, task.count - leftCount, task.depth + 1, task.morton});
+    nodes[nodeIdx].bounds = nodes[left].bounds;
+    nodes[nodeIdx].bounds.grow(nodes[left + 1].bounds);
+}
+
+std::vector<BVH::Node> Builder::build() {
+    const std::uint32_t total = static_cast<std::uint32_t>(_indices.size());
+    forChunks(0, total, true, [&](std::size_t, std::uint32_t begin, std::uint32_t end) {
+        for (std::uint32_t i = begin; i < end; i++) {
+            _prims[i].bounds = _bounds[i];
+            for (int axis = 0; axis < 3; axis++) _prims[i].centroid[axis] = _bounds[i].centroid(axis);
+            _prims[i].index = _indices[i];
+        }
+    });
+
+    // Sized up front: subtrees sort their own ranges of it concurrently.
+    if (_options.quality == BVHQuality::Fast || _options.quality == BVHQuality::Balanced) _codes.resize(total);
+
+    std::vector<BVH::Node> nodes(1);
+    Task root{0, 0, total, 0, false};
+    if (_options.quality == BVHQuality::Fast) {
+        mortonSort(0, total, true);
+        root.morton = true;
+    }
+
+    // Top levels, breadth-first: a few big nodes bin in parallel chunks,
+    // many split in parallel with each other.
+    std::vector<Task> open = {root}, subtrees;
+    while (!open.empty() && open.size() + subtrees.size() < kTopTasks) {
+        std::vector<Task> big;
+        for (const Task& task : open) (task.count > kParallelGrain ? big : subtrees).push_back(task);
+        open.clear();
+        if (big.empty()) break;
+
+        std::vector<std::uint32_t> leftCounts(big.size());
+        const bool chunked = _options.pool == nullptr || big.size() < _options.pool->size();
+        if (chunked) {
+            for (std::size_t i = 0; i < big.size(); i++) leftCounts[i] = split(big[i], true);
+        } else {
+            _options.pool->parallelFor(big.size(), [&](std::size_t i) { leftCounts[i] = split(big[i], false); });
+        }
+        for (std::size_t i = 0; i < big.size(); i++) {
+            const Task& task = big[i];
+            std::uint32_t left = static_cast<std::uint32_t>(nodes.size());
+            nodes.resize(nodes.size() + 2);
+            nodes[task.node].leftFirst = left;
+            nodes[task.node].count = 0;
+            open.push_back({left, task.first, leftCounts[i], task.depth + 1, task.morton});
+            open.push_back({left + 1, task.first + leftCounts[i], task.count - leftCounts[i], task.depth + 1, task.morton});
+        }
+    }
+    subtrees.insert(subtrees.end(), open.begin(), open.end());
+    const std::uint32_t topCount = static_cast<std::uint32_t>(nodes.size());
+
+    // Independent subtrees, each into its own array with its root at 0.
+    std::vector<std::vector<BVH::Node>> built(subtrees.size());
+    auto buildOne = [&](std::size_t i) {
+        built[i].resize(1);
+        buildSubtree(built[i], 0, {0, subtrees[i].first, subtrees[i].count, subtrees[i].depth, subtrees[i].morton});
+    };
+    if (_options.pool != nullptr) {
+        _options.pool->parallelFor(subtrees.size(), buildOne);
+    } else {
+        for (std::size_t i = 0; i < subtrees.size(); i++) buildOne(i);
+    }
+
+    // Splice them in: each root replaces its placeholder, the rest is
+    // appended with child indices shifted.
+    std::size_t totalNodes = nodes.size();
+    for (const auto& subtree : built) totalNodes += subtree.size() - 1;
+    nodes.reserve(totalNodes);
+    for (std::size_t i = 0; i < subtrees.size(); i++) {
+        const std::uint32_t offset = static_cast<std::uint32_t>(nodes.size()) - 1;
+        for (std::size_t n = 0; n < built[i].size(); n++) {
+            BVH::Node node = built[i][n];
+            if (!node.isLeaf()) node.leftFirst += offset;
+            if (n == 0) {
+                nodes[subtrees[i].node] = node;
+            } else {
+                nodes.push_back(node);
+            }
+        }
+        std::vector<BVH::Node>().swap(built[i]);
+    }
+    // Top-level bounds, bottom-up: children always come after their parent.
+    std::vector<bool> isSubtreeRoot(topCount);
+    for (const Task& task : subtrees) isSubtreeRoot[task.node] = true;
+    for (std::uint32_t idx = topCount; idx-- > 0;) {
+        if (isSubtreeRoot[idx]) continue;
+        BVH::Node& node = nodes[idx];
+        node.bounds = nodes[node.leftFirst].bounds;
+        node.bounds.grow(nodes[node.leftFirst + 1].bounds);
+    }
+    forChunks(0, total, true, [&](std::size_t, std::uint32_t begin, std::uint32_t end) {
+        for (std::uint32_t i = begin; i < end; i++) _indices[i] = _prims[i].index;
+    });
+    return nodes;
+}
+
+}
+
+
+BVH::BVH(SceneObjectList objects, const BVHBuildOptions& options) {
+    if (objects.empty()) return;
+
+    std::vector<AABB> bounds(objects.size());
+    auto gather = [&](std::size_t chunk) {
+        std::size_t end = std::min(objects.size(), (chunk + 1) * kParallelGrain);
+        for (std::size_t i = chunk * kParallelGrain; i < end; i++) bounds[i] = objects[i]->bounds();
+    };
+    std::size_t chunks = (objects.size() + kParallelGrain - 1) / kParallelGrain;
+    if (options.pool != nullptr) {
+        options.pool->parallelFor(chunks, gather);
+    } else {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) gather(chunk);
+    }
+
+    _indices.resize(objects.size());
+    std::iota(_indices.begin(), _indices.end(), 0);
+
+    if (options.quality != BVHQuality::Median) {
+        _nodes = Builder(bounds, options, _indices).build();
+    } else {
+        _nodes.reserve(2 * objects.size());
+        _nodes.emplace_back();
+        _nodes[0].leftFirst = 0;
+        _nodes[0].count = static_cast<std::uint32_t>(objects.size());
+        subdivide(0, bounds);
+    }
+    _weightedArea = weightedArea();
+}
+
+void BVH::subdivide(std::uint32_t nodeIdx, const std::vector<AABB>& bounds) {
+    Node& node = _nodes[nodeIdx];
+    AABB centroids;
+    for (std::uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+        node.bounds.grow(bounds[_indices[i]]);
+        const AABB& b = bounds[_indices[i]];
+        centroids.grow(b.centroid(0), b.centroid(1), b.centroid(2));
+    }
+    if (node.count <= kMaxLeafSize) return;
+
+    // Object median split along the axis where the centroids spread the most.
+    int axis = centroids.largestAxis();
+    auto first = _indices.begin() + node.leftFirst;
+    auto last = first + node.count;
+    auto middle = first + node.count / 2;
+    std::nth_element(first, middle, last, [&](std::uint32_t a, std::uint32_t b) {
+        float ca = bounds[a].centroid(axis);
+        float cb = bounds[b].centroid(axis);
+        return ca < cb || (ca == cb && a < b);
+    });
+
+    std::uint32_t leftCount = node.count / 2;
+    std::uint32_t left = static_cast<std::uint32_t>(_nodes.size());
+    Node leftNode, rightNode;
+    leftNode.leftFirst = node.leftFirst;
+    leftNode.count = leftCount;
+    rightNode.leftFirst = node.leftFirst + leftCount;
+    rightNode.count = node.count - leftCount;
+    node.leftFirst = left;
+    node.count = 0;
+    // node is invalidated by the push_backs below.
+    _nodes.push_back(leftNode);
+    _nodes.push_back(rightNode);
+
+    subdivide(left, bounds);
+    subdivide(left + 1, bounds);
+}
+
+double BVH::weightedArea() const {
+    // Millions of tiny terms: a float sum would stop growing.
+    double sum = 0;
+    for (const Node& node : _nodes) sum += double(node.bounds.surfaceArea()) * (node.isLeaf() ? node.count : 1);
+    return sum;
+}
+
+float BVH::sahCost() const {
+    if (empty()) return 0;
+    const double rootArea = _nodes[0].bounds.surfaceArea();
+    if (rootArea <= 0) return 0;
+    return static_cast<float>(_weightedArea / rootArea);
+}
+
+void BVH::linkNodes() {
+    _parent.assign(_nodes.size(), 0);
+    _depth.assign(_nodes.size(), 0);
+    _leafOf.assign(_indices.size(), 0);
+    _marked.assign(_nodes.size(), 0);
+    std::vector<std::uint32_t> stack = {0};
+    while (!stack.empty()) {
+        std::uint32_t idx = stack.back();
+        stack.pop_back();
+        const Node& node = _nodes[idx];
+        if (node.isLeaf()) {
+            for (std::uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) _leafOf[_indices[i]] = idx;
+            continue;
+        }
+        for (std::uint32_t child : {node.leftFirst, node.leftFirst + 1}) {
+            _parent[child] = idx;
+            _depth[child] = _depth[idx] + 1;
+            stack.push_back(child);
+        }
+    }
+}
+
+std::vector<std::uint32_t> BVH::refit(SceneObjectList objects,
+                                      const std::vector<std::uint32_t>& changed, ThreadPool* pool) {
+    std::vector<std::uint32_t> updated;
+    if (empty() || changed.empty()) return updated;
+    if (_parent.empty()) linkNodes();
+
+    // The changed leaves and their ancestors, by depth. A walk up stops at the
+    // first node an earlier one reached, so shared ancestors appear once.
+    std::vector<std::vector<std::uint32_t>> levels;
+    for (std::uint32_t object : changed) {
+        for (std::uint32_t idx = _leafOf[object]; !_marked[idx]; idx = _parent[idx]) {
+            _marked[idx] = 1;
+            if (levels.size() <= _depth[idx]) levels.resize(_depth[idx] + 1);
+            levels[_depth[idx]].push_back(idx);
+            if (idx == 0) break;
+        }
+    }
+    for (std::size_t depth = levels.size(); depth-- > 0;) {
+        updated.insert(updated.end(), levels[depth].begin(), levels[depth].end());
+    }
+
+    auto weight = [&](const Node& node) { return double(node.bounds.surfaceArea()) * (node.isLeaf() ? node.count : 1); };
+    for (std::uint32_t idx : updated) _weightedArea -= weight(_nodes[idx]);
+
+    // Deepest level first: every node of a level only reads its children,
+    // which are done by then.
+    for (std::size_t depth = levels.size(); depth-- > 0;) {
+        const std::vector<std::uint32_t>& level = levels[depth];
+        auto refitChunk = [&](std::size_t chunk) {
+            std::size_t end = std::min(level.size(), (chunk + 1) * kRefitGrain);
+            for (std::size_t i = chunk * kRefitGrain; i < end; i++) {
+                Node& node = _nodes[level[i]];
+                AABB bounds;
+                if (node.isLeaf()) {
+                    for (std::uint32_t j = node.leftFirst; j < node.leftFirst + node.count; j++) {
+                        bounds.grow(objects[_indices[j]]->bounds());
+                    }
+                } else {
+                    bounds = _nodes[node.leftFirst].bounds;
+                    bounds.grow(_nodes[node.leftFirst + 1].bounds);
+                }
+                node.bounds = bounds;
+            }
+        };
+        std::size_t chunks = (level.size() + kRefitGrain - 1) / kRefitGrain;
+        if (pool != nullptr && chunks > 1) {
+            pool->parallelFor(chunks, refitChunk);
+        } else {
+            for (std::size_t chunk = 0; chunk < chunks; chunk++) refitChunk(chunk);
+        }
+    }
+
+    for (std::uint32_t idx : updated) {
+        _weightedArea += weight(_nodes[idx]);
+        _marked[idx] = 0;
+    }
+    return updated;
+}
+
+std::optional<HitInfo> BVH::intersect(const Ray& ray, SceneObjectList objects) const {
+    if (empty()) return std::nullopt;
+    std::optional<PrimitiveHit> best =
+        bvh_detail::closestPrimitive(_nodes.data(), _indices.data(), ray, [&](std::uint32_t idx, float& t) {
+            std::optional<HitInfo> hit = objects[idx]->intersect(ray.origin, ray.direction);
+            if (hit) t = hit->t;
+            return hit.has_value();
+        });
+    if (!best) return std::nullopt;
+    std::optional<HitInfo> hit = objects[best->index]->intersect(ray.origin, ray.direction);
+    hit->objectId = best->index;
+    return hit;
+}
@@ -0,0 +1,88 @@
+#include "framebuffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+std::size_t bytesPerPixel(PixelFormat format) {
+    return format == PixelFormat::RGB8 ? 3 : 4 * sizeof(float);
+}
+
+std::size_t channelCount(PixelFormat format) {
+    return format == PixelFormat::RGB8 ? 3 : 4;
+}
+
+
+void FramebufferTile::setPixel(int x, int y, const std::array<std::uint8_t, 3>& rgb) {
+    std::uint8_t* px = pixel(x, y);
+    if (_format == PixelFormat::RGB8) {
+        std::memcpy(px, rgb.data(), 3);
+        return;
+    }
+    const std::array<float, 4> rgba = {rgb[0] / 255.0f, rgb[1] / 255.0f, rgb[2] / 255.0f, 1.0f};
+    std::memcpy(px, rgba.data(), sizeof(rgba));
+}
+
+void FramebufferTile::setPixel(int x, int y, const std::array<float, 4>& rgba) {
+    std::uint8_t* px = pixel(x, y);
+    if (_format == PixelFormat::RGBA32F) {
+        std::memcpy(px, rgba.data(), sizeof(rgba));
+        return;
+    }
+    for (int c = 0; c < 3; c++) {
+        px[c] = static_cast<std::uint8_t>(std::clamp(rgba[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+
+Framebuffer::Framebuffer(int width, int height, PixelFormat format, std::pmr::memory_resource* resource)
+    : _format(format), _resource(resource), _pixels(nullptr, Deleter{resource, 0}) {
+    resize(width, height, format);
+}
+
+void Framebuffer::resize(int width, int height, PixelFormat format) {
+    width = std::max(width, 0);
+    height = std::max(height, 0);
+    std::size_t stride = (width * bytesPerPixel(format) + kAlignment - 1) / kAlignment * kAlignment;
+    std::size_t bytes = stride * height;
+    if (bytes != _pixels.get_deleter().bytes || !_pixels) {
+        _pixels.reset();
+        std::uint8_t* memory = bytes ? static_cast<std::uint8_t*>(_resource->allocate(bytes, kAlignment)) : nullptr;
+        _pixels = std::unique_ptr<std::uint8_t[], Deleter>(memory, Deleter{_resource, bytes});
+    }
+    _width = width;
+    _height = height;
+    _format = format;
+    _stride = stride;
+}
+
+void Framebuffer::clear() {
+    if (_pixels) std::memset(_pixels.get(), 0, byteSize());
+}
+
+FramebufferTile Framebuffer::tile(int x0, int y0, int width, int height) {
+    x0 = std::clamp(x0, 0, _width);
+    y0 = std::clamp(y0, 0, _height);
+    width = std::clamp(width, 0, _width - x0);
+    height = std::clamp(height, 0, _height - y0);
+    return FramebufferTile(row(y0) + x0 * bytesPerPixel(_format), _stride, _format, x0, y0, width, height);
+}
+
+std::array<std::uint8_t, 3> Framebuffer::pixelRGB8(int x, int y) const {
+    const std::uint8_t* px = row(y) + x * bytesPerPixel(_format);
+    if (_format == PixelFormat::RGB8) return {px[0], px[1], px[2]};
+    float rgba[4];
+    std::memcpy(rgba, px, sizeof(rgba));
+    std::array<std::uint8_t, 3> rgb;
+    for (int c = 0; c < 3; c++) {
+        rgb[c] = static_cast<std::uint8_t>(std::clamp(rgba[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    return rgb;
+}
+
+std::array<float, 4> Framebuffer::pixelRGBA32F(int x, int y) const {
+    const std::uint8_t* px = row(y) + x * bytesPerPixel(_format);
+    if (_format == PixelFormat::RGB8) return {px[0] / 255.0f, px[1] / 255.0f, px[2] / 255.0f, 1.0f};
+    std::array<float, 4> rgba;
+    std::memcpy(rgba.data(), px, sizeof(rgba));
+    return rgba;
+}
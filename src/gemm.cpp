@@ -0,0 +1,119 @@
+#include "gemm.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEMM_HAVE_X86 1
+#endif
+
+
+namespace {
+
+// Register blocking: 6 rows x 2 vectors of accumulators leaves room for the
+// two B vectors and the A broadcast in the 16 ymm registers.
+constexpr std::size_t kFloatMR = 6, kFloatNR = 16;
+constexpr std::size_t kDoubleMR = 6, kDoubleNR = 8;
+
+#ifdef GEMM_HAVE_X86
+__attribute__((target("avx2,fma")))
+void floatKernelAvx2(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc) {
+    __m256 acc[kFloatMR][2];
+#pragma GCC unroll 6
+    for (std::size_t r = 0; r < kFloatMR; r++) {
+        acc[r][0] = _mm256_setzero_ps();
+        acc[r][1] = _mm256_setzero_ps();
+    }
+    for (std::size_t p = 0; p < kc; p++) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+#pragma GCC unroll 6
+        for (std::size_t r = 0; r < kFloatMR; r++) {
+            __m256 ar = _mm256_broadcast_ss(a + r);
+            acc[r][0] = _mm256_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_ps(ar, b1, acc[r][1]);
+        }
+        a += kFloatMR;
+        b += kFloatNR;
+    }
+#pragma GCC unroll 6
+    for (std::size_t r = 0; r < kFloatMR; r++) {
+        float* row = c + r * ldc;
+        _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), acc[r][0]));
+        _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[r][1]));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void doubleKernelAvx2(std::size_t kc, const double* a, const double* b, double* c, std::size_t ldc) {
+    __m256d acc[kDoubleMR][2];
+#pragma GCC unroll 6
+    for (std::size_t r = 0; r < kDoubleMR; r++) {
+        acc[r][0] = _mm256_setzero_pd();
+        acc[r][1] = _mm256_setzero_pd();
+    }
+    for (std::size_t p = 0; p < kc; p++) {
+        __m256d b0 = _mm256_load_pd(b);
+        __m256d b1 = _mm256_load_pd(b + 4);
+#pragma GCC unroll 6
+        for (std::size_t r = 0; r < kDoubleMR; r++) {
+            __m256d ar = _mm256_broadcast_sd(a + r);
+            acc[r][0] = _mm256_fmadd_pd(ar, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_pd(ar, b1, acc[r][1]);
+        }
+        a += kDoubleMR;
+        b += kDoubleNR;
+    }
+#pragma GCC unroll 6
+    for (std::size_t r = 0; r < kDoubleMR; r++) {
+        double* row = c + r * ldc;
+        _mm256_storeu_pd(row, _mm256_add_pd(_mm256_loadu_pd(row), acc[r][0]));
+        _mm256_storeu_pd(row + 4, _mm256_add_pd(_mm256_loadu_pd(row + 4), acc[r][1]));
+    }
+}
+#endif
+
+}
+
+
+GemmKernel detectGemmKernel() {
+    static const GemmKernel kernel = [] {
+#ifdef GEMM_HAVE_X86
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return GemmKernel::AVX2;
+#endif
+        return GemmKernel::Scalar;
+    }();
+    return kernel;
+}
+
+const char* gemmKernelName(GemmKernel kernel) {
+    switch (kernel) {
+        case GemmKernel::AVX2: return "avx2+fma";
+        case GemmKernel::Scalar: return "scalar";
+    }
+    return "unknown";
+}
+
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+          const float* a, std::size_t lda, const float* b, std::size_t ldb, float* c, std::size_t ldc,
+          GemmKernel kernel) {
+#ifdef GEMM_HAVE_X86
+    if (kernel == GemmKernel::AVX2 && detectGemmKernel() == GemmKernel::AVX2) {
+        gemm_detail::blockedGemm<float, kFloatMR, kFloatNR>(m, n, k, a, lda, b, ldb, c, ldc, floatKernelAvx2);
+        return;
+    }
+#endif
+    gemm_detail::blockedGemm<float, kFloatMR, kFloatNR>(m, n, k, a, lda, b, ldb, c, ldc,
+                                                        gemm_detail::scalarKernel<float, kFloatMR, kFloatNR>);
+}
+
+void gemm(std::size_t m, std::size_t n, std::size_t k,
+          const double* a, std::size_t lda, const double* b, std::size_t ldb, double* c, std::size_t ldc,
+          GemmKernel kernel) {
+#ifdef GEMM_HAVE_X86
+    if (kernel == GemmKernel::AVX2 && detectGemmKernel() == GemmKernel::AVX2) {
+        gemm_detail::blockedGemm<double, kDoubleMR, kDoubleNR>(m, n, k, a, lda, b, ldb, c, ldc, doubleKernelAvx2);
+        return;
+    }
+#endif
+    gemm_detail::blockedGemm<double, kDoubleMR, kDoubleNR>(m, n, k, a, lda, b, ldb, c, ldc,
+                                                          gemm_detail::scalarKernel<double, kDoubleMR, kDoubleNR>);
+}
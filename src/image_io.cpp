@@ -0,0 +1,272 @@
+#include "image_io.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+
+namespace {
+
+void append(std::vector<std::uint8_t>& out, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void appendString(std::vector<std::uint8_t>& out, const std::string& text) {
+    append(out, text.data(), text.size());
+}
+
+void appendBigEndian(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    const std::uint8_t bytes[4] = {std::uint8_t(value >> 24), std::uint8_t(value >> 16), std::uint8_t(value >> 8),
+                                   std::uint8_t(value)};
+    append(out, bytes, 4);
+}
+
+// Row y as tightly packed RGB8.
+void packRowRGB8(const Framebuffer& frame, int y, std::uint8_t* out) {
+    if (frame.format() == PixelFormat::RGB8) {
+        std::memcpy(out, frame.row(y), frame.width() * 3);
+        return;
+    }
+    for (int x = 0; x < frame.width(); x++) {
+        std::array<std::uint8_t, 3> rgb = frame.pixelRGB8(x, y);
+        std::memcpy(out + x * 3, rgb.data(), 3);
+    }
+}
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t n = 0; n < 256; n++) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void appendChunk(std::vector<std::uint8_t>& out, const char type[4], const std::vector<std::uint8_t>& payload) {
+    appendBigEndian(out, static_cast<std::uint32_t>(payload.size()));
+    std::size_t start = out.size();
+    append(out, type, 4);
+    append(out, payload.data(), payload.size());
+    appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+// Renders are written once and rarely compressible in a useful time budget on
+// the farm, so the zlib stream uses stored (uncompressed) deflate blocks.
+std::vector<std::uint8_t> encodePNG(const Framebuffer& frame) {
+    const std::size_t rowBytes = static_cast<std::size_t>(frame.width()) * 3 + 1;
+    std::vector<std::uint8_t> raw(rowBytes * frame.height());
+    for (int y = 0; y < frame.height(); y++) {
+        raw[y * rowBytes] = 0; // filter: none
+        packRowRGB8(frame, y, &raw[y * rowBytes + 1]);
+    }
+
+    std::vector<std::uint8_t> zlib = {0x78, 0x01};
+    constexpr std::size_t kMaxStored = 65535;
+    std::size_t offset = 0;
+    do {
+        std::size_t size = std::min(kMaxStored, raw.size() - offset);
+        bool last = offset + size == raw.size();
+        const std::uint8_t header[5] = {std::uint8_t(last), std::uint8_t(size), std::uint8_t(size >> 8),
+                                        std::uint8_t(~size), std::uint8_t(~size >> 8)};
+        append(zlib, header, 5);
+        append(zlib, raw.data() + offset, size);
+        offset += size;
+    } while (offset < raw.size());
+    std::uint32_t a = 1, b = 0;
+    for (std::uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<std::uint8_t> ihdr;
+    appendBigEndian(ihdr, frame.width());
+    appendBigEndian(ihdr, frame.height());
+    const std::uint8_t format[5] = {8, 2, 0, 0, 0}; // 8-bit RGB, deflate, no filter choice, no interlace
+    append(ihdr, format, 5);
+
+    std::vector<std::uint8_t> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(out, "IHDR", ihdr);
+    appendChunk(out, "IDAT", zlib);
+    appendChunk(out, "IEND", {});
+    return out;
+}
+
+std::vector<std::uint8_t> encodePPM(const Framebuffer& frame) {
+    std::vector<std::uint8_t> out;
+    appendString(out, "P6\n" + std::to_string(frame.width()) + " " + std::to_string(frame.height()) + "\n255\n");
+    std::size_t header = out.size();
+    out.resize(header + static_cast<std::size_t>(frame.width()) * frame.height() * 3);
+    for (int y = 0; y < frame.height(); y++) {
+        packRowRGB8(frame, y, &out[header + static_cast<std::size_t>(y) * frame.width() * 3]);
+    }
+    return out;
+}
+
+// PFM stores rows bottom to top; a negative scale marks little-endian floats.
+std::vector<std::uint8_t> encodePFM(const Framebuffer& frame) {
+    static_assert(std::endian::native == std::endian::little, "PFM writer assumes a little-endian host");
+    std::vector<std::uint8_t> out;
+    appendString(out, "PF\n" + std::to_string(frame.width()) + " " + std::to_string(frame.height()) + "\n-1.0\n");
+    std::vector<float> row(static_cast<std::size_t>(frame.width()) * 3);
+    for (int y = frame.height() - 1; y >= 0; y--) {
+        for (int x = 0; x < frame.width(); x++) {
+            std::array<float, 4> rgba = frame.pixelRGBA32F(x, y);
+            std::copy(rgba.begin(), rgba.begin() + 3, row.begin() + x * 3);
+        }
+        append(out, row.data(), row.size() * sizeof(float));
+    }
+    return out;
+}
+
+}
+
+
+ImageFormat imageFormatFromPath(const std::string& path) {
+    std::size_t dot = path.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (ext == "png") return ImageFormat::PNG;
+    if (ext == "ppm") return ImageFormat::PPM;
+    if (ext == "pfm") return ImageFormat::PFM;
+    throw std::invalid_argument("Unknown image extension: " + path);
+}
+
+const char* imageFormatName(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::PNG: return "png";
+        case ImageFormat::PPM: return "ppm";
+        case ImageFormat::PFM: return "pfm";
+    }
+    return "unknown";
+}
+
+PixelFormat pixelFormatFor(ImageFormat format) {
+    return format == ImageFormat::PFM ? PixelFormat::RGBA32F : PixelFormat::RGB8;
+}
+
+std::vector<std::uint8_t> encodeImage(const Framebuffer& frame, ImageFormat format) {
+    switch (format) {
+        case ImageFormat::PNG: return encodePNG(frame);
+        case ImageFormat::PPM: return encodePPM(frame);
+        case ImageFormat::PFM: return encodePFM(frame);
+    }
+    throw std::invalid_argument("Unknown image format.");
+}
+
+void writeImage(const Framebuffer& frame, const std::string& path, ImageFormat format) {
+    std::vector<std::uint8_t> bytes = encodeImage(frame, format);
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!file || std::fwrite(bytes.data(), 1, bytes.size(), file.get()) != bytes.size() ||
+        std::fclose(file.release()) != 0) {
+        throw std::runtime_error("Cannot write image: " + path);
+    }
+}
+
+void writeImage(const Framebuffer& frame, const std::string& path) {
+    writeImage(frame, path, imageFormatFromPath(path));
+}
+
+
+AsyncImageWriter::AsyncImageWriter(std::size_t maxPending)
+    : _maxPending(std::max<std::size_t>(1, maxPending)), _thread(&AsyncImageWriter::writerLoop, this) {}
+
+AsyncImageWriter::~AsyncImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+void AsyncImageWriter::submit(Framebuffer frame, std::string path, ImageFormat format) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _progress.wait(lock, [this] { return _queue.size() < _maxPending; });
+    _queue.push_back(Job{std::move(frame), std::move(path), format});
+    lock.unlock();
+    _wake.notify_one();
+}
+
+Framebuffer AsyncImageWriter::recycle() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_free.empty()) return Framebuffer();
+    Framebuffer frame = std::move(_free.back());
+    _free.pop_back();
+    return frame;
+}
+
+void AsyncImageWriter::wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _progress.wait(lock, [this] { return _queue.empty() && !_busy; });
+    if (_error) {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void AsyncImageWriter::check() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_error) {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+std::size_t AsyncImageWriter::written() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _written;
+}
+
+double AsyncImageWriter::busySeconds() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _busySeconds;
+}
+
+void AsyncImageWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _wake.wait(lock, [this] { return _stop || !_queue.empty(); });
+        if (_queue.empty()) return; // stopping, and everything is written
+
+        Job job = std::move(_queue.front());
+        _queue.pop_front();
+        _busy = true;
+        lock.unlock();
+        _progress.notify_all();
+
+        auto start = std::chrono::steady_clock::now();
+        std::exception_ptr error;
+        try {
+            writeImage(job.frame, job.path, job.format);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        _busy = false;
+        _busySeconds += seconds;
+        if (error) {
+            if (!_error) _error = error;
+        } else {
+            _written++;
+        }
+        if (_free.size() <= _maxPending) _free.push_back(std::move(job.frame));
+        _progress.notify_all();
+    }
+}
@@ -0,0 +1,109 @@
+#include "light.hpp"
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <stdexcept>
+
+
+const char* lightTypeName(LightType type) {
+    switch (type) {
+        case LightType::Point: return "point";
+        case LightType::Directional: return "directional";
+        case LightType::Sphere: return "sphere";
+    }
+    return "unknown";
+}
+
+AnalyticLight AnalyticLight::point(const Vector3D& position, float r, float g, float b, float intensity) {
+    AnalyticLight light;
+    light.type = LightType::Point;
+    light.position[0] = position.x();
+    light.position[1] = position.y();
+    light.position[2] = position.z();
+    light.color[0] = r;
+    light.color[1] = g;
+    light.color[2] = b;
+    light.intensity = intensity;
+    return light;
+}
+
+AnalyticLight AnalyticLight::directional(const Vector3D& direction, float r, float g, float b, float intensity) {
+    float length = direction.magnitude();
+    if (!(length > 0)) throw std::invalid_argument("Directional light needs a non-zero direction");
+    AnalyticLight light = point(Vector3D(), r, g, b, intensity);
+    light.type = LightType::Directional;
+    light.direction[0] = direction.x() / length;
+    light.direction[1] = direction.y() / length;
+    light.direction[2] = direction.z() / length;
+    return light;
+}
+
+AnalyticLight AnalyticLight::sphere(const Vector3D& center, float radius, float r, float g, float b, float intensity) {
+    if (!(radius > 0)) throw std::invalid_argument("Sphere light needs a positive radius");
+    AnalyticLight light = point(center, r, g, b, intensity);
+    light.type = LightType::Sphere;
+    light.radius = radius;
+    return light;
+}
+
+LightSample AnalyticLight::sample(const Vector3D& p, float u, float v) const {
+    LightSample s;
+    float irradiance = 0;
+    switch (type) {
+        case LightType::Directional:
+            s.direction = Vector3D(-direction[0], -direction[1], -direction[2]);
+            s.distance = std::numeric_limits<float>::infinity();
+            irradiance = intensity;
+            break;
+
+        case LightType::Point: {
+            Vector3D toLight = Vector3D(position[0], position[1], position[2]) - p;
+            float distSq = toLight.lengthSquared();
+            if (!(distSq > 0)) return s;
+            s.distance = std::sqrt(distSq);
+            s.direction = toLight / s.distance;
+            irradiance = intensity / distSq;
+            break;
+        }
+
+        case LightType::Sphere: {
+            Vector3D toCenter = Vector3D(position[0], position[1], position[2]) - p;
+            float distSq = toCenter.lengthSquared();
+            float dist = std::sqrt(distSq);
+            float radiusSq = radius * radius;
+            bool inside = distSq <= radiusSq;
+            // 1 - cos of the cone's half angle, written so it keeps its
+            // precision for small, distant lights.
+            float oneMinusCosMax = 2;
+            if (!inside) {
+                float sinSq = radiusSq / distSq;
+                oneMinusCosMax = sinSq / (1 + std::sqrt(1 - sinSq));
+            }
+            float cosTheta = 1 - u * oneMinusCosMax;
+            float sinTheta = std::sqrt(std::max(0.0f, 1 - cosTheta * cosTheta));
+            float phi = 2 * std::numbers::pi_v<float> * v;
+
+            // Orthonormal frame around the direction to the centre
+            // (Duff et al., "Building an Orthonormal Basis, Revisited").
+            Vector3D w = dist > 0 ? toCenter / dist : Vector3D(0, 0, 1);
+            float sign = std::copysign(1.0f, w.z());
+            float a = -1 / (sign + w.z());
+            float b = w.x() * w.y() * a;
+            Vector3D t1(1 + sign * w.x() * w.x() * a, sign * b, -sign * w.x());
+            Vector3D t2(b, sign + w.y() * w.y() * a, -w.y());
+            s.direction = t1 * (std::cos(phi) * sinTheta) + t2 * (std::sin(phi) * sinTheta) + w * cosTheta;
+
+            // Where the sampled direction meets the sphere: the near side
+            // from outside, the far side from inside.
+            float proj = dist * cosTheta;
+            float root = std::sqrt(std::max(0.0f, radiusSq - distSq + proj * proj));
+            s.distance = inside ? proj + root : proj - root;
+
+            // Radiance intensity / (pi r^2) over a pdf of 1 / (2 pi (1 - cos max)).
+            irradiance = 2 * intensity * oneMinusCosMax / radiusSq;
+            break;
+        }
+    }
+    for (int c = 0; c < 3; c++) s.weight[c] = irradiance * color[c];
+    return s;
+}
@@ -1,81 +1,192 @@
 #include "myheader.h"
 #include <iostream>
+#include <cstdio>
 #include <cstdlib>  // for atoi and atof
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <string>
 #include <vector>
 #include "scene.hpp"
+#include "renderer.hpp"
+#include "batch.hpp"
+#include "scene_cache.hpp"
+#include "scene_file.hpp"
+#include "framebuffer_cv.hpp"
+#include "trace.hpp"
 
 #include <opencv2/opencv.hpp>
 
 #include <opencv2/opencv.hpp>
 #include <vector>
 
-int show(const Scene& scene) {
-    // Dimensions of the image
-    int height = 100;
-    int width = 100;
-
-    // Example 3D vector (height, width, colors)
-    std::vector<std::vector<std::vector<int>>> pixels(height, std::vector<std::vector<int>>(width, std::vector<int>(3, 0)));
-
-    // Ray trace from camera points to scene objects
-    for(int i = 0; i < height; i++) {
-        for(int j = 0; j < width; j++) {
-            std::cout << "i="<<i<<", j="<<j<< std::endl;
-            // Convert (i,j) to x,y,z point around camera
-            Vector3D rayOrigin = scene.cam()->getRayOrigin(height, width, i, j);
-            std::cout << "rayOrigin calcd " << rayOrigin.toString() << std::endl;
-            // Check if each object intersects with ray.
-            for(auto& obj : scene.objects()) {
-                std::cout << "prehit" << std::endl;
-                std::optional<HitInfo> hit = obj->intersect(rayOrigin, scene.cam()->orientation());
-                std::cout << "posthit" << std::endl;
-                // If intersects, check if bounce angle hits the light.
-                // TODO: Refactor to work with n-bounces
-                // TODO: Calc color correctly
-                if (hit.has_value()) {
-                    std::cout << "hit" << std::endl;
-                    for (const std::unique_ptr<Light>& light : scene.lights()) {
-                        std::optional<HitInfo> lightHit = light->intersect(*hit.value().hitPoint, *hit.value().bounceDir);
-                        if (lightHit.has_value()) {
-                            std::cout << "lighthit" << std::endl;
-                            pixels[i][j][0] = 125;
-                            pixels[i][j][1] = 255;
-                            pixels[i][j][2] = 0;
-                        }
-                    }
-                }
-            }
-        }
-    }
+// Whole argument as an integer in [min, max], or false for anything else
+// (empty, trailing characters, out of range).
+bool parseInt(const char* text, int min, int max, int& value) {
+    const char* end = text + std::strlen(text);
+    auto [ptr, ec] = std::from_chars(text, end, value);
+    return ec == std::errc() && ptr == end && ptr != text && value >= min && value <= max;
+}
 
-    // Create a Mat object with 3 channels
-    cv::Mat image(height, width, CV_8UC3);
+// Whole argument as a finite float.
+bool parseFloat(const char* text, float& value) {
+    const char* end = text + std::strlen(text);
+    auto [ptr, ec] = std::from_chars(text, end, value);
+    return ec == std::errc() && ptr == end && ptr != text && std::isfinite(value);
+}
 
-    // Copy the data from the 3D vector to the Mat object
-    for(int i = 0; i < height; ++i) {
-        for(int j = 0; j < width; ++j) {
-            image.at<cv::Vec3b>(i, j) = cv::Vec3b(pixels[i][j][0], pixels[i][j][1], pixels[i][j][2]);
-        }
-    }
+int usageError(const char* program, const std::string& flag, const char* expected, const char* value) {
+    std::fprintf(stderr, "%s: %s expects %s, got '%s'\n", program, flag.c_str(), expected, value);
+    return 1;
+}
 
-    // Display the image
-    cv::imshow("Image", image);
+int usageError(const char* program, const std::string& message) {
+    std::fprintf(stderr, "%s: %s\n", program, message.c_str());
+    return 1;
+}
+
+// Every option takes a value (--camera-step takes three).
+constexpr const char* kOptions[] = {"--threads", "--width", "--height", "--tile", "--packet-size", "--bvh-quality",
+                                    "--scene", "--output", "--frames", "--camera-step", "--trace-level"};
+
+int show(const Scene& scene, const RenderSettings& settings) {
+    // Ray trace from camera points to scene objects, one tile per task,
+    // straight into the framebuffer
+    Renderer renderer(settings);
+    Framebuffer frame;
+    renderer.render(scene, frame);
+
+    // Display the image; the Mat wraps the framebuffer's memory
+    cv::imshow("Image", asMat(frame));
     cv::waitKey(0);
 
     return 0;
 }
 
-
 int main(int argc, char *argv[]) {
+    // Headless when --output is given:
+    //   --output frame_%04d.png --width W --height H --frames N --camera-step dx dy dz
+    // --scene file.scene (or a file.rtcache from tools/scene_cache) loads the
+    // scene and its render settings; the other flags override the file's settings.
+    // --bvh-quality median|fast|balanced|high picks the BVH builder.
     Scene scene = Scene();
-    std::unique_ptr<SceneObject> obj = std::make_unique<SphereSceneObject>(0.1, 1, 0, 1, 1, 1, 1, 2);
-    scene.addObject(std::move(obj));
-    auto cam = std::make_unique<Camera>(-4, 1, 0, 0, 0.2, 0.1, 4);
-    scene.setCamera(std::move(cam));
-    auto light = std::make_unique<Light>(0, 15, 0, 1, 1, 1, 23);
-    scene.addLight(std::move(light));
-
-    show(scene);
+    BatchOptions batch;
+    RenderSettings& settings = batch.settings;
+    std::string scenePath;
+    for (int arg = 1; arg + 1 < argc; arg++) {
+        if (std::string(argv[arg]) == "--scene") scenePath = argv[++arg];
+    }
+    if (scenePath.empty()) {
+        std::unique_ptr<SceneObject> obj = std::make_unique<SphereSceneObject>(0.1, 1, 0, 1, 1, 1, 1, 2);
+        scene.addObject(std::move(obj));
+        auto cam = std::make_unique<Camera>(-4, 1, 0, 0, 0.2, 0.1, 4);
+        scene.setCamera(std::move(cam));
+        auto light = std::make_unique<Light>(0, 15, 0, 1, 1, 1, 23);
+        scene.addLight(std::move(light));
+    } else {
+        try {
+            if (scenePath.ends_with(".rtcache")) {
+                // Binary cache written by tools/scene_cache, BVH included;
+                // copied into the scene, so the mapping can go afterwards.
+                SceneCache cache(scenePath);
+                settings = cache.settings();
+                cache.toScene(scene);
+            } else {
+                loadScene(scenePath, scene, settings);
+            }
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        if (!scene.cam()) {
+            std::fprintf(stderr, "%s has no camera\n", scenePath.c_str());
+            return 1;
+        }
+    }
+    // Numeric flags must be whole numbers in range; anything else is a usage
+    // error rather than a silent 0 (or, for --threads, a huge thread count).
+    // So are unknown flags and a flag without its value: either would
+    // otherwise fall through to the display window, which a headless machine
+    // does not have.
+    BVHBuildOptions bvhOptions;
+    for (int arg = 1; arg < argc; arg++) {
+        std::string flag = argv[arg];
+        int value = 0;
+        if (std::find(std::begin(kOptions), std::end(kOptions), flag) == std::end(kOptions)) {
+            return usageError(argv[0], "unknown option '" + flag + "'");
+        }
+        if (arg + 1 >= argc) return usageError(argv[0], flag + " expects a value");
+        if (flag == "--threads") {
+            if (!parseInt(argv[++arg], 0, static_cast<int>(kMaxThreads), value)) {
+                return usageError(argv[0], flag, "a thread count from 0 (every hardware thread) to 4096", argv[arg]);
+            }
+            settings.threads = static_cast<std::size_t>(value);
+        } else if (flag == "--width" || flag == "--height" || flag == "--tile" || flag == "--packet-size") {
+            if (!parseInt(argv[++arg], 1, kMaxImageSize, value)) {
+                return usageError(argv[0], flag, "an integer from 1 to 65536", argv[arg]);
+            }
+            if (flag == "--width") settings.width = value;
+            if (flag == "--height") settings.height = value;
+            if (flag == "--tile") settings.tileSize = value;
+            if (flag == "--packet-size") settings.packetSize = value;
+        } else if (flag == "--bvh-quality") {
+            try {
+                bvhOptions.quality = bvhQualityFromName(argv[++arg]);
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "%s\n", e.what());
+                return 1;
+            }
+        } else if (flag == "--scene") {
+            arg++;
+        } else if (flag == "--output") {
+            batch.output = argv[++arg];
+        } else if (flag == "--frames") {
+            if (!parseInt(argv[++arg], 1, 1'000'000, value)) {
+                return usageError(argv[0], flag, "a frame count from 1 to 1000000", argv[arg]);
+            }
+            batch.frames = value;
+        } else if (flag == "--camera-step") {
+            if (arg + 3 >= argc) return usageError(argv[0], flag + " expects three numbers");
+            float step[3];
+            for (int axis = 0; axis < 3; axis++) {
+                if (!parseFloat(argv[++arg], step[axis])) return usageError(argv[0], flag, "three numbers", argv[arg]);
+            }
+            batch.cameraStep = Vector3D(step[0], step[1], step[2]);
+        } else if (flag == "--trace-level") {
+            // Only levels compiled in with TRACE_LEVEL produce output.
+            if (!parseInt(argv[++arg], 0, static_cast<int>(trace::Level::Verbose), value)) {
+                return usageError(argv[0], flag, "a level from 0 to 5", argv[arg]);
+            }
+            trace::Config config = trace::config();
+            config.level = static_cast<trace::Level>(value);
+            trace::configure(config);
+        }
+    }
+
+    // A scene cache brings its own tree; otherwise build one with every thread.
+    // Batch frames refit or rebuild it with the same options.
+    batch.bvh = bvhOptions;
+    if (scene.bvh().empty()) {
+        ThreadPool pool(settings.threads);
+        bvhOptions.pool = &pool;
+        scene.buildBVH(bvhOptions);
+    }
+
+    if (!batch.output.empty()) {
+        try {
+            BatchReport report = renderBatch(scene, batch);
+            std::printf("%d frames: render %.3f s, encode %.3f s (overlapped), wall %.3f s\n",
+                        report.frames, report.renderSeconds, report.writeSeconds, report.wallSeconds);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        return 0;
+    }
+
+    show(scene, settings);
 
     // if(argc != 4) {  // We expect 3 arguments (besides the program name)
     //     std::cerr << "Usage: " << argv[0] << " <integer> <float> <string>\n";
@@ -0,0 +1,98 @@
+#include "ray_packet.hpp"
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RAY_PACKET_HAVE_X86 1
+#endif
+
+
+int RayPacket::add(const Ray& ray) {
+    if (count == kMaxRays) throw std::length_error("RayPacket is full");
+    ox[count] = ray.origin.x();
+    oy[count] = ray.origin.y();
+    oz[count] = ray.origin.z();
+    dx[count] = ray.direction.x();
+    dy[count] = ray.direction.y();
+    dz[count] = ray.direction.z();
+    invDx[count] = 1.0f / dx[count];
+    invDy[count] = 1.0f / dy[count];
+    invDz[count] = 1.0f / dz[count];
+    return count++;
+}
+
+namespace {
+
+std::uint64_t boxMaskScalar(const AABB& box, const RayPacket& packet, const float* bestDistSq, std::uint64_t mask) {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    std::uint64_t result = 0;
+    for (std::uint64_t rest = mask; rest != 0; rest &= rest - 1) {
+        int i = std::countr_zero(rest);
+        const float origin[3] = {packet.ox[i], packet.oy[i], packet.oz[i]};
+        const float invDir[3] = {packet.invDx[i], packet.invDy[i], packet.invDz[i]};
+        if (box.distanceSquared(origin) > bestDistSq[i]) continue;
+        if (!box.intersects(origin, invDir, -inf, inf)) continue;
+        result |= std::uint64_t(1) << i;
+    }
+    return result;
+}
+
+#ifdef RAY_PACKET_HAVE_X86
+// AABB::intersects and AABB::distanceSquared for 8 rays at once. The swap and
+// the min/max updates are blends on the same comparisons, so a NaN slab
+// distance leaves the interval alone exactly as in the scalar test; checking
+// tMin > tMax once at the end is equivalent to the scalar early exit because
+// the interval only ever shrinks.
+__attribute__((target("avx2")))
+std::uint64_t boxMaskAvx2(const AABB& box, const RayPacket& packet, const float* bestDistSq, std::uint64_t mask) {
+    const float* origins[3] = {packet.ox, packet.oy, packet.oz};
+    const float* invDirs[3] = {packet.invDx, packet.invDy, packet.invDz};
+    std::uint64_t result = 0;
+    for (int base = 0; base < packet.count; base += 8) {
+        if (((mask >> base) & 0xff) == 0) continue;
+        __m256 tMin = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+        __m256 tMax = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+        __m256 distSq = _mm256_setzero_ps();
+        for (int axis = 0; axis < 3; axis++) {
+            __m256 origin = _mm256_load_ps(origins[axis] + base);
+            __m256 invDir = _mm256_load_ps(invDirs[axis] + base);
+            __m256 toMin = _mm256_sub_ps(_mm256_set1_ps(box.min[axis]), origin);
+            __m256 fromMax = _mm256_sub_ps(origin, _mm256_set1_ps(box.max[axis]));
+
+            __m256 t0 = _mm256_mul_ps(toMin, invDir);
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(box.max[axis]), origin), invDir);
+            __m256 swap = _mm256_cmp_ps(t0, t1, _CMP_GT_OQ);
+            __m256 lo = _mm256_blendv_ps(t0, t1, swap);
+            __m256 hi = _mm256_blendv_ps(t1, t0, swap);
+            tMin = _mm256_blendv_ps(tMin, lo, _mm256_cmp_ps(lo, tMin, _CMP_GT_OQ));
+            tMax = _mm256_blendv_ps(tMax, hi, _mm256_cmp_ps(hi, tMax, _CMP_LT_OQ));
+
+            __m256 d = _mm256_max_ps(_mm256_max_ps(toMin, _mm256_setzero_ps()), fromMax);
+            distSq = _mm256_add_ps(distSq, _mm256_mul_ps(d, d));
+        }
+        __m256 enter = _mm256_and_ps(_mm256_cmp_ps(tMin, tMax, _CMP_LE_OQ),
+                                     _mm256_cmp_ps(distSq, _mm256_loadu_ps(bestDistSq + base), _CMP_LE_OQ));
+        result |= std::uint64_t(_mm256_movemask_ps(enter)) << base;
+    }
+    return result & mask;
+}
+#endif
+
+}
+
+
+namespace ray_packet {
+
+std::uint64_t boxMask(const AABB& box, const RayPacket& packet, const float* bestDistSq, std::uint64_t mask,
+                      SimdLevel level) {
+#ifdef RAY_PACKET_HAVE_X86
+    if (level >= SimdLevel::AVX2 && detectSimdLevel() >= SimdLevel::AVX2) {
+        return boxMaskAvx2(box, packet, bestDistSq, mask);
+    }
+#endif
+    return boxMaskScalar(box, packet, bestDistSq, mask);
+}
+
+}
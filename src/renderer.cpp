@@ -0,0 +1,126 @@
+#include "renderer.hpp"
+#include <algorithm>
+#include <numbers>
+#include <optional>
+
+
+Ray primaryRay(const Scene& scene, int height, int width, int i, int j) {
+    // Convert (i,j) to x,y,z point around camera
+    return Ray{scene.cam()->getRayOrigin(height, width, i, j), scene.cam()->orientation()};
+}
+
+namespace {
+
+// Uniform numbers in [0, 1) for pixel (i, j) and light index, derived from
+// the pixel rather than from a shared generator so every tile, thread count
+// and packet size renders the same image.
+std::uint32_t hashPixel(std::uint32_t i, std::uint32_t j, std::uint32_t light, std::uint32_t dimension) {
+    std::uint32_t h = i * 0x9E3779B1u ^ (j + 0x7F4A7C15u) * 0x85EBCA77u ^ (light * 4 + dimension) * 0xC2B2AE3Du;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return h;
+}
+
+float unitFloat(std::uint32_t bits) {
+    return static_cast<float>(bits >> 8) * (1.0f / (1u << 24));
+}
+
+}
+
+std::array<std::uint8_t, 3> shadeHit(const Scene& scene, const std::optional<HitInfo>& hit, int i, int j) {
+    std::array<std::uint8_t, 3> color = {0, 0, 0};
+    if (!hit.has_value()) return color;
+
+    // If intersects, check if bounce angle hits the light. That is a yes/no
+    // question, so no HitInfo is built.
+    // TODO: Refactor to work with n-bounces
+    // TODO: Calc color correctly
+    for (const std::unique_ptr<Light>& light : scene.lights()) {
+        float t;
+        if (!sphereHitDistance(light->position(), light->radius(), hit->point, hit->bounceDir, t)) continue;
+        TRACE(Debug, Shade, "pixel (%d, %d) object %u lit", i, j, hit->objectId);
+        color = {125, 255, 0};
+    }
+
+    // Analytic lights: one sample toward each, one shadow ray each, diffuse
+    // response added on top. Shadow rays only look ahead of the shading
+    // point, starting a little past it (scaled with its coordinates) so
+    // rounding at a surface touching it does not count.
+    const std::vector<AnalyticLight>& lights = scene.analyticLights();
+    if (lights.empty()) return color;
+    const float shadowStart = 1e-4f * std::max(1.0f, hit->point.linfNorm());
+    float radiance[3] = {0, 0, 0};
+    for (std::size_t k = 0; k < lights.size(); k++) {
+        float u = unitFloat(hashPixel(i, j, static_cast<std::uint32_t>(k), 0));
+        float v = unitFloat(hashPixel(i, j, static_cast<std::uint32_t>(k), 1));
+        LightSample sample = lights[k].sample(hit->point, u, v);
+        float cosine = hit->normal.dot(sample.direction);
+        if (!(cosine > 0) || !(sample.distance > 0)) continue;
+        if (scene.occluded(hit->point, sample.direction, shadowStart, sample.distance, hit->objectId)) continue;
+        for (int c = 0; c < 3; c++) radiance[c] += sample.weight[c] * cosine;
+    }
+    Material material = scene.material(hit->objectId);
+    for (int c = 0; c < 3; c++) {
+        // Lambertian: albedo / pi times the irradiance.
+        float value = color[c] + 255 * material.color[c] * radiance[c] / std::numbers::pi_v<float>;
+        color[c] = static_cast<std::uint8_t>(std::clamp(value, 0.0f, 255.0f));
+    }
+    return color;
+}
+
+std::array<std::uint8_t, 3> shadePixel(const Scene& scene, int height, int width, int i, int j) {
+    // Find the closest object along the ray.
+    return shadeHit(scene, scene.intersect(primaryRay(scene, height, width, i, j)), i, j);
+}
+
+
+Renderer::Renderer(RenderSettings settings)
+    : _settings(settings), _pool(settings.threads) {}
+
+void Renderer::render(const Scene& scene, Framebuffer& frame) {
+    const int height = _settings.height;
+    const int width = _settings.width;
+    const int tileSize = std::max(1, _settings.tileSize);
+    const int packetSize = std::clamp(_settings.packetSize, 1, kMaxPacketSize);
+    frame.resize(width, height);
+
+    const int tilesY = (height + tileSize - 1) / tileSize;
+    const int tilesX = (width + tileSize - 1) / tileSize;
+
+    _pool.parallelFor(static_cast<std::size_t>(tilesY) * tilesX, [&](std::size_t index) {
+        FramebufferTile tile = frame.tile(static_cast<int>(index % tilesX) * tileSize,
+                                          static_cast<int>(index / tilesX) * tileSize, tileSize, tileSize);
+        if (packetSize == 1) {
+            for (int y = 0; y < tile.height(); y++) {
+                for (int x = 0; x < tile.width(); x++) {
+                    tile.setPixel(x, y, shadePixel(scene, height, width, tile.y0() + y, tile.x0() + x));
+                }
+            }
+            return;
+        }
+        RayPacket packet;
+        std::optional<HitInfo> hits[RayPacket::kMaxRays];
+        for (int by = 0; by < tile.height(); by += packetSize) {
+            for (int bx = 0; bx < tile.width(); bx += packetSize) {
+                const int rows = std::min(packetSize, tile.height() - by);
+                const int cols = std::min(packetSize, tile.width() - bx);
+                packet.count = 0;
+                for (int y = by; y < by + rows; y++) {
+                    for (int x = bx; x < bx + cols; x++) {
+                        packet.add(primaryRay(scene, height, width, tile.y0() + y, tile.x0() + x));
+                    }
+                }
+                scene.intersect(packet, hits);
+                int n = 0;
+                for (int y = by; y < by + rows; y++) {
+                    for (int x = bx; x < bx + cols; x++) {
+                        tile.setPixel(x, y, shadeHit(scene, hits[n++], tile.y0() + y, tile.x0() + x));
+                    }
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,207 @@
+#include "scene.hpp"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+void Scene::addObject(std::unique_ptr<SceneObject> obj) {
+    const std::uint32_t idx = static_cast<std::uint32_t>(_objects.size());
+    if (dynamic_cast<const SphereSceneObject*>(obj.get()) != nullptr) {
+        _sphereSlot.push_back(_spheres.add(obj->position(), obj->radius(), materialFor(*obj), idx));
+    } else {
+        _sphereSlot.push_back(SphereStore::kNoSlot);
+        _otherObjects.push_back(idx);
+    }
+    _objects.push_back(std::move(obj));
+    dropBVH();
+}
+
+void Scene::reserveObjects(std::size_t count) {
+    _objects.reserve(count);
+    _sphereSlot.reserve(count);
+    _spheres.reserve(count);
+}
+
+void Scene::refreshObject(std::size_t idx) {
+    const SceneObject& obj = *_objects[idx];
+    if (std::uint32_t slot = _sphereSlot[idx]; slot != SphereStore::kNoSlot) {
+        _spheres.set(slot, obj.position(), obj.radius());
+        // Moving an object keeps its material; only a new colour needs one.
+        Material material;
+        for (int c = 0; c < 4; c++) material.color[c] = obj.color().get(c);
+        if (!(_materials[_spheres.material()[slot]] == material)) _spheres.setMaterial(slot, materialFor(obj));
+    }
+    if (!_bvh.empty() && !_isDirty[idx]) {
+        _isDirty[idx] = true;
+        _dirty.push_back(static_cast<std::uint32_t>(idx));
+    }
+}
+
+void Scene::setPosition(std::size_t idx, float x, float y, float z) {
+    _objects[idx]->setPosition(x, y, z);
+    refreshObject(idx);
+}
+
+void Scene::setRadius(std::size_t idx, float radius) {
+    _objects[idx]->setRadius(radius);
+    refreshObject(idx);
+}
+
+void Scene::setBVH(BVH bvh) {
+    if (bvh.indices().size() != _objects.size()) throw std::invalid_argument("BVH does not cover the scene's objects");
+    // With a repeated index some object would be in no leaf, and never hit.
+    std::vector<bool> seen(_objects.size());
+    for (std::uint32_t idx : bvh.indices()) {
+        if (idx >= _objects.size()) throw std::invalid_argument("BVH index out of range");
+        if (seen[idx]) throw std::invalid_argument("BVH index repeated");
+        seen[idx] = true;
+    }
+    _bvh = std::move(bvh);
+    _wideBvh = WideBVH<8>(_bvh);
+    _builtSahCost = _bvh.sahCost();
+    _dirty.clear();
+    _isDirty.assign(_objects.size(), false);
+    _leafSpheres = SphereStore();
+    _leafSpheres.reserve(_bvh.indices().size());
+    _leafPosition.resize(_objects.size());
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (std::uint32_t idx : _bvh.indices()) {
+        _leafPosition[idx] = static_cast<std::uint32_t>(_leafSpheres.size());
+        std::uint32_t slot = _sphereSlot[idx];
+        if (slot == SphereStore::kNoSlot) {
+            _leafSpheres.add(Vector3D(), nan, 0, idx);
+        } else {
+            _leafSpheres.add(_spheres.center(slot), _spheres.radius()[slot], _spheres.material()[slot], idx);
+        }
+    }
+}
+
+void Scene::dropBVH() {
+    _bvh = BVH();
+    _wideBvh = WideBVH<8>();
+    _dirty.clear();
+    _isDirty.clear();
+    _leafSpheres = SphereStore();
+    _leafPosition.clear();
+}
+
+BVHUpdate Scene::updateBVH(const BVHBuildOptions& options) {
+    if (_dirty.empty()) return BVHUpdate::None;
+    std::vector<std::uint32_t> updated = _bvh.refit(_objects, _dirty, options.pool);
+    if (_bvh.sahCost() > _builtSahCost * options.rebuildSahGrowth) {
+        buildBVH(options);
+        return BVHUpdate::Rebuild;
+    }
+    _wideBvh.refit(_bvh, updated);
+    for (std::uint32_t idx : _dirty) {
+        _isDirty[idx] = false;
+        std::uint32_t slot = _sphereSlot[idx];
+        if (slot == SphereStore::kNoSlot) continue;
+        _leafSpheres.set(_leafPosition[idx], _spheres.center(slot), _spheres.radius()[slot]);
+        _leafSpheres.setMaterial(_leafPosition[idx], _spheres.material()[slot]);
+    }
+    _dirty.clear();
+    return BVHUpdate::Refit;
+}
+
+std::uint32_t Scene::materialFor(const SceneObject& obj) {
+    Material material;
+    for (int c = 0; c < 4; c++) material.color[c] = obj.color().get(c);
+    if (_materials.empty() || !(_materials.back() == material)) _materials.push_back(material);
+    return static_cast<std::uint32_t>(_materials.size() - 1);
+}
+
+Material Scene::material(std::size_t idx) const {
+    std::uint32_t slot = _sphereSlot[idx];
+    if (slot != SphereStore::kNoSlot) return _materials[_spheres.material()[slot]];
+    Material material;
+    for (int c = 0; c < 4; c++) material.color[c] = _objects[idx]->color().get(c);
+    return material;
+}
+
+void Scene::leafHits(const Ray& ray, std::uint32_t first, std::uint32_t count,
+                     std::optional<PrimitiveHit>& best) const {
+    sphere_kernels::nearest(_leafSpheres.arrays(), first, first + count, ray, best);
+    if (_otherObjects.empty()) return;
+    const std::uint32_t* indices = _bvh.indices().data();
+    for (std::uint32_t i = first; i < first + count; i++) {
+        if (_sphereSlot[indices[i]] != SphereStore::kNoSlot) continue;
+        std::optional<HitInfo> hit = _objects[indices[i]]->intersect(ray.origin, ray.direction);
+        if (!hit) continue;
+        PrimitiveHit candidate{indices[i], hit->t};
+        if (!best || candidate.closerThan(*best)) best = candidate;
+    }
+}
+
+std::optional<HitInfo> Scene::finishHit(const Ray& ray, const std::optional<PrimitiveHit>& best) const {
+    if (!best) return std::nullopt;
+
+    if (std::uint32_t slot = _sphereSlot[best->index]; slot != SphereStore::kNoSlot) {
+        return _spheres.hitInfo(slot, ray, best->t);
+    }
+    std::optional<HitInfo> hit = _objects[best->index]->intersect(ray.origin, ray.direction);
+    hit->objectId = best->index;
+    return hit;
+}
+
+std::optional<HitInfo> Scene::intersect(const Ray& ray) const {
+    std::optional<PrimitiveHit> best;
+    if (!_bvh.empty() && _dirty.empty()) {
+        _wideBvh.closestLeafHit(ray, best, [&](std::uint32_t first, std::uint32_t count,
+                                               std::optional<PrimitiveHit>& closest) {
+            leafHits(ray, first, count, closest);
+        });
+    } else {
+        _spheres.nearest(ray, 0, static_cast<std::uint32_t>(_spheres.size()), best);
+        for (std::uint32_t idx : _otherObjects) {
+            std::optional<HitInfo> hit = _objects[idx]->intersect(ray.origin, ray.direction);
+            if (!hit) continue;
+            PrimitiveHit candidate{idx, hit->t};
+            if (!best || candidate.closerThan(*best)) best = candidate;
+        }
+    }
+    return finishHit(ray, best);
+}
+
+bool Scene::otherBlocks(std::uint32_t idx, const Ray& ray, float tmin, float tmax, std::uint32_t ignore) const {
+    if (idx == ignore) return false;
+    std::optional<HitInfo> hit = _objects[idx]->intersect(ray.origin, ray.direction);
+    return hit && hit->t > tmin && hit->t < tmax;
+}
+
+bool Scene::occluded(const Vector3D& origin, const Vector3D& dir, float tmin, float tmax, std::uint32_t ignore) const {
+    const Ray ray{origin, dir};
+    if (!_bvh.empty() && _dirty.empty()) {
+        const std::uint32_t* indices = _bvh.indices().data();
+        return _wideBvh.anyLeafHit(ray, tmin, tmax, [&](std::uint32_t first, std::uint32_t count) {
+            if (sphere_kernels::any(_leafSpheres.arrays(), first, first + count, ray, tmin, tmax, ignore)) return true;
+            if (_otherObjects.empty()) return false;
+            for (std::uint32_t i = first; i < first + count; i++) {
+                if (_sphereSlot[indices[i]] == SphereStore::kNoSlot &&
+                    otherBlocks(indices[i], ray, tmin, tmax, ignore)) {
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+    const std::uint32_t count = static_cast<std::uint32_t>(_spheres.size());
+    if (sphere_kernels::any(_spheres.arrays(), 0, count, ray, tmin, tmax, ignore)) return true;
+    for (std::uint32_t idx : _otherObjects) {
+        if (otherBlocks(idx, ray, tmin, tmax, ignore)) return true;
+    }
+    return false;
+}
+
+void Scene::intersect(const RayPacket& packet, std::optional<HitInfo>* hits) const {
+    if (_bvh.empty() || !_dirty.empty()) {
+        for (int i = 0; i < packet.count; i++) hits[i] = intersect(packet.ray(i));
+        return;
+    }
+    std::optional<PrimitiveHit> best[RayPacket::kMaxRays];
+    bvh_detail::closestLeafHits(_bvh.nodes().data(), packet, best,
+                                [&](int i, std::uint32_t first, std::uint32_t count, std::optional<PrimitiveHit>& closest) {
+        leafHits(packet.ray(i), first, count, closest);
+    });
+    for (int i = 0; i < packet.count; i++) hits[i] = finishHit(packet.ray(i), best[i]);
+}
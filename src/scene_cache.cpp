@@ -0,0 +1,272 @@
+#include "scene_cache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+using namespace scene_cache;
+
+namespace {
+
+std::uint64_t alignUp(std::uint64_t value) {
+    return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+SphereRecord toRecord(const SceneObject& obj) {
+    SphereRecord record;
+    record.center[0] = obj.position().x();
+    record.center[1] = obj.position().y();
+    record.center[2] = obj.position().z();
+    record.radius = obj.radius();
+    for (int c = 0; c < 4; c++) record.color[c] = obj.color().get(c);
+    return record;
+}
+
+[[noreturn]] void corrupt(const std::string& what) {
+    throw std::runtime_error("Invalid scene cache: " + what);
+}
+
+}
+
+
+void writeSceneCache(const std::string& path, const Scene& scene, const RenderSettings& settings) {
+    std::vector<SphereRecord> spheres;
+    spheres.reserve(scene.objects().size());
+    for (const SceneObject* obj : scene.objects()) {
+        if (dynamic_cast<const SphereSceneObject*>(obj) == nullptr) {
+            throw std::invalid_argument("Only spheres can be stored in a scene cache.");
+        }
+        spheres.push_back(toRecord(*obj));
+    }
+    std::vector<SphereRecord> lights;
+    for (const auto& light : scene.lights()) {
+        lights.push_back(toRecord(*light));
+    }
+    BVH built;
+    // A tree waiting for a refit no longer matches the objects.
+    const BVH& bvh = scene.bvh().empty() || scene.bvhDirty() ? (built = BVH(scene.objects())) : scene.bvh();
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.width = settings.width;
+    header.height = settings.height;
+    header.tileSize = settings.tileSize;
+    header.threads = static_cast<std::uint32_t>(settings.threads);
+    if (const Camera* cam = scene.cam().get()) {
+        header.camera = CameraRecord{{cam->position().x(), cam->position().y(), cam->position().z()},
+                                     {cam->orientation().x(), cam->orientation().y(), cam->orientation().z()},
+                                     cam->sizeOfLens(), 1};
+    }
+
+    std::uint64_t offset = alignUp(sizeof(Header));
+    auto place = [&](Section& section, std::size_t count, std::size_t elementSize) {
+        section = Section{offset, count};
+        offset = alignUp(offset + count * elementSize);
+    };
+    place(header.spheres, spheres.size(), sizeof(SphereRecord));
+    place(header.lights, lights.size(), sizeof(SphereRecord));
+    place(header.analyticLights, scene.analyticLights().size(), sizeof(AnalyticLight));
+    place(header.nodes, bvh.nodes().size(), sizeof(BVH::Node));
+    place(header.indices, bvh.indices().size(), sizeof(std::uint32_t));
+    header.fileSize = offset;
+
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    bool ok = file != nullptr;
+    std::uint64_t written = 0;
+    auto write = [&](std::uint64_t at, const void* data, std::size_t bytes) {
+        static const char zeros[kSectionAlignment] = {};
+        // Empty sections have no data pointer; only their padding is written.
+        ok = ok && std::fwrite(zeros, 1, at - written, file.get()) == at - written &&
+             (bytes == 0 || std::fwrite(data, 1, bytes, file.get()) == bytes);
+        written = at + bytes;
+    };
+    write(0, &header, sizeof(header));
+    write(header.spheres.offset, spheres.data(), spheres.size() * sizeof(SphereRecord));
+    write(header.lights.offset, lights.data(), lights.size() * sizeof(SphereRecord));
+    write(header.analyticLights.offset, scene.analyticLights().data(),
+          scene.analyticLights().size() * sizeof(AnalyticLight));
+    write(header.nodes.offset, bvh.nodes().data(), bvh.nodes().size() * sizeof(BVH::Node));
+    write(header.indices.offset, bvh.indices().data(), bvh.indices().size() * sizeof(std::uint32_t));
+    write(header.fileSize, nullptr, 0);
+    if (!ok || std::fclose(file.release()) != 0) throw std::runtime_error("Cannot write scene cache: " + path);
+}
+
+
+SceneCache::SceneCache(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open scene cache: " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat scene cache: " + path);
+    }
+    _size = static_cast<std::size_t>(info.st_size);
+    if (_size < sizeof(Header)) {
+        ::close(fd);
+        corrupt("file too small");
+    }
+    void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) throw std::runtime_error("Cannot map scene cache: " + path);
+    _data = data;
+
+    try {
+        const Header& h = header();
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) corrupt("bad magic");
+        if (h.version != kVersion) corrupt("version " + std::to_string(h.version) + ", expected " + std::to_string(kVersion));
+        if (h.byteOrder != kByteOrder) corrupt("written on a host with different byte order");
+        if (h.fileSize != _size) corrupt("truncated");
+        // The limits scene files and the command line hold render settings to.
+        auto inSize = [](std::int32_t size) { return size > 0 && size <= kMaxImageSize; };
+        if (!inSize(h.width) || !inSize(h.height) || !inSize(h.tileSize)) corrupt("render size out of range");
+        if (h.threads > kMaxThreads) corrupt("thread count out of range");
+        auto check = [&](const Section& s, std::size_t elementSize, const char* name) {
+            if (s.offset % kSectionAlignment != 0 || s.offset > _size || s.count > (_size - s.offset) / elementSize) {
+                corrupt(std::string(name) + " section out of bounds");
+            }
+        };
+        check(h.spheres, sizeof(SphereRecord), "sphere");
+        check(h.lights, sizeof(SphereRecord), "light");
+        check(h.analyticLights, sizeof(AnalyticLight), "analytic light");
+        check(h.nodes, sizeof(BVH::Node), "node");
+        check(h.indices, sizeof(std::uint32_t), "index");
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+SceneCache::~SceneCache() {
+    unmap();
+}
+
+SceneCache::SceneCache(SceneCache&& other) noexcept
+    : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+SceneCache& SceneCache::operator=(SceneCache&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+void SceneCache::unmap() {
+    if (_data) ::munmap(_data, _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+RenderSettings SceneCache::settings() const {
+    RenderSettings settings;
+    settings.width = header().width;
+    settings.height = header().height;
+    settings.tileSize = header().tileSize;
+    settings.threads = header().threads;
+    return settings;
+}
+
+Camera SceneCache::camera() const {
+    const CameraRecord& c = header().camera;
+    return Camera(c.position[0], c.position[1], c.position[2], c.orientation[0], c.orientation[1], c.orientation[2],
+                  c.sizeOfLens);
+}
+
+std::optional<HitInfo> SceneCache::intersect(const Ray& ray) const {
+    std::span<const BVH::Node> tree = nodes();
+    if (tree.empty()) return std::nullopt;
+    std::span<const SphereRecord> records = spheres();
+    auto center = [&](std::uint32_t idx) {
+        return Vector3D(records[idx].center[0], records[idx].center[1], records[idx].center[2]);
+    };
+    std::optional<PrimitiveHit> best =
+        bvh_detail::closestPrimitive(tree.data(), indices().data(), ray, [&](std::uint32_t idx, float& t) {
+            return sphereHitDistance(center(idx), records[idx].radius, ray.origin, ray.direction, t);
+        });
+    if (!best) return std::nullopt;
+    HitInfo hit = sphereHitInfo(center(best->index), records[best->index].radius, ray.origin, ray.direction, best->t);
+    hit.objectId = best->index;
+    return hit;
+}
+
+void SceneCache::verify() const {
+    for (const AnalyticLight& light : analyticLights()) {
+        if (light.type != LightType::Point && light.type != LightType::Directional && light.type != LightType::Sphere) {
+            corrupt("unknown light type");
+        }
+    }
+    std::span<const BVH::Node> tree = nodes();
+    std::span<const std::uint32_t> order = indices();
+    if (tree.empty()) {
+        if (!spheres().empty()) corrupt("spheres without a BVH");
+        return;
+    }
+    if (order.size() != spheres().size()) corrupt("BVH does not cover every sphere");
+    std::vector<bool> seen(order.size());
+    for (std::uint32_t idx : order) {
+        if (idx >= spheres().size()) corrupt("BVH index out of range");
+        if (seen[idx]) corrupt("BVH index repeated");
+        seen[idx] = true;
+    }
+    // Walks the tree from the root. Children always follow their parent, so
+    // there are no cycles; each node may be reached only once, and no deeper
+    // than the traversal stacks allow.
+    struct Entry {
+        std::uint32_t node;
+        int depth;
+    };
+    std::vector<bool> reached(tree.size());
+    std::vector<Entry> stack = {{0, 1}};
+    reached[0] = true;
+    while (!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.depth > BVH::kMaxDepth) corrupt("BVH deeper than " + std::to_string(BVH::kMaxDepth) + " levels");
+        const BVH::Node& node = tree[entry.node];
+        if (node.isLeaf()) {
+            if (node.count > BVH::kMaxLeafSize || node.leftFirst + std::uint64_t(node.count) > order.size()) {
+                corrupt("BVH leaf out of range");
+            }
+            continue;
+        }
+        if (node.leftFirst <= entry.node || node.leftFirst + std::uint64_t(1) >= tree.size()) {
+            corrupt("BVH node out of range");
+        }
+        for (std::uint32_t child : {node.leftFirst, node.leftFirst + 1}) {
+            if (reached[child]) corrupt("BVH node reached twice");
+            reached[child] = true;
+            stack.push_back({child, entry.depth + 1});
+        }
+    }
+}
+
+void SceneCache::toScene(Scene& scene) const {
+    verify();
+    scene.reserveObjects(scene.objects().size() + spheres().size());
+    for (const SphereRecord& s : spheres()) {
+        scene.addObject(std::make_unique<SphereSceneObject>(s.center[0], s.center[1], s.center[2], s.color[0],
+                                                            s.color[1], s.color[2], s.color[3], s.radius));
+    }
+    for (const SphereRecord& s : lights()) {
+        scene.addLight(std::make_unique<Light>(s.center[0], s.center[1], s.center[2], s.color[0], s.color[1],
+                                               s.color[2], s.radius));
+    }
+    for (const AnalyticLight& light : analyticLights()) scene.addAnalyticLight(light);
+    if (hasCamera()) scene.setCamera(std::make_unique<Camera>(camera()));
+    if (scene.objects().size() == spheres().size()) {
+        scene.setBVH(BVH(std::vector<BVH::Node>(nodes().begin(), nodes().end()),
+                         std::vector<std::uint32_t>(indices().begin(), indices().end())));
+    } else {
+        scene.buildBVH();
+    }
+}
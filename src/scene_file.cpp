@@ -0,0 +1,265 @@
+#include "scene_file.hpp"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr std::size_t kReadChunk = std::size_t(1) << 20;
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Cursor over one line; every read skips leading blanks.
+struct Fields {
+    const char* pos;
+    const char* end;
+
+    void skipBlanks() {
+        while (pos < end && isBlank(*pos)) pos++;
+    }
+
+    std::string_view word() {
+        skipBlanks();
+        const char* start = pos;
+        while (pos < end && !isBlank(*pos)) pos++;
+        return std::string_view(start, pos - start);
+    }
+
+    template <typename T>
+    bool number(T& value) {
+        skipBlanks();
+        auto [next, error] = std::from_chars(pos, end, value);
+        if (error != std::errc() || (next < end && !isBlank(*next))) return false;
+        pos = next;
+        return true;
+    }
+
+    bool atEnd() {
+        skipBlanks();
+        return pos == end;
+    }
+};
+
+template <std::size_t N>
+bool readFloats(Fields& fields, float (&values)[N]) {
+    for (float& value : values) {
+        if (!fields.number(value)) return false;
+    }
+    return fields.atEnd();
+}
+
+void appendFloat(std::string& out, float value) {
+    char buffer[32];
+    auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out += ' ';
+    out.append(buffer, end);
+}
+
+}
+
+
+SceneParser::SceneParser(Scene& scene, RenderSettings& settings) : _scene(scene), _settings(settings) {}
+
+void SceneParser::feed(const char* data, std::size_t size) {
+    _stats.bytes += size;
+    const char* end = data + size;
+
+    if (_carrySize > 0) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+        std::size_t take = (newline ? newline : end) - data;
+        if (_carrySize + take > kMaxLineLength) {
+            _stats.lines++;
+            fail("line too long");
+        }
+        std::memcpy(_carry + _carrySize, data, take);
+        _carrySize += take;
+        if (!newline) return;
+        parseLine(std::string_view(_carry, _carrySize));
+        _carrySize = 0;
+        data = newline + 1;
+    }
+
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        if (!newline) {
+            if (static_cast<std::size_t>(end - data) > kMaxLineLength) {
+                _stats.lines++;
+                fail("line too long");
+            }
+            std::memcpy(_carry, data, end - data);
+            _carrySize = end - data;
+            return;
+        }
+        parseLine(std::string_view(data, newline - data));
+        data = newline + 1;
+    }
+}
+
+void SceneParser::finish() {
+    if (_carrySize > 0) parseLine(std::string_view(_carry, _carrySize));
+    _carrySize = 0;
+}
+
+void SceneParser::parseLine(std::string_view line) {
+    _stats.lines++;
+    if (std::size_t hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+
+    Fields fields{line.data(), line.data() + line.size()};
+    std::string_view keyword = fields.word();
+    if (keyword.empty()) return;
+
+    if (keyword == "sphere") {
+        float v[8];
+        if (!readFloats(fields, v)) fail("sphere needs x y z r g b alpha radius");
+        _scene.addObject(std::make_unique<SphereSceneObject>(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]));
+        _stats.objects++;
+    } else if (keyword == "light") {
+        float v[7];
+        if (!readFloats(fields, v)) fail("light needs x y z r g b radius");
+        _scene.addLight(std::make_unique<Light>(v[0], v[1], v[2], v[3], v[4], v[5], v[6]));
+        _stats.lights++;
+    } else if (keyword == "pointlight") {
+        float v[7];
+        if (!readFloats(fields, v)) fail("pointlight needs x y z r g b intensity");
+        _scene.addAnalyticLight(AnalyticLight::point(Vector3D(v[0], v[1], v[2]), v[3], v[4], v[5], v[6]));
+        _stats.lights++;
+    } else if (keyword == "dirlight") {
+        float v[7];
+        if (!readFloats(fields, v)) fail("dirlight needs dx dy dz r g b intensity");
+        // The same test directional() makes, so tiny directions whose length
+        // underflows are reported with their line rather than thrown from there.
+        Vector3D direction(v[0], v[1], v[2]);
+        if (!(direction.magnitude() > 0)) fail("dirlight needs a non-zero direction");
+        _scene.addAnalyticLight(AnalyticLight::directional(direction, v[3], v[4], v[5], v[6]));
+        _stats.lights++;
+    } else if (keyword == "spherelight") {
+        float v[8];
+        if (!readFloats(fields, v)) fail("spherelight needs x y z r g b intensity radius");
+        if (!(v[7] > 0)) fail("spherelight needs a positive radius");
+        _scene.addAnalyticLight(AnalyticLight::sphere(Vector3D(v[0], v[1], v[2]), v[7], v[3], v[4], v[5], v[6]));
+        _stats.lights++;
+    } else if (keyword == "camera") {
+        float v[7];
+        if (!readFloats(fields, v)) fail("camera needs x y z angleX angleY angleZ sizeOfLens");
+        _scene.setCamera(std::make_unique<Camera>(v[0], v[1], v[2], v[3], v[4], v[5], v[6]));
+    } else if (keyword == "render") {
+        RenderSettings settings = _settings;
+        if (!fields.number(settings.width) || !fields.number(settings.height) || settings.width <= 0 ||
+            settings.height <= 0 || settings.width > kMaxImageSize || settings.height > kMaxImageSize) {
+            fail("render needs width height [tileSize] [threads], sizes from 1 to 65536");
+        }
+        if (!fields.atEnd() && (!fields.number(settings.tileSize) || settings.tileSize <= 0 ||
+                                settings.tileSize > kMaxImageSize)) {
+            fail("bad tile size, expected 1 to 65536");
+        }
+        if (!fields.atEnd() && (!fields.number(settings.threads) || settings.threads > kMaxThreads)) {
+            fail("bad thread count, expected 0 (every hardware thread) to 4096");
+        }
+        if (!fields.atEnd()) fail("too many fields for render");
+        _settings = settings;
+    } else {
+        fail("unknown record");
+    }
+}
+
+void SceneParser::fail(const char* message) const {
+    throw std::runtime_error("Scene line " + std::to_string(_stats.lines) + ": " + message);
+}
+
+
+SceneFileStats loadScene(const std::string& path, Scene& scene, RenderSettings& settings) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file) throw std::runtime_error("Cannot open scene: " + path);
+
+    SceneParser parser(scene, settings);
+    std::unique_ptr<char[]> chunk(new char[kReadChunk]);
+    while (std::size_t size = std::fread(chunk.get(), 1, kReadChunk, file.get())) {
+        parser.feed(chunk.get(), size);
+    }
+    if (std::ferror(file.get())) throw std::runtime_error("Cannot read scene: " + path);
+    parser.finish();
+    return parser.stats();
+}
+
+SceneFileStats loadSceneFromString(std::string_view text, Scene& scene, RenderSettings& settings) {
+    SceneParser parser(scene, settings);
+    parser.feed(text.data(), text.size());
+    parser.finish();
+    return parser.stats();
+}
+
+namespace {
+
+// Formats scene line by line into out, handing out to flush whenever it grows
+// past a chunk so large scenes are never held as one string.
+template <typename Flush>
+void formatScene(const Scene& scene, const RenderSettings& settings, std::string& out, Flush&& flush) {
+    out += "render " + std::to_string(settings.width) + " " + std::to_string(settings.height) + " " +
+           std::to_string(settings.tileSize) + " " + std::to_string(settings.threads) + "\n";
+    if (const Camera* cam = scene.cam().get()) {
+        out += "camera";
+        for (float v : {cam->position().x(), cam->position().y(), cam->position().z(), cam->orientation().x(),
+                        cam->orientation().y(), cam->orientation().z(), cam->sizeOfLens()}) {
+            appendFloat(out, v);
+        }
+        out += '\n';
+    }
+    for (const auto& light : scene.lights()) {
+        out += "light";
+        for (float v : {light->position().x(), light->position().y(), light->position().z(), light->color().get(0),
+                        light->color().get(1), light->color().get(2), light->radius()}) {
+            appendFloat(out, v);
+        }
+        out += '\n';
+    }
+    for (const AnalyticLight& light : scene.analyticLights()) {
+        const float* p = light.type == LightType::Directional ? light.direction : light.position;
+        switch (light.type) {
+            case LightType::Point: out += "pointlight"; break;
+            case LightType::Directional: out += "dirlight"; break;
+            case LightType::Sphere: out += "spherelight"; break;
+        }
+        for (float v : {p[0], p[1], p[2], light.color[0], light.color[1], light.color[2], light.intensity}) {
+            appendFloat(out, v);
+        }
+        if (light.type == LightType::Sphere) appendFloat(out, light.radius);
+        out += '\n';
+    }
+    for (const SceneObject* obj : scene.objects()) {
+        if (dynamic_cast<const SphereSceneObject*>(obj) == nullptr) {
+            throw std::invalid_argument("Only spheres can be saved to a scene file.");
+        }
+        out += "sphere";
+        for (float v : {obj->position().x(), obj->position().y(), obj->position().z(), obj->color().get(0),
+                        obj->color().get(1), obj->color().get(2), obj->color().get(3), obj->radius()}) {
+            appendFloat(out, v);
+        }
+        out += '\n';
+        if (out.size() >= kReadChunk) flush(out);
+    }
+    flush(out);
+}
+
+}
+
+std::string sceneToString(const Scene& scene, const RenderSettings& settings) {
+    std::string out;
+    formatScene(scene, settings, out, [](std::string&) {});
+    return out;
+}
+
+void saveScene(const std::string& path, const Scene& scene, const RenderSettings& settings) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    bool ok = file != nullptr;
+    std::string out;
+    formatScene(scene, settings, out, [&](std::string& chunk) {
+        ok = ok && std::fwrite(chunk.data(), 1, chunk.size(), file.get()) == chunk.size();
+        chunk.clear();
+    });
+    if (!ok || std::fclose(file.release()) != 0) throw std::runtime_error("Cannot write scene: " + path);
+}
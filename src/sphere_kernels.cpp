@@ -0,0 +1,335 @@
+#include "sphere_kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPHERE_KERNELS_HAVE_X86 1
+#endif
+
+
+namespace {
+
+constexpr std::uint32_t kNoHit = std::numeric_limits<std::uint32_t>::max();
+
+void merge(std::optional<PrimitiveHit>& best, std::uint32_t id, float t) {
+    PrimitiveHit hit{id, t};
+    if (!best || hit.closerThan(*best)) best = hit;
+}
+
+// sphereHitDistance() with the two tests written as ordered compares, so a
+// NaN radius is a miss; for other inputs the operations are the same.
+inline bool scalarDistance(const SphereArrays& s, std::uint32_t i, const float o[3], const float d[3], float& t) {
+    float tx = s.cx[i] - o[0], ty = s.cy[i] - o[1], tz = s.cz[i] - o[2];
+    float distSq = tx * tx + ty * ty + tz * tz;
+    float radiusSq = s.radius[i] * s.radius[i];
+    float proj = tx * d[0] + ty * d[1] + tz * d[2];
+    float x = distSq - proj * proj;
+    if (!(x <= radiusSq)) return false;
+    float y = std::sqrt(radiusSq - x);
+    if (!(distSq <= y * y)) return false;
+    t = proj - y;
+    return true;
+}
+
+void nearestScalar(const SphereArrays& s, std::uint32_t first, std::uint32_t last, const float o[3],
+                   const float d[3], std::optional<PrimitiveHit>& best) {
+    float t;
+    for (std::uint32_t i = first; i < last; i++) {
+        if (scalarDistance(s, i, o, d, t)) merge(best, s.id[i], t);
+    }
+}
+
+// sphereCrossings() for sphere i, written the same way.
+inline bool scalarCrossings(const SphereArrays& s, std::uint32_t i, const float o[3], const float d[3], float& tNear,
+                            float& tFar) {
+    float tx = s.cx[i] - o[0], ty = s.cy[i] - o[1], tz = s.cz[i] - o[2];
+    float distSq = tx * tx + ty * ty + tz * tz;
+    float radiusSq = s.radius[i] * s.radius[i];
+    float proj = tx * d[0] + ty * d[1] + tz * d[2];
+    float x = distSq - proj * proj;
+    if (!(x <= radiusSq)) return false;
+    float y = std::sqrt(radiusSq - x);
+    tNear = proj - y;
+    tFar = proj + y;
+    return true;
+}
+
+bool anyScalar(const SphereArrays& s, std::uint32_t first, std::uint32_t last, const float o[3], const float d[3],
+               float tMin, float tMax, std::uint32_t ignore) {
+    float tNear, tFar;
+    for (std::uint32_t i = first; i < last; i++) {
+        if (s.id[i] == ignore || !scalarCrossings(s, i, o, d, tNear, tFar)) continue;
+        if ((tNear > tMin && tNear < tMax) || (tFar > tMin && tFar < tMax)) return true;
+    }
+    return false;
+}
+
+#ifdef SPHERE_KERNELS_HAVE_X86
+
+// Ids are compared as signed integers after flipping the top bit, which
+// orders them as unsigned.
+constexpr std::int32_t kIdBias = std::numeric_limits<std::int32_t>::min();
+
+// Per-lane nearest hit so far; lanes without one hold |t| = inf and id kNoHit.
+struct Avx2Lanes {
+    __m256 absT, t;
+    __m256i id;
+};
+
+// Lane mask of the spheres hit, with their t.
+__attribute__((target("avx2"), always_inline)) inline __m256 avx2Distance(
+    const __m256 o[3], const __m256 d[3], __m256 cx, __m256 cy, __m256 cz, __m256 r, __m256& t) {
+    __m256 tx = _mm256_sub_ps(cx, o[0]), ty = _mm256_sub_ps(cy, o[1]), tz = _mm256_sub_ps(cz, o[2]);
+    __m256 distSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)), _mm256_mul_ps(tz, tz));
+    __m256 radiusSq = _mm256_mul_ps(r, r);
+    __m256 proj = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, d[0]), _mm256_mul_ps(ty, d[1])), _mm256_mul_ps(tz, d[2]));
+    __m256 x = _mm256_sub_ps(distSq, _mm256_mul_ps(proj, proj));
+    __m256 y = _mm256_sqrt_ps(_mm256_sub_ps(radiusSq, x));
+    t = _mm256_sub_ps(proj, y);
+    return _mm256_and_ps(_mm256_cmp_ps(x, radiusSq, _CMP_LE_OQ), _mm256_cmp_ps(distSq, _mm256_mul_ps(y, y), _CMP_LE_OQ));
+}
+
+__attribute__((target("avx2"), always_inline)) inline void avx2Step(
+    Avx2Lanes& lanes, const __m256 o[3], const __m256 d[3], __m256 cx, __m256 cy, __m256 cz, __m256 r, __m256i id,
+    __m256 valid) {
+    __m256 t;
+    __m256 hit = _mm256_and_ps(avx2Distance(o, d, cx, cy, cz, r, t), valid);
+    __m256 absT = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), t);
+    id = _mm256_xor_si256(id, _mm256_set1_epi32(kIdBias));
+    __m256 lowerId = _mm256_castsi256_ps(_mm256_cmpgt_epi32(lanes.id, id));
+    __m256 closer = _mm256_or_ps(_mm256_cmp_ps(absT, lanes.absT, _CMP_LT_OQ),
+                                 _mm256_and_ps(_mm256_cmp_ps(absT, lanes.absT, _CMP_EQ_OQ), lowerId));
+    __m256 take = _mm256_and_ps(hit, closer);
+    lanes.absT = _mm256_blendv_ps(lanes.absT, absT, take);
+    lanes.t = _mm256_blendv_ps(lanes.t, t, take);
+    lanes.id = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(lanes.id), _mm256_castsi256_ps(id), take));
+}
+
+__attribute__((target("avx2")))
+void nearestAvx2(const SphereArrays& s, std::uint32_t first, std::uint32_t last, const float o[3], const float d[3],
+                 std::optional<PrimitiveHit>& best) {
+    const __m256 origin[3] = {_mm256_set1_ps(o[0]), _mm256_set1_ps(o[1]), _mm256_set1_ps(o[2])};
+    const __m256 dir[3] = {_mm256_set1_ps(d[0]), _mm256_set1_ps(d[1]), _mm256_set1_ps(d[2])};
+    Avx2Lanes lanes{_mm256_set1_ps(std::numeric_limits<float>::infinity()), _mm256_setzero_ps(),
+                    _mm256_set1_epi32(static_cast<std::int32_t>(kNoHit ^ kIdBias))};
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    std::uint32_t i = first;
+    for (; i + 8 <= last; i += 8) {
+        avx2Step(lanes, origin, dir, _mm256_loadu_ps(s.cx + i), _mm256_loadu_ps(s.cy + i), _mm256_loadu_ps(s.cz + i),
+                 _mm256_loadu_ps(s.radius + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.id + i)), all);
+    }
+    if (i < last) {
+        // Masked-off lanes are neither read nor counted.
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<std::int32_t>(last - i)),
+                                          _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        avx2Step(lanes, origin, dir, _mm256_maskload_ps(s.cx + i, mask), _mm256_maskload_ps(s.cy + i, mask),
+                 _mm256_maskload_ps(s.cz + i, mask), _mm256_maskload_ps(s.radius + i, mask),
+                 _mm256_maskload_epi32(reinterpret_cast<const int*>(s.id + i), mask), _mm256_castsi256_ps(mask));
+    }
+
+    // Most calls (BVH leaves the ray only grazes) hit nothing.
+    __m256i missed = _mm256_cmpeq_epi32(lanes.id, _mm256_set1_epi32(static_cast<std::int32_t>(kNoHit ^ kIdBias)));
+    if (_mm256_movemask_ps(_mm256_castsi256_ps(missed)) == 0xff) return;
+    alignas(32) float t[8];
+    alignas(32) std::uint32_t id[8];
+    _mm256_store_ps(t, lanes.t);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(id), _mm256_xor_si256(lanes.id, _mm256_set1_epi32(kIdBias)));
+    for (int lane = 0; lane < 8; lane++) {
+        if (id[lane] != kNoHit) merge(best, id[lane], t[lane]);
+    }
+}
+
+// Whether the line crosses the surface of a valid lane other than id skip at
+// some lower < t < upper (see scalarCrossings).
+__attribute__((target("avx2"), always_inline)) inline bool avx2Blocked(
+    const __m256 o[3], const __m256 d[3], __m256 lower, __m256 upper, __m256i skip, __m256 cx, __m256 cy, __m256 cz,
+    __m256 r, __m256i id, __m256 valid) {
+    __m256 tx = _mm256_sub_ps(cx, o[0]), ty = _mm256_sub_ps(cy, o[1]), tz = _mm256_sub_ps(cz, o[2]);
+    __m256 distSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)), _mm256_mul_ps(tz, tz));
+    __m256 radiusSq = _mm256_mul_ps(r, r);
+    __m256 proj = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, d[0]), _mm256_mul_ps(ty, d[1])), _mm256_mul_ps(tz, d[2]));
+    __m256 x = _mm256_sub_ps(distSq, _mm256_mul_ps(proj, proj));
+    __m256 y = _mm256_sqrt_ps(_mm256_sub_ps(radiusSq, x));
+    __m256 tNear = _mm256_sub_ps(proj, y), tFar = _mm256_add_ps(proj, y);
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(x, radiusSq, _CMP_LE_OQ), valid);
+    __m256 inRange = _mm256_or_ps(
+        _mm256_and_ps(_mm256_cmp_ps(tNear, lower, _CMP_GT_OQ), _mm256_cmp_ps(tNear, upper, _CMP_LT_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(tFar, lower, _CMP_GT_OQ), _mm256_cmp_ps(tFar, upper, _CMP_LT_OQ)));
+    __m256 skipped = _mm256_castsi256_ps(_mm256_cmpeq_epi32(id, skip));
+    return _mm256_movemask_ps(_mm256_andnot_ps(skipped, _mm256_and_ps(hit, inRange))) != 0;
+}
+
+__attribute__((target("avx2")))
+bool anyAvx2(const SphereArrays& s, std::uint32_t first, std::uint32_t last, const float o[3], const float d[3],
+             float tMin, float tMax, std::uint32_t ignore) {
+    const __m256 origin[3] = {_mm256_set1_ps(o[0]), _mm256_set1_ps(o[1]), _mm256_set1_ps(o[2])};
+    const __m256 dir[3] = {_mm256_set1_ps(d[0]), _mm256_set1_ps(d[1]), _mm256_set1_ps(d[2])};
+    const __m256 lower = _mm256_set1_ps(tMin);
+    const __m256 upper = _mm256_set1_ps(tMax);
+    const __m256i skip = _mm256_set1_epi32(static_cast<std::int32_t>(ignore));
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    std::uint32_t i = first;
+    for (; i + 8 <= last; i += 8) {
+        if (avx2Blocked(origin, dir, lower, upper, skip, _mm256_loadu_ps(s.cx + i), _mm256_loadu_ps(s.cy + i),
+                        _mm256_loadu_ps(s.cz + i), _mm256_loadu_ps(s.radius + i),
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.id + i)), all)) {
+            return true;
+        }
+    }
+    if (i == last) return false;
+    __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<std::int32_t>(last - i)),
+                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    return avx2Blocked(origin, dir, lower, upper, skip, _mm256_maskload_ps(s.cx + i, mask),
+                       _mm256_maskload_ps(s.cy + i, mask), _mm256_maskload_ps(s.cz + i, mask), _mm256_maskload_ps(s.radius + i, mask),
+                       _mm256_maskload_epi32(reinterpret_cast<const int*>(s.id + i), mask), _mm256_castsi256_ps(mask));
+}
+
+// SSE2 has no blend or masked load: select with and/andnot/or, and pad the
+// last block with NaN radii, which never hit.
+struct SseLanes {
+    __m128 absT, t;
+    __m128i id;
+};
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128 sseDistance(const __m128 o[3], const __m128 d[3], __m128 cx, __m128 cy, __m128 cz, __m128 r,
+                          __m128& t) {
+    __m128 tx = _mm_sub_ps(cx, o[0]), ty = _mm_sub_ps(cy, o[1]), tz = _mm_sub_ps(cz, o[2]);
+    __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz));
+    __m128 radiusSq = _mm_mul_ps(r, r);
+    __m128 proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, d[0]), _mm_mul_ps(ty, d[1])), _mm_mul_ps(tz, d[2]));
+    __m128 x = _mm_sub_ps(distSq, _mm_mul_ps(proj, proj));
+    __m128 y = _mm_sqrt_ps(_mm_sub_ps(radiusSq, x));
+    t = _mm_sub_ps(proj, y);
+    return _mm_and_ps(_mm_cmple_ps(x, radiusSq), _mm_cmple_ps(distSq, _mm_mul_ps(y, y)));
+}
+
+inline void sseStep(SseLanes& lanes, const __m128 o[3], const __m128 d[3], __m128 cx, __m128 cy, __m128 cz,
+                    __m128 r, __m128i id) {
+    __m128 t;
+    __m128 hit = sseDistance(o, d, cx, cy, cz, r, t);
+    __m128 absT = _mm_andnot_ps(_mm_set1_ps(-0.0f), t);
+    id = _mm_xor_si128(id, _mm_set1_epi32(kIdBias));
+    __m128 lowerId = _mm_castsi128_ps(_mm_cmpgt_epi32(lanes.id, id));
+    __m128 closer = _mm_or_ps(_mm_cmplt_ps(absT, lanes.absT), _mm_and_ps(_mm_cmpeq_ps(absT, lanes.absT), lowerId));
+    __m128 take = _mm_and_ps(hit, closer);
+    lanes.absT = select(take, absT, lanes.absT);
+    lanes.t = select(take, t, lanes.t);
+    lanes.id = _mm_castps_si128(select(take, _mm_castsi128_ps(id), _mm_castsi128_ps(lanes.id)));
+}
+
+void nearestSse(const SphereArrays& s, std::uint32_t first, std::uint32_t last, const float o[3], const float d[3],
+                std::optional<PrimitiveHit>& best) {
+    const __m128 origin[3] = {_mm_set1_ps(o[0]), _mm_set1_ps(o[1]), _mm_set1_ps(o[2])};
+    const __m128 dir[3] = {_mm_set1_ps(d[0]), _mm_set1_ps(d[1]), _mm_set1_ps(d[2])};
+    SseLanes lanes{_mm_set1_ps(std::numeric_limits<float>::infinity()), _mm_setzero_ps(),
+                   _mm_set1_epi32(static_cast<std::int32_t>(kNoHit ^ kIdBias))};
+
+    std::uint32_t i = first;
+    for (; i + 4 <= last; i += 4) {
+        sseStep(lanes, origin, dir, _mm_loadu_ps(s.cx + i), _mm_loadu_ps(s.cy + i), _mm_loadu_ps(s.cz + i),
+                _mm_loadu_ps(s.radius + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.id + i)));
+    }
+    if (i < last) {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        alignas(16) float cx[4] = {}, cy[4] = {}, cz[4] = {}, r[4] = {nan, nan, nan, nan};
+        alignas(16) std::uint32_t id[4] = {};
+        for (std::uint32_t lane = 0; i + lane < last; lane++) {
+            cx[lane] = s.cx[i + lane];
+            cy[lane] = s.cy[i + lane];
+            cz[lane] = s.cz[i + lane];
+            r[lane] = s.radius[i + lane];
+            id[lane] = s.id[i + lane];
+        }
+        sseStep(lanes, origin, dir, _mm_load_ps(cx), _mm_load_ps(cy), _mm_load_ps(cz), _mm_load_ps(r),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(id)));
+    }
+
+    alignas(16) float t[4];
+    alignas(16) std::uint32_t id[4];
+    _mm_store_ps(t, lanes.t);
+    _mm_store_si128(reinterpret_cast<__m128i*>(id), _mm_xor_si128(lanes.id, _mm_set1_epi32(kIdBias)));
+    for (int lane = 0; lane < 4; lane++) {
+        if (id[lane] != kNoHit) merge(best, id[lane], t[lane]);
+    }
+}
+
+bool anySse(const SphereArrays& s, std::uint32_t first, std::uint32_t last, const float o[3], const float d[3],
+            float tMin, float tMax, std::uint32_t ignore) {
+    const __m128 origin[3] = {_mm_set1_ps(o[0]), _mm_set1_ps(o[1]), _mm_set1_ps(o[2])};
+    const __m128 dir[3] = {_mm_set1_ps(d[0]), _mm_set1_ps(d[1]), _mm_set1_ps(d[2])};
+    const __m128 lower = _mm_set1_ps(tMin);
+    const __m128 upper = _mm_set1_ps(tMax);
+    const __m128i skip = _mm_set1_epi32(static_cast<std::int32_t>(ignore));
+    auto blocked = [&](__m128 cx, __m128 cy, __m128 cz, __m128 r, __m128i id) {
+        __m128 tx = _mm_sub_ps(cx, origin[0]), ty = _mm_sub_ps(cy, origin[1]), tz = _mm_sub_ps(cz, origin[2]);
+        __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz));
+        __m128 radiusSq = _mm_mul_ps(r, r);
+        __m128 proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, dir[0]), _mm_mul_ps(ty, dir[1])), _mm_mul_ps(tz, dir[2]));
+        __m128 x = _mm_sub_ps(distSq, _mm_mul_ps(proj, proj));
+        __m128 y = _mm_sqrt_ps(_mm_sub_ps(radiusSq, x));
+        __m128 tNear = _mm_sub_ps(proj, y), tFar = _mm_add_ps(proj, y);
+        __m128 inRange = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(tNear, lower), _mm_cmplt_ps(tNear, upper)),
+                                   _mm_and_ps(_mm_cmpgt_ps(tFar, lower), _mm_cmplt_ps(tFar, upper)));
+        __m128 other = _mm_castsi128_ps(_mm_cmpeq_epi32(id, skip));
+        return _mm_movemask_ps(_mm_andnot_ps(other, _mm_and_ps(_mm_cmple_ps(x, radiusSq), inRange))) != 0;
+    };
+
+    std::uint32_t i = first;
+    for (; i + 4 <= last; i += 4) {
+        if (blocked(_mm_loadu_ps(s.cx + i), _mm_loadu_ps(s.cy + i), _mm_loadu_ps(s.cz + i), _mm_loadu_ps(s.radius + i),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.id + i)))) {
+            return true;
+        }
+    }
+    // The few spheres left are cheaper one at a time than padded.
+    return anyScalar(s, i, last, o, d, tMin, tMax, ignore);
+}
+
+#endif
+
+}
+
+
+namespace sphere_kernels {
+
+void nearest(const SphereArrays& spheres, std::uint32_t first, std::uint32_t last, const Ray& ray,
+             std::optional<PrimitiveHit>& best, SimdLevel level) {
+    if (first >= last) return;
+    const float o[3] = {ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    const float d[3] = {ray.direction.x(), ray.direction.y(), ray.direction.z()};
+#ifdef SPHERE_KERNELS_HAVE_X86
+    switch (level < detectSimdLevel() ? level : detectSimdLevel()) {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2: return nearestAvx2(spheres, first, last, o, d, best);
+        case SimdLevel::SSE: return nearestSse(spheres, first, last, o, d, best);
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    nearestScalar(spheres, first, last, o, d, best);
+}
+
+bool any(const SphereArrays& spheres, std::uint32_t first, std::uint32_t last, const Ray& ray, float tMin, float tMax,
+         std::uint32_t ignore, SimdLevel level) {
+    if (first >= last) return false;
+    const float o[3] = {ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    const float d[3] = {ray.direction.x(), ray.direction.y(), ray.direction.z()};
+#ifdef SPHERE_KERNELS_HAVE_X86
+    switch (level < detectSimdLevel() ? level : detectSimdLevel()) {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2: return anyAvx2(spheres, first, last, o, d, tMin, tMax, ignore);
+        case SimdLevel::SSE: return anySse(spheres, first, last, o, d, tMin, tMax, ignore);
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    return anyScalar(spheres, first, last, o, d, tMin, tMax, ignore);
+}
+
+}
@@ -0,0 +1,39 @@
+#include "sphere_store.hpp"
+
+
+void SphereStore::reserve(std::size_t count) {
+    _cx.reserve(count);
+    _cy.reserve(count);
+    _cz.reserve(count);
+    _radius.reserve(count);
+    _material.reserve(count);
+    _objectId.reserve(count);
+}
+
+std::uint32_t SphereStore::add(const Vector3D& center, float radius, std::uint32_t material, std::uint32_t objectId) {
+    _cx.push_back(center.x());
+    _cy.push_back(center.y());
+    _cz.push_back(center.z());
+    _radius.push_back(radius);
+    _material.push_back(material);
+    _objectId.push_back(objectId);
+    return static_cast<std::uint32_t>(_radius.size() - 1);
+}
+
+void SphereStore::set(std::uint32_t slot, const Vector3D& center, float radius) {
+    _cx[slot] = center.x();
+    _cy[slot] = center.y();
+    _cz[slot] = center.z();
+    _radius[slot] = radius;
+}
+
+void SphereStore::nearest(const Ray& ray, std::uint32_t first, std::uint32_t last,
+                          std::optional<PrimitiveHit>& best) const {
+    sphere_kernels::nearest(arrays(), first, last, ray, best);
+}
+
+HitInfo SphereStore::hitInfo(std::uint32_t slot, const Ray& ray, float t) const {
+    HitInfo hit = sphereHitInfo(center(slot), _radius[slot], ray.origin, ray.direction, t);
+    hit.objectId = _objectId[slot];
+    return hit;
+}
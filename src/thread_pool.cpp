@@ -0,0 +1,124 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (std::size_t i = 0; i < threads; i++) {
+        _queues.push_back(std::make_unique<WorkQueue>());
+    }
+    // Slot 0 belongs to whichever thread calls parallelFor.
+    for (std::size_t slot = 1; slot < threads; slot++) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this, slot);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn) {
+    if (count == 0) return;
+
+    // Hand every worker a contiguous block up front; stealing evens it out later.
+    std::size_t slots = size();
+    for (std::size_t slot = 0; slot < slots; slot++) {
+        WorkQueue& queue = *_queues[slot];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (std::size_t idx = slot * count / slots; idx < (slot + 1) * count / slots; idx++) {
+            queue.items.push_back(idx);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _remaining = count;
+        _error = nullptr;
+        _job = &fn;
+        _generation++;
+    }
+    _wake.notify_all();
+
+    runJob(0, fn);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _remaining == 0 && _active == 0; });
+    // Workers that wake up late must not pick up a job whose fn is gone.
+    _job = nullptr;
+    if (_error) {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(std::size_t slot) {
+    std::size_t seen = 0;
+    while (true) {
+        const std::function<void(std::size_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stop || _generation != seen; });
+            if (_stop) return;
+            seen = _generation;
+            job = _job;
+            if (job == nullptr) continue;
+            _active++;
+        }
+
+        runJob(slot, *job);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _active--;
+        }
+        _done.notify_all();
+    }
+}
+
+void ThreadPool::runJob(std::size_t slot, const std::function<void(std::size_t)>& fn) {
+    std::size_t idx;
+    while (popLocal(slot, idx) || steal(slot, idx)) {
+        try {
+            fn(idx);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) _error = std::current_exception();
+        }
+        if (--_remaining == 0) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::popLocal(std::size_t slot, std::size_t& idx) {
+    WorkQueue& queue = *_queues[slot];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty()) return false;
+    idx = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t thief, std::size_t& idx) {
+    std::size_t slots = size();
+    for (std::size_t offset = 1; offset < slots; offset++) {
+        WorkQueue& victim = *_queues[(thief + offset) % slots];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.items.empty()) continue;
+        idx = victim.items.back();
+        victim.items.pop_back();
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,258 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstdarg>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace trace {
+namespace {
+
+constexpr std::size_t kRingCapacity = 1024;
+constexpr std::size_t kMaxMessage = 176;
+constexpr std::size_t kCategoryCount = std::bit_width(static_cast<std::uint32_t>(AllCategories));
+
+struct Record {
+    std::int64_t nanos;
+    std::uint32_t thread;
+    Level level;
+    Category category;
+    char text[kMaxMessage];
+};
+
+// Single-producer (the owning thread), single-consumer (the drainer) ring.
+struct Ring {
+    explicit Ring(std::uint32_t id) : thread(id) {}
+
+    bool push(const Record& record) {
+        std::uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == kRingCapacity) return false;
+        slots[h % kRingCapacity] = record;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename F>
+    void drain(F&& consume) {
+        std::uint64_t t = tail.load(std::memory_order_relaxed);
+        std::uint64_t h = head.load(std::memory_order_acquire);
+        for (; t != h; t++) consume(slots[t % kRingCapacity]);
+        tail.store(t, std::memory_order_release);
+    }
+
+    const std::uint32_t thread;
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint64_t> tail{0};
+    std::array<Record, kRingCapacity> slots;
+    // Per-thread filter state, only touched by the owner.
+    std::array<std::uint32_t, kCategoryCount> sampleCount{};
+    std::array<std::int64_t, kCategoryCount> windowStart{};
+    std::array<std::uint32_t, kCategoryCount> windowCount{};
+};
+
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    ~Tracer() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        if (_drainer.joinable()) _drainer.join();
+        drainOnce();
+    }
+
+    void configure(const Config& config) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _config = config;
+            _level.store(static_cast<int>(config.level), std::memory_order_relaxed);
+            _categories.store(config.categories, std::memory_order_relaxed);
+            _sampleEvery.store(std::max<std::uint32_t>(1, config.sampleEvery), std::memory_order_relaxed);
+            _maxPerSecond.store(config.maxPerSecond, std::memory_order_relaxed);
+        }
+        // Let the drainer pick up a new interval.
+        _wake.notify_all();
+    }
+
+    Config config() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _config;
+    }
+
+    bool enabled(Level level, Category category) const {
+        return static_cast<int>(level) <= _level.load(std::memory_order_relaxed) &&
+               (_categories.load(std::memory_order_relaxed) & category) != 0;
+    }
+
+    void emit(Level level, Category category, const char* format, std::va_list args) {
+        Ring& ring = localRing();
+        std::size_t slot = std::countr_zero(static_cast<std::uint32_t>(category)) % kCategoryCount;
+        if (ring.sampleCount[slot]++ % _sampleEvery.load(std::memory_order_relaxed) != 0) return;
+
+        std::int64_t now = nowNanos();
+        if (std::uint32_t limit = _maxPerSecond.load(std::memory_order_relaxed)) {
+            if (now - ring.windowStart[slot] >= 1'000'000'000) {
+                ring.windowStart[slot] = now;
+                ring.windowCount[slot] = 0;
+            }
+            if (ring.windowCount[slot]++ >= limit) return;
+        }
+
+        Record record;
+        record.nanos = now;
+        record.thread = ring.thread;
+        record.level = level;
+        record.category = category;
+        std::vsnprintf(record.text, sizeof(record.text), format, args);
+        if (ring.push(record)) {
+            _recorded.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(_drainMutex);
+        drainLocked();
+    }
+
+    Stats stats() const {
+        return Stats{_recorded.load(), _dropped.load(), _written.load()};
+    }
+
+private:
+    Tracer() : _start(std::chrono::steady_clock::now()) {}
+
+    std::int64_t nowNanos() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+    // The ring outlives its thread until the drainer has emptied it.
+    Ring& localRing() {
+        thread_local std::shared_ptr<Ring> ring = [this] {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto created = std::make_shared<Ring>(static_cast<std::uint32_t>(_nextThread++));
+            _rings.push_back(created);
+            if (!_drainer.joinable() && !_stop) _drainer = std::thread(&Tracer::drainLoop, this);
+            return created;
+        }();
+        return *ring;
+    }
+
+    void drainLoop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_stop) {
+            _wake.wait_for(lock, _config.drainInterval);
+            lock.unlock();
+            drainOnce();
+            lock.lock();
+        }
+    }
+
+    void drainOnce() {
+        std::lock_guard<std::mutex> lock(_drainMutex);
+        drainLocked();
+    }
+
+    void drainLocked() {
+        std::vector<std::shared_ptr<Ring>> rings;
+        std::FILE* sink;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            // Rings of finished threads are dropped once they are empty.
+            std::erase_if(_rings, [](const std::shared_ptr<Ring>& ring) {
+                return ring.use_count() == 1 &&
+                       ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+            });
+            rings = _rings;
+            sink = _config.sink;
+        }
+
+        _batch.clear();
+        for (const auto& ring : rings) {
+            ring->drain([&](const Record& record) { _batch.push_back(record); });
+        }
+        if (_batch.empty() || sink == nullptr) return;
+
+        std::stable_sort(_batch.begin(), _batch.end(),
+                         [](const Record& a, const Record& b) { return a.nanos < b.nanos; });
+        for (const Record& record : _batch) {
+            std::fprintf(sink, "[%12.6f] T%-2u %-7s %-9s %s\n", record.nanos / 1e9, record.thread,
+                         levelName(record.level), categoryName(record.category), record.text);
+        }
+        std::fflush(sink);
+        _written.fetch_add(_batch.size(), std::memory_order_relaxed);
+    }
+
+    const std::chrono::steady_clock::time_point _start;
+    std::mutex _mutex;  // config, ring registry, drainer lifetime
+    std::condition_variable _wake;
+    std::mutex _drainMutex;  // one consumer at a time
+    Config _config;
+    std::vector<std::shared_ptr<Ring>> _rings;
+    std::vector<Record> _batch;
+    std::thread _drainer;
+    bool _stop = false;
+    std::size_t _nextThread = 0;
+
+    std::atomic<int> _level{static_cast<int>(Level::Info)};
+    std::atomic<std::uint32_t> _categories{AllCategories};
+    std::atomic<std::uint32_t> _sampleEvery{1};
+    std::atomic<std::uint32_t> _maxPerSecond{0};
+    std::atomic<std::uint64_t> _recorded{0};
+    std::atomic<std::uint64_t> _dropped{0};
+    std::atomic<std::uint64_t> _written{0};
+};
+
+}
+
+void configure(const Config& config) { Tracer::instance().configure(config); }
+Config config() { return Tracer::instance().config(); }
+bool enabled(Level level, Category category) { return Tracer::instance().enabled(level, category); }
+
+void emit(Level level, Category category, const char* format, ...) {
+    std::va_list args;
+    va_start(args, format);
+    Tracer::instance().emit(level, category, format, args);
+    va_end(args);
+}
+
+void flush() { Tracer::instance().flush(); }
+Stats stats() { return Tracer::instance().stats(); }
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::Off: return "OFF";
+        case Level::Error: return "ERROR";
+        case Level::Warn: return "WARN";
+        case Level::Info: return "INFO";
+        case Level::Debug: return "DEBUG";
+        case Level::Verbose: return "VERBOSE";
+    }
+    return "?";
+}
+
+const char* categoryName(Category category) {
+    switch (category) {
+        case Camera: return "camera";
+        case Intersect: return "intersect";
+        case Shade: return "shade";
+        case Render: return "render";
+        case AllCategories: return "all";
+    }
+    return "?";
+}
+
+}
@@ -0,0 +1,247 @@
+#include "vector_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VECTOR_KERNELS_HAVE_X86 1
+#endif
+
+
+namespace {
+
+// The kernels are written once over GCC vector extensions and inlined into
+// one entry point per instruction set; the target attribute on the entry
+// point decides whether a 16/32/64-byte vector becomes SSE, AVX2 or AVX-512.
+template <typename T, std::size_t Bytes>
+struct Lanes {
+    // Unaligned, may-alias view of Bytes worth of T.
+    typedef T type __attribute__((vector_size(Bytes), aligned(alignof(T)), may_alias));
+    static constexpr std::size_t count = Bytes / sizeof(T);
+};
+
+template <typename T>
+inline T applyOp(VectorOp op, T a, T b) {
+    switch (op) {
+        case VectorOp::Add: return a + b;
+        case VectorOp::Sub: return a - b;
+        case VectorOp::Mul: return a * b;
+        case VectorOp::Div: return a / b;
+    }
+    return a;
+}
+
+template <typename T, std::size_t Bytes>
+[[gnu::always_inline]] inline void binaryKernel(VectorOp op, const T* a, const T* b, T* out, std::size_t n) {
+    using V = typename Lanes<T, Bytes>::type;
+    constexpr std::size_t W = Lanes<T, Bytes>::count;
+    std::size_t i = 0;
+    // One loop per operator so the switch stays out of the hot loop.
+    switch (op) {
+        case VectorOp::Add:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) + *(const V*)(b + i);
+            break;
+        case VectorOp::Sub:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) - *(const V*)(b + i);
+            break;
+        case VectorOp::Mul:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) * *(const V*)(b + i);
+            break;
+        case VectorOp::Div:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) / *(const V*)(b + i);
+            break;
+    }
+    for (; i < n; i++) out[i] = applyOp(op, a[i], b[i]);
+}
+
+template <typename T, std::size_t Bytes>
+[[gnu::always_inline]] inline void binaryScalarKernel(VectorOp op, const T* a, T s, T* out, std::size_t n) {
+    using V = typename Lanes<T, Bytes>::type;
+    constexpr std::size_t W = Lanes<T, Bytes>::count;
+    const V vs = V{} + s;
+    std::size_t i = 0;
+    switch (op) {
+        case VectorOp::Add:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) + vs;
+            break;
+        case VectorOp::Sub:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) - vs;
+            break;
+        case VectorOp::Mul:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) * vs;
+            break;
+        case VectorOp::Div:
+            for (; i + W <= n; i += W) *(V*)(out + i) = *(const V*)(a + i) / vs;
+            break;
+    }
+    for (; i < n; i++) out[i] = applyOp(op, a[i], s);
+}
+
+// Reduces f(a[i], b[i]) with two independent vector accumulators to hide
+// the add latency.
+enum class Reduction { Sum, Dot, DistanceSquared };
+
+template <typename T, std::size_t Bytes, Reduction R>
+[[gnu::always_inline]] inline T reduceKernel(const T* a, const T* b, std::size_t n) {
+    using V = typename Lanes<T, Bytes>::type;
+    constexpr std::size_t W = Lanes<T, Bytes>::count;
+    V acc0 = {}, acc1 = {};
+    std::size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        V x0 = *(const V*)(a + i), x1 = *(const V*)(a + i + W);
+        if constexpr (R == Reduction::Dot) {
+            x0 *= *(const V*)(b + i);
+            x1 *= *(const V*)(b + i + W);
+        } else if constexpr (R == Reduction::DistanceSquared) {
+            x0 -= *(const V*)(b + i);
+            x1 -= *(const V*)(b + i + W);
+            x0 *= x0;
+            x1 *= x1;
+        }
+        acc0 += x0;
+        acc1 += x1;
+    }
+    if (i + W <= n) {
+        V x = *(const V*)(a + i);
+        if constexpr (R == Reduction::Dot) {
+            x *= *(const V*)(b + i);
+        } else if constexpr (R == Reduction::DistanceSquared) {
+            x -= *(const V*)(b + i);
+            x *= x;
+        }
+        acc0 += x;
+        i += W;
+    }
+    acc0 += acc1;
+    T total = 0;
+    for (std::size_t lane = 0; lane < W; lane++) total += acc0[lane];
+    for (; i < n; i++) {
+        if constexpr (R == Reduction::Sum) total += a[i];
+        else if constexpr (R == Reduction::Dot) total += a[i] * b[i];
+        else total += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return total;
+}
+
+template <typename T, Reduction R>
+T reduceScalar(const T* a, const T* b, std::size_t n) {
+    T total = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        if constexpr (R == Reduction::Sum) total += a[i];
+        else if constexpr (R == Reduction::Dot) total += a[i] * b[i];
+        else total += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return total;
+}
+
+// One set of entry points per instruction set and element type.
+#define VECTOR_KERNELS_DEFINE(NAME, TARGET, BYTES, T) \
+    TARGET void NAME##Binary(VectorOp op, const T* a, const T* b, T* out, std::size_t n) { \
+        binaryKernel<T, BYTES>(op, a, b, out, n); \
+    } \
+    TARGET void NAME##BinaryScalar(VectorOp op, const T* a, T s, T* out, std::size_t n) { \
+        binaryScalarKernel<T, BYTES>(op, a, s, out, n); \
+    } \
+    TARGET T NAME##Sum(const T* a, std::size_t n) { return reduceKernel<T, BYTES, Reduction::Sum>(a, a, n); } \
+    TARGET T NAME##Dot(const T* a, const T* b, std::size_t n) { \
+        return reduceKernel<T, BYTES, Reduction::Dot>(a, b, n); \
+    } \
+    TARGET T NAME##DistanceSquared(const T* a, const T* b, std::size_t n) { \
+        return reduceKernel<T, BYTES, Reduction::DistanceSquared>(a, b, n); \
+    }
+
+#ifdef VECTOR_KERNELS_HAVE_X86
+// SSE2 is part of the x86-64 baseline, so the 16-byte kernels need no attribute.
+VECTOR_KERNELS_DEFINE(sse, , 16, float)
+VECTOR_KERNELS_DEFINE(sse, , 16, double)
+VECTOR_KERNELS_DEFINE(avx2, __attribute__((target("avx2"))), 32, float)
+VECTOR_KERNELS_DEFINE(avx2, __attribute__((target("avx2"))), 32, double)
+VECTOR_KERNELS_DEFINE(avx512, __attribute__((target("avx512f"))), 64, float)
+VECTOR_KERNELS_DEFINE(avx512, __attribute__((target("avx512f"))), 64, double)
+#endif
+
+#undef VECTOR_KERNELS_DEFINE
+
+// Never run a wider kernel than the CPU has.
+SimdLevel usable(SimdLevel requested) { return requested < detectSimdLevel() ? requested : detectSimdLevel(); }
+
+}
+
+#ifdef VECTOR_KERNELS_HAVE_X86
+#define VECTOR_KERNELS_DISPATCH(LEVEL, FN, SCALAR, ...) \
+    switch (usable(LEVEL)) { \
+        case SimdLevel::AVX512: return avx512##FN(__VA_ARGS__); \
+        case SimdLevel::AVX2: return avx2##FN(__VA_ARGS__); \
+        case SimdLevel::SSE: return sse##FN(__VA_ARGS__); \
+        case SimdLevel::Scalar: break; \
+    } \
+    return SCALAR;
+#else
+#define VECTOR_KERNELS_DISPATCH(LEVEL, FN, SCALAR, ...) return SCALAR;
+#endif
+
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = [] {
+#ifdef VECTOR_KERNELS_HAVE_X86
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE;
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE: return "sse";
+        case SimdLevel::Scalar: return "scalar";
+    }
+    return "unknown";
+}
+
+namespace vector_kernels {
+
+template <typename T>
+static void binaryLoop(VectorOp op, const T* a, const T* b, T* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) out[i] = applyOp(op, a[i], b[i]);
+}
+
+template <typename T>
+static void binaryScalarLoop(VectorOp op, const T* a, T s, T* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) out[i] = applyOp(op, a[i], s);
+}
+
+void binary(VectorOp op, const float* a, const float* b, float* out, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, Binary, binaryLoop(op, a, b, out, n), op, a, b, out, n)
+}
+void binary(VectorOp op, const double* a, const double* b, double* out, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, Binary, binaryLoop(op, a, b, out, n), op, a, b, out, n)
+}
+void binaryScalar(VectorOp op, const float* a, float s, float* out, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, BinaryScalar, binaryScalarLoop(op, a, s, out, n), op, a, s, out, n)
+}
+void binaryScalar(VectorOp op, const double* a, double s, double* out, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, BinaryScalar, binaryScalarLoop(op, a, s, out, n), op, a, s, out, n)
+}
+
+float sum(const float* a, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, Sum, (reduceScalar<float, Reduction::Sum>(a, a, n)), a, n)
+}
+double sum(const double* a, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, Sum, (reduceScalar<double, Reduction::Sum>(a, a, n)), a, n)
+}
+float dot(const float* a, const float* b, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, Dot, (reduceScalar<float, Reduction::Dot>(a, b, n)), a, b, n)
+}
+double dot(const double* a, const double* b, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, Dot, (reduceScalar<double, Reduction::Dot>(a, b, n)), a, b, n)
+}
+float distanceSquared(const float* a, const float* b, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, DistanceSquared, (reduceScalar<float, Reduction::DistanceSquared>(a, b, n)), a, b, n)
+}
+double distanceSquared(const double* a, const double* b, std::size_t n, SimdLevel level) {
+    VECTOR_KERNELS_DISPATCH(level, DistanceSquared, (reduceScalar<double, Reduction::DistanceSquared>(a, b, n)), a, b, n)
+}
+
+}
@@ -0,0 +1,198 @@
+#include "wide_bvh.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WIDE_BVH_HAVE_X86 1
+#endif
+
+
+template <int Width>
+WideBVH<Width>::WideBVH(const BVH& bvh) {
+    if (bvh.empty()) return;
+    _nodes.reserve(bvh.nodes().size() / (Width - 1) + 1);
+    _slotOf.assign(bvh.nodes().size(), kNoSlot);
+    collapse(bvh.nodes(), 0);
+}
+
+template <int Width>
+void WideBVH<Width>::refit(const BVH& bvh, const std::vector<std::uint32_t>& binaryNodes) {
+    for (std::uint32_t idx : binaryNodes) {
+        std::uint32_t slot = _slotOf[idx];
+        if (slot != kNoSlot) _nodes[slot / Width].setBounds(slot % Width, bvh.nodes()[idx].bounds);
+    }
+}
+
+template <int Width>
+std::uint32_t WideBVH<Width>::collapse(const std::vector<BVH::Node>& binary, std::uint32_t binaryIdx) {
+    // Open the interior child with the largest surface area until the node
+    // is full; a leaf root becomes a node with a single child.
+    std::uint32_t children[Width];
+    int count = 0;
+    if (binary[binaryIdx].isLeaf()) {
+        children[count++] = binaryIdx;
+    } else {
+        children[count++] = binary[binaryIdx].leftFirst;
+        children[count++] = binary[binaryIdx].leftFirst + 1;
+    }
+    while (count < Width) {
+        int widest = -1;
+        for (int i = 0; i < count; i++) {
+            const BVH::Node& node = binary[children[i]];
+            if (node.isLeaf()) continue;
+            if (widest < 0 || node.bounds.surfaceArea() > binary[children[widest]].bounds.surfaceArea()) widest = i;
+        }
+        if (widest < 0) break;
+        std::uint32_t opened = binary[children[widest]].leftFirst;
+        children[widest] = opened;
+        children[count++] = opened + 1;
+    }
+
+    const std::uint32_t idx = static_cast<std::uint32_t>(_nodes.size());
+    _nodes.emplace_back();
+    for (int slot = 0; slot < Width; slot++) {
+        // Unused slots get an empty box and are masked off by their count.
+        AABB bounds;
+        std::uint32_t child = 0, leafCount = Node::kEmptySlot;
+        if (slot < count) {
+            const BVH::Node& node = binary[children[slot]];
+            bounds = node.bounds;
+            _slotOf[children[slot]] = idx * Width + slot;
+            if (node.isLeaf()) {
+                child = node.leftFirst;
+                leafCount = node.count;
+            } else {
+                // _nodes may reallocate, so only index it afterwards.
+                child = collapse(binary, children[slot]);
+                leafCount = 0;
+            }
+        }
+        Node& node = _nodes[idx];
+        node.setBounds(slot, bounds);
+        node.child[slot] = child;
+        node.count[slot] = leafCount;
+    }
+    return idx;
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+
+namespace {
+
+// AABB::distanceSquared and AABB::intersects per slot.
+template <int Width>
+std::uint32_t enterMaskScalar(const WideNode<Width>& node, const float origin[3], const float invDir[3], float tMin,
+                              float tMax, float bestDistSq, float distSq[Width]) {
+    std::uint32_t mask = 0;
+    for (int slot = 0; slot < Width; slot++) {
+        if (node.count[slot] == WideNode<Width>::kEmptySlot) continue;
+        AABB box = node.bounds(slot);
+        distSq[slot] = box.distanceSquared(origin);
+        if (distSq[slot] > bestDistSq) continue;
+        if (!box.intersects(origin, invDir, tMin, tMax)) continue;
+        mask |= 1u << slot;
+    }
+    return mask;
+}
+
+#ifdef WIDE_BVH_HAVE_X86
+// The same blended slab test as ray_packet::boxMask, across the children of
+// one node instead of across rays.
+__attribute__((target("avx2")))
+std::uint32_t enterMaskAvx2(const WideNode<8>& node, const float origin[3], const float invDir[3], float lower,
+                            float upper, float bestDistSq, float distSq[8]) {
+    const float* mins[3] = {node.minX, node.minY, node.minZ};
+    const float* maxs[3] = {node.maxX, node.maxY, node.maxZ};
+    __m256 tMin = _mm256_set1_ps(lower);
+    __m256 tMax = _mm256_set1_ps(upper);
+    __m256 dist = _mm256_setzero_ps();
+    for (int axis = 0; axis < 3; axis++) {
+        __m256 o = _mm256_set1_ps(origin[axis]);
+        __m256 inv = _mm256_set1_ps(invDir[axis]);
+        __m256 toMin = _mm256_sub_ps(_mm256_load_ps(mins[axis]), o);
+        __m256 toMax = _mm256_sub_ps(_mm256_load_ps(maxs[axis]), o);
+        __m256 fromMax = _mm256_sub_ps(o, _mm256_load_ps(maxs[axis]));
+
+        __m256 t0 = _mm256_mul_ps(toMin, inv);
+        __m256 t1 = _mm256_mul_ps(toMax, inv);
+        __m256 swap = _mm256_cmp_ps(t0, t1, _CMP_GT_OQ);
+        __m256 lo = _mm256_blendv_ps(t0, t1, swap);
+        __m256 hi = _mm256_blendv_ps(t1, t0, swap);
+        tMin = _mm256_blendv_ps(tMin, lo, _mm256_cmp_ps(lo, tMin, _CMP_GT_OQ));
+        tMax = _mm256_blendv_ps(tMax, hi, _mm256_cmp_ps(hi, tMax, _CMP_LT_OQ));
+
+        __m256 d = _mm256_max_ps(_mm256_max_ps(toMin, _mm256_setzero_ps()), fromMax);
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(d, d));
+    }
+    _mm256_storeu_ps(distSq, dist);
+    __m256i used = _mm256_xor_si256(
+        _mm256_cmpeq_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(node.count)), _mm256_set1_epi32(-1)),
+        _mm256_set1_epi32(-1));
+    __m256 enter = _mm256_and_ps(_mm256_cmp_ps(tMin, tMax, _CMP_LE_OQ),
+                                 _mm256_cmp_ps(dist, _mm256_set1_ps(bestDistSq), _CMP_LE_OQ));
+    return _mm256_movemask_ps(_mm256_and_ps(enter, _mm256_castsi256_ps(used)));
+}
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+std::uint32_t enterMaskSse(const WideNode<4>& node, const float origin[3], const float invDir[3], float lower,
+                           float upper, float bestDistSq, float distSq[4]) {
+    const float* mins[3] = {node.minX, node.minY, node.minZ};
+    const float* maxs[3] = {node.maxX, node.maxY, node.maxZ};
+    __m128 tMin = _mm_set1_ps(lower);
+    __m128 tMax = _mm_set1_ps(upper);
+    __m128 dist = _mm_setzero_ps();
+    for (int axis = 0; axis < 3; axis++) {
+        __m128 o = _mm_set1_ps(origin[axis]);
+        __m128 inv = _mm_set1_ps(invDir[axis]);
+        __m128 toMin = _mm_sub_ps(_mm_load_ps(mins[axis]), o);
+        __m128 toMax = _mm_sub_ps(_mm_load_ps(maxs[axis]), o);
+        __m128 fromMax = _mm_sub_ps(o, _mm_load_ps(maxs[axis]));
+
+        __m128 t0 = _mm_mul_ps(toMin, inv);
+        __m128 t1 = _mm_mul_ps(toMax, inv);
+        __m128 swap = _mm_cmpgt_ps(t0, t1);
+        __m128 lo = select(swap, t1, t0);
+        __m128 hi = select(swap, t0, t1);
+        tMin = select(_mm_cmpgt_ps(lo, tMin), lo, tMin);
+        tMax = select(_mm_cmplt_ps(hi, tMax), hi, tMax);
+
+        __m128 d = _mm_max_ps(_mm_max_ps(toMin, _mm_setzero_ps()), fromMax);
+        dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+    }
+    _mm_storeu_ps(distSq, dist);
+    __m128i unused = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(node.count)), _mm_set1_epi32(-1));
+    __m128 enter = _mm_and_ps(_mm_cmple_ps(tMin, tMax), _mm_cmple_ps(dist, _mm_set1_ps(bestDistSq)));
+    return _mm_movemask_ps(_mm_andnot_ps(_mm_castsi128_ps(unused), enter));
+}
+#endif
+
+}
+
+
+namespace wide_bvh_detail {
+
+std::uint32_t enterMask(const WideNode<4>& node, const float origin[3], const float invDir[3], float tMin, float tMax,
+                        float bestDistSq, float distSq[4]) {
+#ifdef WIDE_BVH_HAVE_X86
+    return enterMaskSse(node, origin, invDir, tMin, tMax, bestDistSq, distSq);
+#else
+    return enterMaskScalar(node, origin, invDir, tMin, tMax, bestDistSq, distSq);
+#endif
+}
+
+std::uint32_t enterMask(const WideNode<8>& node, const float origin[3], const float invDir[3], float tMin, float tMax,
+                        float bestDistSq, float distSq[8]) {
+#ifdef WIDE_BVH_HAVE_X86
+    if (detectSimdLevel() >= SimdLevel::AVX2) {
+        return enterMaskAvx2(node, origin, invDir, tMin, tMax, bestDistSq, distSq);
+    }
+#endif
+    return enterMaskScalar(node, origin, invDir, tMin, tMax, bestDistSq, distSq);
+}
+
+}
@@ -0,0 +1,160 @@
+#include "catch_amalgamated.hpp"
+#include "vector.hpp"
+#include "matrix.hpp"
+#include "arena.hpp"
+#include "scene_object.hpp"
+#include "scene_file.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+
+// Counts global operator new calls made by the current thread, so a test can
+// assert that a code path never touches the heap.
+namespace {
+thread_local std::size_t allocations = 0;
+
+std::size_t allocationsDuring(const auto& fn) {
+    std::size_t before = allocations;
+    fn();
+    return allocations - before;
+}
+}
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+// std::stable_sort's scratch buffer uses the nothrow form.
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocations++;
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+// Over-aligned variants, used by MatrixND and std::pmr::new_delete_resource.
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations++;
+    std::size_t alignment = static_cast<std::size_t>(align);
+    std::size_t rounded = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+    if (void* ptr = std::aligned_alloc(alignment, rounded)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t align) { return operator new(size, align); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+
+TEST_CASE("Vector3D never allocates", "[alloc]") {
+    REQUIRE(allocationsDuring([] { auto* v = new Vector3D(); delete v; }) == 1);
+
+    // The vector math of a ray-sphere test, as SphereSceneObject::intersect does it.
+    Vector3D center(0.1f, 1, 0);
+    Vector3D origin(0, 0.5f, 0.2f);
+    Vector3D direction = Vector3D(0, 0.2f, 0.1f).normalize();
+    float radius = 2;
+    float t = 0;
+    Vector3D bounce;
+
+    std::size_t count = allocationsDuring([&] {
+        Vector3D toCenter = center - origin;
+        float distSq = toCenter.lengthSquared();
+        float proj = toCenter.dot(direction);
+        float y = std::sqrt(radius * radius - (distSq - proj * proj));
+        Vector3D hitPoint = origin + direction * (proj - y);
+        Vector3D normal = (hitPoint - center).normalize();
+        bounce = direction.cross(normal).normalize();
+        Vector3D copy = hitPoint;
+        copy = bounce;
+        t = proj - y + copy.x();
+    });
+    REQUIRE(count == 0);
+    REQUIRE(t != 0);
+    REQUIRE(bounce.magnitude() == Catch::Approx(1));
+
+    // With tracing compiled out the real intersection is heap-free too.
+    SphereSceneObject sphere(0.1f, 1, 0, 1, 1, 1, 1, radius);
+    std::optional<HitInfo> hit;
+    REQUIRE(allocationsDuring([&] { hit = sphere.intersect(origin, direction); }) == 0);
+    REQUIRE(hit.has_value());
+}
+
+TEST_CASE("Vector expressions allocate once, on assignment", "[alloc]") {
+    VectorData<float> a(std::vector<float>{1, 2, 3, 4});
+    VectorData<float> b(std::vector<float>{5, 6, 7, 8});
+    VectorND<float> origin(a);
+    VectorND<float> direction(b);
+    float proj = 3, y = 1;
+
+    // Building the expression tree touches no heap at all.
+    REQUIRE(allocationsDuring([&] {
+        auto expr = asVectorExpr(origin) + asVectorExpr(direction) * (proj - y);
+        (void)expr;
+    }) == 0);
+    REQUIRE(allocationsDuring([&] { REQUIRE(origin.dot(direction) == 70); }) == 0);
+
+    // Materialising it costs the VectorData box plus its buffer, however
+    // many operators the expression has.
+    VectorData<float> fused(0);
+    REQUIRE(allocationsDuring([&] {
+        fused = VectorData<float>((asVectorExpr(origin) + asVectorExpr(direction) * (proj - y)) / 2.0f - a);
+    }) == 1);
+    REQUIRE(allocationsDuring([&] {
+        VectorND<float> v = asVectorExpr(origin) + asVectorExpr(direction) * (proj - y) - asVectorExpr(origin) * 2.0f;
+    }) == 2);
+    // The plain operators evaluate, reusing the temporaries' buffers.
+    REQUIRE(allocationsDuring([&] { VectorND<float> v = origin + direction * (proj - y) / 2.0f - 1.0f; }) == 2);
+    REQUIRE(fused.get(3) == (4 + 8 * 2) / 2.0f - 4);
+}
+
+TEST_CASE("Expression chains inside an arena stay off the heap", "[alloc][arena]") {
+    ArenaResource arena;
+    VectorData<float> a(std::vector<float>(64, 1.5f));
+    VectorData<float> b(std::vector<float>(64, -2.0f));
+    MatrixND<double> m(8, 8);
+    for (std::size_t i = 0; i < 8; i++) m.set(i, i, 2);
+
+    REQUIRE(arena.allocate(1, 1) != nullptr); // warm up the first block
+    arena.reset();
+    std::size_t count = allocationsDuring([&] {
+        for (int tile = 0; tile < 4; tile++) {
+            ScopedMathResource scope(&arena);
+            VectorData<float> t = (a + b) * 3.0f - a / 2.0f;
+            VectorData<float> copy = t;
+            copy.resize(32);
+            MatrixND<double> p = m * m + m;
+            REQUIRE(p.get(3, 3) == 6);
+            arena.reset();
+        }
+    });
+    REQUIRE(count == 0);
+}
+
+TEST_CASE("Scene parsing allocates only the objects it creates", "[alloc][scenefile]") {
+    std::string text = "# header\nrender 320 240 16 0\n";
+    for (int i = 0; i < 100; i++) text += "sphere 1.5 -2 3e1 0.1 0.2 0.3 1 0.5   # comment\n";
+
+    Scene byHand;
+    std::size_t direct = allocationsDuring([&] {
+        for (int i = 0; i < 100; i++) {
+            byHand.addObject(std::make_unique<SphereSceneObject>(1.5f, -2, 30, 0.1f, 0.2f, 0.3f, 1, 0.5f));
+        }
+    });
+
+    Scene parsed;
+    RenderSettings settings;
+    SceneParser parser(parsed, settings);
+    std::size_t viaParser = allocationsDuring([&] {
+        parser.feed(text.data(), text.size());
+        parser.finish();
+    });
+    REQUIRE(parsed.objects().size() == 100);
+    REQUIRE(viaParser == direct);
+}
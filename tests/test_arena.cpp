@@ -0,0 +1,83 @@
+#include "catch_amalgamated.hpp"
+#include "arena.hpp"
+#include "matrix.hpp"
+#include <cstdint>
+
+
+TEST_CASE("ArenaResource bump allocation", "[arena]") {
+    ArenaResource arena(256);
+
+    SECTION("Honours alignment and grows by blocks") {
+        void* a = arena.allocate(3, 1);
+        void* b = arena.allocate(8, 64);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(b) % 64 == 0);
+        REQUIRE(b > a);
+        REQUIRE(arena.blockCount() == 1);
+
+        void* big = arena.allocate(1000, 16);
+        REQUIRE(big != nullptr);
+        REQUIRE(arena.blockCount() == 2);
+        REQUIRE(arena.capacity() >= 256 + 1000);
+        REQUIRE(arena.bytesUsed() >= 3 + 8 + 1000);
+    }
+
+    SECTION("reset() reuses the same blocks") {
+        void* first = arena.allocate(100, 8);
+        void* second = arena.allocate(200, 8);
+        void* third = arena.allocate(200, 8);
+        REQUIRE(second != first);
+        REQUIRE(third != second);
+        std::size_t blocks = arena.blockCount();
+        REQUIRE(blocks >= 2);
+
+        arena.reset();
+        REQUIRE(arena.bytesUsed() == 0);
+        REQUIRE(arena.allocate(100, 8) == first);
+        REQUIRE(arena.allocate(200, 8) == second);
+        REQUIRE(arena.allocate(200, 8) == third);
+        REQUIRE(arena.blockCount() == blocks);
+
+        arena.release();
+        REQUIRE(arena.blockCount() == 0);
+        REQUIRE(arena.capacity() == 0);
+    }
+}
+
+TEST_CASE("Math types allocate from the installed resource", "[arena]") {
+    ArenaResource arena;
+    VectorData<float> a(std::vector<float>{1, 2, 3});
+    VectorData<float> b(std::vector<float>{4, 5, 6});
+    REQUIRE(a.resource() == std::pmr::new_delete_resource());
+
+    {
+        ScopedMathResource scope(&arena);
+        REQUIRE(currentMathResource() == &arena);
+
+        VectorData<float> sum = a + b * 2.0f;
+        REQUIRE(sum.resource() == &arena);
+        REQUIRE(sum.get(2) == 15);
+        VectorND<float> lazy = VectorND<float>(a) - b;
+        REQUIRE(lazy.vectorData().resource() == &arena);
+
+        MatrixND<float> m(4, 4);
+        REQUIRE(m.resource() == &arena);
+        REQUIRE((m * m).resource() == &arena);
+        REQUIRE(arena.bytesUsed() > 0);
+
+        // An explicit resource wins over the scope.
+        VectorData<float> heap(3, std::pmr::new_delete_resource());
+        REQUIRE(heap.resource() == std::pmr::new_delete_resource());
+    }
+    REQUIRE(currentMathResource() == std::pmr::new_delete_resource());
+
+    // Scopes nest and are per thread.
+    ArenaResource inner;
+    {
+        ScopedMathResource outerScope(&arena);
+        {
+            ScopedMathResource innerScope(&inner);
+            REQUIRE(VectorData<int>(4).resource() == &inner);
+        }
+        REQUIRE(VectorData<int>(4).resource() == &arena);
+    }
+}
@@ -0,0 +1,284 @@
+#include "catch_amalgamated.hpp"
+#include "scene.hpp"
+#include <limits>
+#include <random>
+#include <type_traits>
+
+
+TEST_CASE("AABB", "[bvh]") {
+    AABB box;
+    REQUIRE(box.empty());
+    box.grow(AABB(0, 0, 0, 1, 2, 3));
+    box.grow(-1, 0, 0);
+    REQUIRE_FALSE(box.empty());
+    REQUIRE(box.min[0] == -1);
+    REQUIRE(box.largestAxis() == 2);
+    REQUIRE(box.surfaceArea() == Catch::Approx(2 * (2 * 2 + 2 * 3 + 3 * 2)));
+
+    const float inside[3] = {0, 1, 1};
+    const float outside[3] = {3, 1, 1};
+    REQUIRE(box.distanceSquared(inside) == 0);
+    REQUIRE(box.distanceSquared(outside) == 4);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    const float alongX[3] = {1, inf, inf};
+    REQUIRE(box.intersects(outside, alongX, -inf, inf));
+    REQUIRE_FALSE(box.intersects(outside, alongX, 0, inf));
+    const float origin[3] = {3, 5, 1};
+    REQUIRE_FALSE(box.intersects(origin, alongX, -inf, inf));
+}
+
+TEST_CASE("BVH matches brute force closest hit", "[bvh]") {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coord(-10, 10);
+    std::uniform_real_distribution<float> radius(0.5, 3);
+
+    Scene scene;
+    for (int i = 0; i < 300; i++) {
+        scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+    }
+    REQUIRE(scene.bvh().empty());
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 500; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+    std::vector<std::optional<HitInfo>> expected;
+    for (const Ray& ray : rays) {
+        expected.push_back(scene.intersect(ray));
+    }
+
+    scene.buildBVH();
+    const BVH& bvh = scene.bvh();
+    REQUIRE_FALSE(bvh.empty());
+
+    SECTION("Every object lands in exactly one small leaf") {
+        std::vector<int> seen(scene.objects().size(), 0);
+        for (const BVH::Node& node : bvh.nodes()) {
+            if (!node.isLeaf()) continue;
+            REQUIRE(node.count <= BVH::kMaxLeafSize);
+            for (std::uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                seen[bvh.indices()[i]]++;
+            }
+        }
+        for (int count : seen) {
+            REQUIRE(count == 1);
+        }
+    }
+
+    SECTION("Same hits as the linear scan") {
+        int hits = 0;
+        for (std::size_t i = 0; i < rays.size(); i++) {
+            std::optional<HitInfo> hit = scene.intersect(rays[i]);
+            REQUIRE(hit.has_value() == expected[i].has_value());
+            if (!hit.has_value()) continue;
+            hits++;
+            REQUIRE(hit->objectId == expected[i]->objectId);
+            REQUIRE(hit->t == expected[i]->t);
+            REQUIRE(hit->point.x() == expected[i]->point.x());
+            REQUIRE(hit->point.y() == expected[i]->point.y());
+            REQUIRE(hit->point.z() == expected[i]->point.z());
+        }
+        REQUIRE(hits > 0);
+    }
+}
+
+TEST_CASE("HitInfo records and closest-hit order", "[bvh][hit]") {
+    static_assert(std::is_trivially_copyable_v<HitInfo>);
+
+    SECTION("Sphere hits fill every field") {
+        SphereSceneObject sphere(0, 0, 0, 1, 1, 1, 1, 2);
+        Vector3D origin(0.5f, 0, 0);
+        Vector3D direction(1, 0, 0);
+        std::optional<HitInfo> hit = sphere.intersect(origin, direction);
+        REQUIRE(hit.has_value());
+        REQUIRE(hit->objectId == HitInfo::kNoObject);
+        REQUIRE(hit->t == Catch::Approx(-2.5));
+        REQUIRE(hit->point.x() == Catch::Approx(origin.x() + direction.x() * hit->t));
+        REQUIRE(hit->normal.x() == Catch::Approx(-1));
+        REQUIRE(hit->normal.magnitude() == Catch::Approx(1));
+    }
+
+    SECTION("closerThan compares |t|, then object id") {
+        HitInfo a, b;
+        a.t = -1;
+        b.t = 2;
+        REQUIRE(a.closerThan(b));
+        REQUIRE_FALSE(b.closerThan(a));
+        b.t = 1;
+        a.objectId = 3;
+        b.objectId = 5;
+        REQUIRE(a.closerThan(b));
+        REQUIRE_FALSE(b.closerThan(a));
+        REQUIRE(a.closerThan(HitInfo{}));
+    }
+
+    SECTION("The nearest object wins regardless of insertion order") {
+        Scene scene;
+        scene.addObject(std::make_unique<SphereSceneObject>(0, 0, 0, 1, 1, 1, 1, 5));
+        scene.addObject(std::make_unique<SphereSceneObject>(0.2f, 0, 0, 1, 1, 1, 1, 1));
+        Ray ray{Vector3D(0.5f, 0, 0), Vector3D(1, 0, 0)};
+        std::optional<HitInfo> linear = scene.intersect(ray);
+        REQUIRE(linear.has_value());
+        REQUIRE(linear->objectId == 1);
+        scene.buildBVH();
+        std::optional<HitInfo> viaBvh = scene.intersect(ray);
+        REQUIRE(viaBvh->objectId == 1);
+        REQUIRE(viaBvh->t == linear->t);
+    }
+}
+
+namespace {
+
+// A non-sphere object: hits every ray at a fixed t.
+class FixedHitObject : public SceneObject {
+public:
+    explicit FixedHitObject(float t) : SceneObject(0, 0, 0, 1, 1, 1, 1), _t(t) {}
+    AABB bounds() const override { return AABB(-1e6f, -1e6f, -1e6f, 1e6f, 1e6f, 1e6f); }
+    std::optional<HitInfo> intersect(const Vector3D& origin, const Vector3D& direction) const override {
+        HitInfo hit;
+        hit.t = _t;
+        hit.point = origin + direction * _t;
+        return hit;
+    }
+
+private:
+    float _t;
+};
+
+}
+
+TEST_CASE("Scene mirrors spheres into a structure-of-arrays store", "[bvh][soa]") {
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> coord(-10, 10);
+    std::uniform_real_distribution<float> radius(0.5, 3);
+
+    Scene scene;
+    for (int i = 0; i < 120; i++) {
+        float shade = i < 60 ? 0.5f : 1.0f;
+        scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), shade, shade, 1, 1, radius(rng)));
+    }
+    scene.addObject(std::make_unique<FixedHitObject>(0.75f));
+    scene.addObject(std::make_unique<Light>(1, 2, 3, 1, 1, 1, 4));
+
+    const SphereStore& spheres = scene.spheres();
+    REQUIRE(spheres.size() == 121);
+    REQUIRE(scene.sphereSlot(120) == SphereStore::kNoSlot);
+    REQUIRE(scene.sphereSlot(121) == 120);
+    REQUIRE(spheres.objectId()[120] == 121);
+    for (std::size_t i = 0; i < 120; i++) {
+        const SceneObject& obj = *scene.objects()[i];
+        std::uint32_t slot = scene.sphereSlot(i);
+        REQUIRE(spheres.cx()[slot] == obj.position().x());
+        REQUIRE(spheres.cz()[slot] == obj.position().z());
+        REQUIRE(spheres.radius()[slot] == obj.radius());
+        REQUIRE(scene.materials()[spheres.material()[slot]].color[0] == obj.color().get(0));
+    }
+    // Runs of equal colours share a material; the white light continues the white run.
+    REQUIRE(scene.materials().size() == 2);
+    // Moving an object keeps its material rather than adding another.
+    for (int frame = 0; frame < 5; frame++) scene.setPosition(0, 1, 2, float(frame));
+    REQUIRE(scene.materials().size() == 2);
+    REQUIRE(scene.materials()[spheres.material()[scene.sphereSlot(0)]].color[0] == 0.5f);
+
+    // Both the streaming scan and the BVH agree with the virtual objects.
+    auto virtualScan = [&](const Ray& ray) {
+        std::optional<HitInfo> best;
+        for (std::size_t i = 0; i < scene.objects().size(); i++) {
+            std::optional<HitInfo> hit = scene.objects()[i]->intersect(ray.origin, ray.direction);
+            if (!hit) continue;
+            hit->objectId = static_cast<std::uint32_t>(i);
+            if (!best || hit->closerThan(*best)) best = hit;
+        }
+        return best;
+    };
+    int sphereWins = 0;
+    for (bool withBvh : {false, true}) {
+        if (withBvh) scene.buildBVH();
+        for (int i = 0; i < 300; i++) {
+            Ray ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()};
+            std::optional<HitInfo> expected = virtualScan(ray);
+            std::optional<HitInfo> hit = scene.intersect(ray);
+            REQUIRE(hit.has_value());
+            REQUIRE(hit->objectId == expected->objectId);
+            REQUIRE(hit->t == expected->t);
+            REQUIRE(hit->normal.y() == expected->normal.y());
+            sphereWins += hit->objectId != 120;
+        }
+    }
+    REQUIRE(sphereWins > 0);
+
+    // Moving and resizing through Scene updates the store; objects() is
+    // read-only, so nothing can bypass it.
+    static_assert(std::is_same_v<decltype(scene.objects()[5]), const SceneObject*>);
+    scene.setPosition(5, 100, 100, 100);
+    scene.setRadius(5, 2);
+    REQUIRE(scene.bvhDirty());
+    REQUIRE(spheres.cx()[scene.sphereSlot(5)] == 100);
+    Ray inside{Vector3D(100.5f, 100, 100), Vector3D(1, 0, 0)};
+    float t = 0;
+    REQUIRE(spheres.distance(scene.sphereSlot(5), inside, t));
+    REQUIRE(t == -2.5f);
+    REQUIRE(scene.intersect(inside)->objectId == virtualScan(inside)->objectId);
+    REQUIRE(scene.updateBVH() != BVHUpdate::None);
+    REQUIRE_FALSE(scene.bvhDirty());
+    REQUIRE(scene.intersect(inside)->objectId == virtualScan(inside)->objectId);
+}
+
+TEST_CASE("Scene::occluded counts crossings within the t range", "[bvh][occluded]") {
+    std::mt19937 rng(24);
+    std::uniform_real_distribution<float> coord(-20, 20);
+    std::uniform_real_distribution<float> radius(1, 10);
+    Scene scene;
+    for (int i = 0; i < 400; i++) {
+        scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+    }
+    scene.addObject(std::make_unique<FixedHitObject>(30));
+    const std::uint32_t fixed = 400;
+
+    // Blocked exactly when some object other than ignore is crossed at
+    // tmin < t < tmax: spheres where the line meets their surface, the fixed
+    // object at its reported t.
+    auto expected = [&](const Ray& ray, float tmin, float tmax, std::uint32_t ignore) {
+        for (std::size_t i = 0; i < scene.objects().size(); i++) {
+            if (i == ignore) continue;
+            const SceneObject* obj = scene.objects()[i];
+            if (i == fixed) {
+                float t = obj->intersect(ray.origin, ray.direction)->t;
+                if (t > tmin && t < tmax) return true;
+                continue;
+            }
+            float tNear, tFar;
+            if (!sphereCrossings(obj->position(), obj->radius(), ray.origin, ray.direction, tNear, tFar)) continue;
+            if ((tNear > tmin && tNear < tmax) || (tFar > tmin && tFar < tmax)) return true;
+        }
+        return false;
+    };
+    std::vector<Ray> rays;
+    for (int i = 0; i < 300; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+
+    const float inf = std::numeric_limits<float>::infinity();
+    const float ranges[][2] = {{0, 0.5f}, {0, 2}, {0, 40}, {-40, 40}, {5, 35}, {0, inf}};
+    int blocked = 0, clear = 0;
+    for (int pass = 0; pass < 3; pass++) {
+        if (pass == 1) scene.buildBVH();
+        // Pending moves fall back to the scan, like intersect().
+        if (pass == 2) scene.setPosition(0, 0, 0, 0);
+        for (const Ray& ray : rays) {
+            std::optional<HitInfo> nearest = scene.intersect(ray);
+            std::uint32_t nearestId = nearest ? nearest->objectId : 0;
+            for (const auto& range : ranges) {
+                for (std::uint32_t ignore : {HitInfo::kNoObject, nearestId, fixed}) {
+                    bool answer = expected(ray, range[0], range[1], ignore);
+                    (answer ? blocked : clear)++;
+                    CAPTURE(pass, range[0], range[1], ignore);
+                    REQUIRE(scene.occluded(ray.origin, ray.direction, range[0], range[1], ignore) == answer);
+                }
+            }
+        }
+    }
+    REQUIRE(blocked > 300);
+    REQUIRE(clear > 300);
+}
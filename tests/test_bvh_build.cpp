@@ -0,0 +1,258 @@
+#include "catch_amalgamated.hpp"
+#include "scene.hpp"
+#include "thread_pool.hpp"
+#include <cstring>
+#include <numeric>
+#include <random>
+
+
+namespace {
+
+std::vector<std::unique_ptr<SceneObject>> randomSpheres(int count, float extent, std::mt19937& rng) {
+    std::uniform_real_distribution<float> coord(-extent, extent);
+    std::uniform_real_distribution<float> radius(0.5, 4);
+    std::vector<std::unique_ptr<SceneObject>> objects;
+    objects.reserve(count);
+    for (int i = 0; i < count; i++) {
+        objects.push_back(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+    }
+    return objects;
+}
+
+// Every object sits in exactly one leaf, leaves are small, interior bounds
+// are exactly the union of their children and leaf bounds that of their
+// objects, and the tree fits the traversal stack.
+void checkStructure(const BVH& bvh, SceneObjectList objects) {
+    const auto& nodes = bvh.nodes();
+    std::vector<int> seen(objects.size());
+    struct Entry {
+        std::uint32_t node;
+        int depth;
+    };
+    std::vector<Entry> stack = {{0, 1}};
+    std::size_t visited = 0;
+    int maxDepth = 0;
+    while (!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        visited++;
+        maxDepth = std::max(maxDepth, entry.depth);
+        const BVH::Node& node = nodes[entry.node];
+        AABB expected;
+        if (node.isLeaf()) {
+            REQUIRE(node.count <= BVH::kMaxLeafSize);
+            for (std::uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                std::uint32_t idx = bvh.indices()[i];
+                seen[idx]++;
+                expected.grow(objects[idx]->bounds());
+            }
+        } else {
+            REQUIRE(node.leftFirst + 1 < nodes.size());
+            expected.grow(nodes[node.leftFirst].bounds);
+            expected.grow(nodes[node.leftFirst + 1].bounds);
+            stack.push_back({node.leftFirst, entry.depth + 1});
+            stack.push_back({node.leftFirst + 1, entry.depth + 1});
+        }
+        for (int k = 0; k < 3; k++) {
+            REQUIRE(node.bounds.min[k] == expected.min[k]);
+            REQUIRE(node.bounds.max[k] == expected.max[k]);
+        }
+    }
+    REQUIRE(visited == nodes.size());
+    REQUIRE(maxDepth <= 64);
+    for (int count : seen) REQUIRE(count == 1);
+}
+
+bool sameTree(const BVH& a, const BVH& b) {
+    return a.indices() == b.indices() && a.nodes().size() == b.nodes().size() &&
+           std::memcmp(a.nodes().data(), b.nodes().data(), a.nodes().size() * sizeof(BVH::Node)) == 0;
+}
+
+}
+
+
+TEST_CASE("Every BVH quality builds a valid tree that finds the nearest hit", "[bvh][build]") {
+    std::mt19937 rng(22);
+    auto objects = randomSpheres(2000, 40, rng);
+    ThreadPool pool(3);
+
+    std::uniform_real_distribution<float> coord(-40, 40);
+    std::vector<Ray> rays;
+    for (int i = 0; i < 300; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+    std::vector<std::optional<HitInfo>> expected;
+    for (const Ray& ray : rays) {
+        std::optional<HitInfo> best;
+        for (std::size_t i = 0; i < objects.size(); i++) {
+            std::optional<HitInfo> hit = objects[i]->intersect(ray.origin, ray.direction);
+            if (!hit) continue;
+            hit->objectId = static_cast<std::uint32_t>(i);
+            if (!best || hit->closerThan(*best)) best = hit;
+        }
+        expected.push_back(best);
+    }
+
+    for (BVHQuality quality : {BVHQuality::Median, BVHQuality::Fast, BVHQuality::Balanced, BVHQuality::High}) {
+        CAPTURE(bvhQualityName(quality));
+        BVHBuildOptions options;
+        options.quality = quality;
+        // Small enough that Balanced switches from SAH to LBVH partway down.
+        options.lbvhThreshold = 64;
+        BVH bvh(objects, options);
+        checkStructure(bvh, objects);
+
+        int hits = 0;
+        for (std::size_t i = 0; i < rays.size(); i++) {
+            std::optional<HitInfo> hit = bvh.intersect(rays[i], objects);
+            REQUIRE(hit.has_value() == expected[i].has_value());
+            if (!hit) continue;
+            hits++;
+            REQUIRE(hit->objectId == expected[i]->objectId);
+            REQUIRE(hit->t == expected[i]->t);
+        }
+        REQUIRE(hits > 30);
+
+        options.pool = &pool;
+        REQUIRE(sameTree(BVH(objects, options), bvh));
+    }
+}
+
+TEST_CASE("Parallel BVH builds match the serial tree", "[bvh][build]") {
+    // Enough objects that the top levels are split breadth-first with
+    // chunked binning before the subtrees are built.
+    std::mt19937 rng(23);
+    auto objects = randomSpheres(150000, 400, rng);
+    ThreadPool two(2), three(3);
+
+    for (BVHQuality quality : {BVHQuality::Fast, BVHQuality::Balanced, BVHQuality::High}) {
+        CAPTURE(bvhQualityName(quality));
+        BVHBuildOptions options;
+        options.quality = quality;
+        BVH serial(objects, options);
+        checkStructure(serial, objects);
+        for (ThreadPool* pool : {&two, &three}) {
+            options.pool = pool;
+            REQUIRE(sameTree(BVH(objects, options), serial));
+        }
+    }
+}
+
+TEST_CASE("BVH quality settings", "[bvh][build]") {
+    SECTION("SAH builds beat the object median") {
+        std::mt19937 rng(24);
+        // Clustered objects, where the median split is a poor choice.
+        std::vector<std::unique_ptr<SceneObject>> objects = randomSpheres(1500, 5, rng);
+        for (auto& object : randomSpheres(500, 100, rng)) objects.push_back(std::move(object));
+
+        auto cost = [&](BVHQuality quality) {
+            BVHBuildOptions options;
+            options.quality = quality;
+            return BVH(objects, options).sahCost();
+        };
+        float median = cost(BVHQuality::Median);
+        REQUIRE(cost(BVHQuality::High) < median);
+        REQUIRE(cost(BVHQuality::Balanced) < median);
+        REQUIRE(BVH().sahCost() == 0);
+    }
+
+    SECTION("Identical objects still split into small leaves") {
+        std::vector<std::unique_ptr<SceneObject>> objects;
+        for (int i = 0; i < 100; i++) objects.push_back(std::make_unique<SphereSceneObject>(1, 2, 3, 1, 1, 1, 1, 1));
+        for (BVHQuality quality : {BVHQuality::Median, BVHQuality::Fast, BVHQuality::Balanced, BVHQuality::High}) {
+            CAPTURE(bvhQualityName(quality));
+            BVHBuildOptions options;
+            options.quality = quality;
+            options.lbvhThreshold = 16;
+            checkStructure(BVH(objects, options), objects);
+        }
+    }
+
+    SECTION("Names round-trip") {
+        for (BVHQuality quality : {BVHQuality::Median, BVHQuality::Fast, BVHQuality::Balanced, BVHQuality::High}) {
+            REQUIRE(bvhQualityFromName(bvhQualityName(quality)) == quality);
+        }
+        REQUIRE_THROWS_AS(bvhQualityFromName("best"), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Scene refits the BVH around moved objects", "[bvh][refit]") {
+    std::mt19937 rng(25);
+    std::uniform_real_distribution<float> coord(-40, 40);
+    std::uniform_real_distribution<float> step(-2, 2);
+    std::uniform_int_distribution<std::size_t> pick(0, 2999);
+    Scene scene;
+    for (auto& object : randomSpheres(3000, 40, rng)) scene.addObject(std::move(object));
+    scene.buildBVH();
+    REQUIRE(scene.updateBVH() == BVHUpdate::None);
+
+    BVHBuildOptions refitOnly;
+    refitOnly.rebuildSahGrowth = std::numeric_limits<float>::infinity();
+    for (int frame = 0; frame < 10; frame++) {
+        for (int moved = 0; moved < 20; moved++) {
+            std::size_t idx = pick(rng);
+            const Vector3D& p = scene.objects()[idx]->position();
+            scene.setPosition(idx, p.x() + step(rng), p.y() + step(rng), p.z() + step(rng));
+            if (moved % 5 == 0) scene.setRadius(idx, scene.objects()[idx]->radius() * 1.1f);
+        }
+        REQUIRE(scene.bvhDirty());
+        REQUIRE(scene.updateBVH(refitOnly) == BVHUpdate::Refit);
+        REQUIRE_FALSE(scene.bvhDirty());
+    }
+    checkStructure(scene.bvh(), scene.objects());
+    // The incrementally updated cost matches one computed from scratch.
+    REQUIRE(scene.bvh().sahCost() == Catch::Approx(BVH(scene.bvh().nodes(), scene.bvh().indices()).sahCost()));
+
+    Scene reference;
+    for (const auto& object : scene.objects()) {
+        reference.addObject(std::make_unique<SphereSceneObject>(object->position().x(), object->position().y(),
+                                                                object->position().z(), 1, 1, 1, 1, object->radius()));
+    }
+    RayPacket packet;
+    int hits = 0;
+    for (int i = 0; i < 200; i++) {
+        Ray ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()};
+        std::optional<HitInfo> expected = reference.intersect(ray);
+        std::optional<HitInfo> hit = scene.intersect(ray);
+        REQUIRE(hit.has_value() == expected.has_value());
+        if (!hit) continue;
+        hits++;
+        REQUIRE(hit->objectId == expected->objectId);
+        REQUIRE(hit->t == expected->t);
+        if (packet.count < RayPacket::kMaxRays) packet.add(ray);
+    }
+    REQUIRE(hits > 30);
+    std::optional<HitInfo> packetHits[RayPacket::kMaxRays];
+    scene.intersect(packet, packetHits);
+    for (int i = 0; i < packet.count; i++) {
+        REQUIRE(packetHits[i].has_value());
+        REQUIRE(packetHits[i]->objectId == reference.intersect(packet.ray(i))->objectId);
+    }
+
+    SECTION("Scattering objects across the scene triggers a rebuild") {
+        // Each moved leaf stretches every node above it across the scene.
+        float before = scene.bvh().sahCost();
+        for (std::size_t idx = 0; idx < 100; idx++) scene.setPosition(idx, coord(rng), coord(rng), coord(rng));
+        REQUIRE(scene.updateBVH() == BVHUpdate::Rebuild);
+        REQUIRE(scene.bvh().sahCost() < before * BVHBuildOptions().rebuildSahGrowth);
+        checkStructure(scene.bvh(), scene.objects());
+    }
+}
+
+TEST_CASE("Parallel refits match serial ones", "[bvh][refit]") {
+    std::mt19937 rng(26);
+    auto objects = randomSpheres(40000, 200, rng);
+    BVH serial(objects);
+    BVH parallel = serial;
+    std::vector<std::uint32_t> changed(objects.size());
+    std::iota(changed.begin(), changed.end(), 0);
+    for (auto& object : objects) object->setRadius(object->radius() * 0.5f);
+
+    ThreadPool pool(3);
+    std::vector<std::uint32_t> updated = serial.refit(objects, changed);
+    REQUIRE(parallel.refit(objects, changed, &pool) == updated);
+    REQUIRE(updated.size() == serial.nodes().size());
+    REQUIRE(updated.back() == 0);
+    REQUIRE(sameTree(parallel, serial));
+    checkStructure(serial, objects);
+}
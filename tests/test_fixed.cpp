@@ -0,0 +1,103 @@
+#include "catch_amalgamated.hpp"
+#include "fixed_matrix.hpp"
+
+
+// Everything but sqrt is constexpr, so these are checked by the compiler.
+static_assert(Vec3f(1, 2, 3).dot(Vec3f(4, 5, 6)) == 32);
+static_assert(Vec3f(1, 2, 3).cross(Vec3f(4, 5, 6)) == Vec3f(-3, 6, -3));
+static_assert(MatN<int, 3, 3>(VecN<int, 3>(2, 0, 1), VecN<int, 3>(1, 3, 2), VecN<int, 3>(1, 1, 2)).determinant() == 6);
+static_assert(Mat4f::identity() * Vec4f(1, 2, 3, 1) == Vec4f(1, 2, 3, 1));
+static_assert(sizeof(Mat4f) == 16 * sizeof(float));
+static_assert(std::is_trivially_copyable_v<Mat4f>);
+
+// Dimension mismatches do not compile.
+template <typename A, typename B>
+concept Addable = requires(A a, B b) { a + b; };
+template <typename A, typename B>
+concept Multipliable = requires(A a, B b) { a * b; };
+template <typename A>
+concept HasDeterminant = requires(A a) { a.determinant(); };
+template <typename A>
+concept HasCross = requires(A a) { a.cross(a); };
+
+static_assert(!Addable<Vec3f, Vec4f>);
+static_assert(!Multipliable<MatN<float, 2, 3>, MatN<float, 2, 3>>);
+static_assert(!Multipliable<MatN<float, 2, 3>, Vec2f>);
+static_assert(Multipliable<MatN<float, 2, 3>, Vec3f>);
+static_assert(std::is_same_v<decltype(MatN<float, 2, 3>() * MatN<float, 3, 4>()), MatN<float, 2, 4>>);
+static_assert(!HasDeterminant<MatN<float, 2, 3>>);
+static_assert(!HasCross<Vec4f>);
+
+TEST_CASE("VecN", "[fixed]") {
+    Vec3f a(1, 2, 3);
+    Vec3f b(4, 5, 6);
+
+    SECTION("Arithmetic") {
+        REQUIRE(a + b == Vec3f(5, 7, 9));
+        REQUIRE(b - a == Vec3f(3, 3, 3));
+        REQUIRE(a * 2.0f == Vec3f(2, 4, 6));
+        REQUIRE(2.0f * a == Vec3f(2, 4, 6));
+        REQUIRE(-a == Vec3f(-1, -2, -3));
+        REQUIRE(a.magnitude() == Catch::Approx(std::sqrt(14.0)));
+        REQUIRE(Vec3f(3, 0, 4).normalize() == Vec3f(0.6f, 0, 0.8f));
+        REQUIRE(VecN<int, 4>(1, -5, 2, 0).l1Norm() == 8);
+        REQUIRE(VecN<int, 4>(1, -5, 2, 0).linfNorm() == 5);
+    }
+
+    SECTION("Bounds-checked access") {
+        REQUIRE(a.get(2) == 3);
+        REQUIRE_THROWS_AS(a.get(3), std::out_of_range);
+        a.set(0, 7);
+        REQUIRE(a.x() == 7);
+    }
+
+    SECTION("Conversions") {
+        VectorND<float> dynamic = static_cast<VectorND<float>>(a);
+        REQUIRE(dynamic.size() == 3);
+        REQUIRE(dynamic.get(1) == 2);
+        REQUIRE(Vec3f(dynamic) == a);
+        REQUIRE_THROWS_AS(Vec4f(dynamic), std::length_error);
+
+        Vector3D legacy = static_cast<Vector3D>(a.cross(b));
+        Vector3D expected = Vector3D(1, 2, 3).cross(Vector3D(4, 5, 6));
+        REQUIRE(legacy.x() == expected.x());
+        REQUIRE(legacy.y() == expected.y());
+        REQUIRE(legacy.z() == expected.z());
+        REQUIRE(Vec3f(expected) == Vec3f(-3, 6, -3));
+    }
+}
+
+TEST_CASE("MatN", "[fixed]") {
+    Mat3d m(Vec3d(2, -1, 0), Vec3d(-1, 2, -1), Vec3d(0, -1, 2));
+
+    SECTION("Products") {
+        MatN<int, 2, 3> a(VecN<int, 3>(1, 2, 3), VecN<int, 3>(4, 5, 6));
+        MatN<int, 3, 2> b(VecN<int, 2>(7, 8), VecN<int, 2>(9, 10), VecN<int, 2>(11, 12));
+        MatN<int, 2, 2> c = a * b;
+        REQUIRE(c == MatN<int, 2, 2>(VecN<int, 2>(58, 64), VecN<int, 2>(139, 154)));
+        REQUIRE(a.transpose() * VecN<int, 2>(1, 1) == VecN<int, 3>(5, 7, 9));
+        REQUIRE(a.col(1) == VecN<int, 2>(2, 5));
+    }
+
+    SECTION("Determinant and inverse") {
+        REQUIRE(m.determinant() == Catch::Approx(4));
+        REQUIRE(m.trace() == 6);
+        Mat3d product = m * m.inverse();
+        for (std::size_t i = 0; i < 3; i++) {
+            for (std::size_t j = 0; j < 3; j++) {
+                REQUIRE(product(i, j) == Catch::Approx(i == j ? 1.0 : 0.0).margin(1e-12));
+            }
+        }
+        REQUIRE_THROWS_AS(Mat3d().inverse(), std::domain_error);
+    }
+
+    SECTION("Agrees with MatrixND") {
+        Mat4d t(Vec4d(1, 2, 0, 3), Vec4d(0, 1, 4, 1), Vec4d(2, 0, 1, 0), Vec4d(1, 1, 1, 1));
+        MatrixND<double> dynamic = static_cast<MatrixND<double>>(t);
+        REQUIRE(dynamic.rows() == 4);
+        REQUIRE(dynamic.cols() == 4);
+        REQUIRE(t.determinant() == Catch::Approx(dynamic.determinant()));
+        REQUIRE(Mat4d(dynamic * dynamic) == t * t);
+        REQUIRE_THROWS_AS(Mat3d(dynamic), std::length_error);
+    }
+}
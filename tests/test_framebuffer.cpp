@@ -0,0 +1,77 @@
+#include "catch_amalgamated.hpp"
+#include "framebuffer.hpp"
+#include "arena.hpp"
+#include <cstdint>
+
+
+TEST_CASE("Framebuffer layout", "[framebuffer]") {
+    Framebuffer rgb(10, 4);
+    REQUIRE(rgb.format() == PixelFormat::RGB8);
+    REQUIRE(rgb.stride() == 64);
+    REQUIRE(rgb.byteSize() == 4 * 64);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(rgb.data()) % Framebuffer::kAlignment == 0);
+    REQUIRE(rgb.row(3) == rgb.data() + 3 * 64);
+
+    Framebuffer hdr(17, 3, PixelFormat::RGBA32F);
+    REQUIRE(hdr.stride() == 320); // 17 * 16 bytes rounded up to a cache line
+    for (int y = 0; y < hdr.height(); y++) {
+        REQUIRE(reinterpret_cast<std::uintptr_t>(hdr.row(y)) % Framebuffer::kAlignment == 0);
+    }
+
+    const std::uint8_t* before = rgb.data();
+    rgb.resize(10, 4);
+    REQUIRE(rgb.data() == before);
+    rgb.resize(0, 0);
+    REQUIRE(rgb.byteSize() == 0);
+    REQUIRE(rgb.data() == nullptr);
+}
+
+TEST_CASE("Framebuffer pixel conversion", "[framebuffer]") {
+    Framebuffer rgb(3, 2);
+    rgb.clear();
+    rgb.setPixel(2, 1, {255, 51, 0});
+    REQUIRE(rgb.row(1)[6] == 255);
+    REQUIRE(rgb.row(1)[7] == 51);
+    REQUIRE(rgb.pixelRGB8(0, 0) == std::array<std::uint8_t, 3>{0, 0, 0});
+    REQUIRE(rgb.pixelRGBA32F(2, 1) == std::array<float, 4>{1.0f, 0.2f, 0.0f, 1.0f});
+
+    Framebuffer hdr(3, 2, PixelFormat::RGBA32F);
+    hdr.setPixel(1, 0, {125, 255, 0});
+    REQUIRE(hdr.pixelRGB8(1, 0) == std::array<std::uint8_t, 3>{125, 255, 0});
+    hdr.tile(0, 1, 1, 1).setPixel(0, 0, std::array<float, 4>{2.0f, -1.0f, 0.5f, 1.0f});
+    REQUIRE(hdr.pixelRGB8(0, 1) == std::array<std::uint8_t, 3>{255, 0, 128});
+    REQUIRE(hdr.pixelRGBA32F(0, 1)[0] == 2.0f);
+}
+
+TEST_CASE("Framebuffer tiles are clipped windows", "[framebuffer]") {
+    Framebuffer frame(10, 7);
+    frame.clear();
+    FramebufferTile tile = frame.tile(8, 4, 4, 4);
+    REQUIRE(tile.x0() == 8);
+    REQUIRE(tile.y0() == 4);
+    REQUIRE(tile.width() == 2);
+    REQUIRE(tile.height() == 3);
+    for (int y = 0; y < tile.height(); y++) {
+        for (int x = 0; x < tile.width(); x++) tile.setPixel(x, y, std::array<std::uint8_t, 3>{1, 2, 3});
+    }
+    int written = 0;
+    for (int y = 0; y < frame.height(); y++) {
+        for (int x = 0; x < frame.width(); x++) {
+            bool inside = x >= 8 && y >= 4;
+            REQUIRE((frame.pixelRGB8(x, y)[2] == 3) == inside);
+            written += inside;
+        }
+    }
+    REQUIRE(written == 6);
+}
+
+TEST_CASE("Framebuffer memory comes from the given resource", "[framebuffer][arena]") {
+    ArenaResource arena;
+    {
+        Framebuffer frame(20, 20, PixelFormat::RGBA32F, &arena);
+        REQUIRE(arena.bytesUsed() >= frame.byteSize());
+        Framebuffer moved = std::move(frame);
+        REQUIRE(moved.width() == 20);
+    }
+    arena.reset();
+}
@@ -0,0 +1,237 @@
+#include "catch_amalgamated.hpp"
+#include "batch.hpp"
+#include "image_io.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+
+namespace {
+
+std::filesystem::path scratchDir(const char* name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+std::vector<std::uint8_t> readFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::uint32_t bigEndian(const std::uint8_t* p) {
+    return std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | p[3];
+}
+
+Framebuffer gradient(int width, int height, PixelFormat format) {
+    Framebuffer frame(width, height, format);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            frame.setPixel(x, y, {std::uint8_t(x * 10), std::uint8_t(y * 20), std::uint8_t(x + y)});
+        }
+    }
+    return frame;
+}
+
+// Pixels of a PNG made of stored deflate blocks, as the encoder writes them.
+std::vector<std::uint8_t> storedPngPixels(const std::vector<std::uint8_t>& png, int& width, int& height) {
+    std::vector<std::uint8_t> zlib;
+    for (std::size_t p = 8; p < png.size();) {
+        std::uint32_t size = bigEndian(&png[p]);
+        std::string type(png.begin() + p + 4, png.begin() + p + 8);
+        if (type == "IHDR") {
+            width = bigEndian(&png[p + 8]);
+            height = bigEndian(&png[p + 12]);
+        } else if (type == "IDAT") {
+            zlib.insert(zlib.end(), png.begin() + p + 8, png.begin() + p + 8 + size);
+        }
+        p += 12 + size;
+    }
+    std::vector<std::uint8_t> raw;
+    for (std::size_t p = 2; p + 4 < zlib.size();) {
+        bool last = zlib[p] & 1;
+        std::size_t len = zlib[p + 1] | zlib[p + 2] << 8;
+        REQUIRE(static_cast<std::size_t>(zlib[p + 3] | zlib[p + 4] << 8) == (~len & 0xFFFF));
+        raw.insert(raw.end(), zlib.begin() + p + 5, zlib.begin() + p + 5 + len);
+        p += 5 + len;
+        if (last) break;
+    }
+    std::vector<std::uint8_t> pixels;
+    std::size_t rowBytes = static_cast<std::size_t>(width) * 3 + 1;
+    for (int y = 0; y < height; y++) {
+        REQUIRE(raw[y * rowBytes] == 0);
+        pixels.insert(pixels.end(), raw.begin() + y * rowBytes + 1, raw.begin() + (y + 1) * rowBytes);
+    }
+    return pixels;
+}
+
+}
+
+
+TEST_CASE("Image format from extension", "[image]") {
+    REQUIRE(imageFormatFromPath("out/frame.png") == ImageFormat::PNG);
+    REQUIRE(imageFormatFromPath("frame.PPM") == ImageFormat::PPM);
+    REQUIRE(imageFormatFromPath("a.b/frame.pfm") == ImageFormat::PFM);
+    REQUIRE_THROWS_AS(imageFormatFromPath("frame.jpg"), std::invalid_argument);
+    REQUIRE_THROWS_AS(imageFormatFromPath("frame"), std::invalid_argument);
+    REQUIRE(pixelFormatFor(ImageFormat::PFM) == PixelFormat::RGBA32F);
+    REQUIRE(pixelFormatFor(ImageFormat::PNG) == PixelFormat::RGB8);
+}
+
+TEST_CASE("PPM and PFM encoding", "[image]") {
+    Framebuffer frame = gradient(5, 3, PixelFormat::RGB8);
+
+    std::vector<std::uint8_t> ppm = encodeImage(frame, ImageFormat::PPM);
+    const std::string header = "P6\n5 3\n255\n";
+    REQUIRE(std::string(ppm.begin(), ppm.begin() + header.size()) == header);
+    REQUIRE(ppm.size() == header.size() + 5 * 3 * 3);
+    REQUIRE(ppm[header.size() + (2 * 5 + 4) * 3 + 1] == 40); // green of (4, 2)
+
+    std::vector<std::uint8_t> pfm = encodeImage(frame, ImageFormat::PFM);
+    const std::string pfmHeader = "PF\n5 3\n-1.0\n";
+    REQUIRE(std::string(pfm.begin(), pfm.begin() + pfmHeader.size()) == pfmHeader);
+    REQUIRE(pfm.size() == pfmHeader.size() + 5 * 3 * 3 * sizeof(float));
+    // Bottom row first.
+    float first[3];
+    std::memcpy(first, &pfm[pfmHeader.size()], sizeof(first));
+    REQUIRE(first[1] == Catch::Approx(40 / 255.0f));
+
+    // Float framebuffers keep values above 1 in PFM and clamp them for PPM.
+    Framebuffer hdr(1, 1, PixelFormat::RGBA32F);
+    hdr.tile(0, 0, 1, 1).setPixel(0, 0, std::array<float, 4>{4.0f, 0.5f, 0.0f, 1.0f});
+    std::vector<std::uint8_t> hdrPfm = encodeImage(hdr, ImageFormat::PFM);
+    float red;
+    std::memcpy(&red, &hdrPfm[hdrPfm.size() - 3 * sizeof(float)], sizeof(red));
+    REQUIRE(red == 4.0f);
+    std::vector<std::uint8_t> hdrPpm = encodeImage(hdr, ImageFormat::PPM);
+    REQUIRE(hdrPpm[hdrPpm.size() - 3] == 255);
+    REQUIRE(hdrPpm.back() == 0);
+}
+
+TEST_CASE("PNG encoding", "[image]") {
+    // Large enough to need more than one stored deflate block.
+    Framebuffer frame = gradient(200, 120, PixelFormat::RGB8);
+    std::vector<std::uint8_t> png = encodeImage(frame, ImageFormat::PNG);
+    const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    REQUIRE(std::memcmp(png.data(), signature, 8) == 0);
+
+    int width = 0, height = 0;
+    std::vector<std::uint8_t> pixels = storedPngPixels(png, width, height);
+    REQUIRE(width == 200);
+    REQUIRE(height == 120);
+    std::vector<std::uint8_t> expected;
+    for (int y = 0; y < height; y++) expected.insert(expected.end(), frame.row(y), frame.row(y) + width * 3);
+    REQUIRE(pixels == expected);
+    // IHDR CRC of a 200x120 8-bit RGB image, checked against zlib's crc32.
+    REQUIRE(bigEndian(&png[29]) == 0x38F02ABCu);
+}
+
+TEST_CASE("Async image writer overlaps and recycles frames", "[image]") {
+    std::filesystem::path dir = scratchDir("raytrace_async_writer");
+    {
+        AsyncImageWriter writer(1);
+        REQUIRE(writer.recycle().byteSize() == 0);
+        for (int i = 0; i < 4; i++) {
+            Framebuffer frame = writer.recycle();
+            frame.resize(8, 6, PixelFormat::RGB8);
+            frame.clear();
+            frame.setPixel(0, 0, {std::uint8_t(i), 0, 0});
+            writer.submit(std::move(frame), (dir / ("f" + std::to_string(i) + ".ppm")).string(), ImageFormat::PPM);
+        }
+        writer.wait();
+        REQUIRE(writer.written() == 4);
+        REQUIRE(writer.recycle().byteSize() == 6 * 64);
+
+        writer.submit(Framebuffer(2, 2), (dir / "missing" / "x.ppm").string(), ImageFormat::PPM);
+        REQUIRE_THROWS_AS(writer.wait(), std::runtime_error);
+    }
+    for (int i = 0; i < 4; i++) {
+        std::vector<std::uint8_t> bytes = readFile(dir / ("f" + std::to_string(i) + ".ppm"));
+        REQUIRE(bytes.size() == std::string("P6\n8 6\n255\n").size() + 8 * 6 * 3);
+        REQUIRE(bytes[11] == i);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Frame paths", "[batch]") {
+    REQUIRE(framePath("out.png", 0, 1) == "out.png");
+    REQUIRE(framePath("out.png", 7, 10) == "out_0007.png");
+    REQUIRE(framePath("dir.v2/out", 3, 4) == "dir.v2/out_0003");
+    REQUIRE(framePath("frame_%03d.pfm", 12, 20) == "frame_012.pfm");
+    REQUIRE(framePath("f%d_100%%.png", 7, 20) == "f7_100%.png");
+    REQUIRE(framePath("f%3d.png", 7, 20) == "f  7.png");
+    REQUIRE(framePath("frame_%02d.png", 12345, 20000) == "frame_12345.png");
+    REQUIRE(framePath(std::string(300, 'a') + "%04d.ppm", 1, 2) == std::string(300, 'a') + "0001.ppm");
+    for (const char* bad : {"out_%s.png", "out_%n.png", "out%.png", "out_%d_%d.png", "out_%x.png", "out_%100d.png", "%"}) {
+        CAPTURE(bad);
+        REQUIRE_THROWS_AS(framePath(bad, 1, 2), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Batch render writes every frame", "[batch]") {
+    std::filesystem::path dir = scratchDir("raytrace_batch");
+    Scene scene;
+    scene.addObject(std::make_unique<SphereSceneObject>(0.1, 1, 0, 1, 1, 1, 1, 2));
+    scene.setCamera(std::make_unique<Camera>(-4, 1, 0, 0, 0.2, 0.1, 4));
+    scene.addLight(std::make_unique<Light>(0, 15, 0, 1, 1, 1, 23));
+
+    BatchOptions options;
+    options.settings.width = 16;
+    options.settings.height = 12;
+    options.settings.threads = 2;
+    options.frames = 3;
+    options.output = (dir / "frame.png").string();
+    options.cameraStep = Vector3D(0, 0.5f, 0);
+
+    Framebuffer reference;
+    Renderer(options.settings).render(scene, reference);
+
+    BatchReport report = renderBatch(scene, options);
+    REQUIRE(report.frames == 3);
+    REQUIRE(report.wallSeconds >= report.renderSeconds);
+    REQUIRE(scene.cam()->position().y() == Catch::Approx(2.5f));
+
+    int width = 0, height = 0;
+    std::vector<std::uint8_t> pixels = storedPngPixels(readFile(dir / "frame_0000.png"), width, height);
+    REQUIRE(width == 16);
+    REQUIRE(height == 12);
+    for (int y = 0; y < height; y++) {
+        REQUIRE(std::equal(reference.row(y), reference.row(y) + width * 3, pixels.begin() + y * width * 3));
+    }
+    REQUIRE(std::filesystem::exists(dir / "frame_0002.png"));
+
+    options.output = (dir / "hdr.pfm").string();
+    options.frames = 1;
+    renderBatch(scene, options);
+    REQUIRE(std::filesystem::file_size(dir / "hdr.pfm") == std::string("PF\n16 12\n-1.0\n").size() + 16 * 12 * 12);
+
+    // animate runs before every frame, and the BVH follows what it moves.
+    int calls = 0;
+    options.frames = 2;
+    options.animate = [&](Scene& animated, int frame) {
+        calls++;
+        animated.setPosition(0, 0.1f, 1, 0.2f * frame);
+    };
+    report = renderBatch(scene, options);
+    REQUIRE(calls == 2);
+    REQUIRE_FALSE(scene.bvhDirty());
+    REQUIRE(scene.objects()[0]->position().z() == 0.2f);
+    // The batch's BVH options reach updateBVH(): no growth allowance rebuilds every frame.
+    options.bvh.rebuildSahGrowth = 0;
+    report = renderBatch(scene, options);
+    REQUIRE(report.bvhRebuilds == 2);
+    REQUIRE_FALSE(scene.bvhDirty());
+
+    // A frame that cannot be written stops the run.
+    calls = 0;
+    options.frames = 50;
+    options.output = (dir / "missing" / "frame.ppm").string();
+    REQUIRE_THROWS_AS(renderBatch(scene, options), std::runtime_error);
+    REQUIRE(calls <= static_cast<int>(options.maxPendingWrites) + 3);
+    options.output = (dir / "frame_%s.ppm").string();
+    REQUIRE_THROWS_AS(renderBatch(scene, options), std::invalid_argument);
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,82 @@
+#include "catch_amalgamated.hpp"
+#include "light.hpp"
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+// Mean of weight[0] * max(0, n.l) over a grid of sample positions.
+double meanIrradiance(const AnalyticLight& light, const Vector3D& p, const Vector3D& normal, int grid) {
+    double sum = 0;
+    for (int a = 0; a < grid; a++) {
+        for (int b = 0; b < grid; b++) {
+            LightSample s = light.sample(p, (a + 0.5f) / grid, (b + 0.5f) / grid);
+            sum += s.weight[0] * std::max(0.0f, normal.dot(s.direction));
+        }
+    }
+    return sum / (grid * grid);
+}
+
+}
+
+
+TEST_CASE("Point and directional lights", "[light]") {
+    AnalyticLight point = AnalyticLight::point(Vector3D(1, 5, 1), 1, 0.5f, 0.25f, 50);
+    LightSample s = point.sample(Vector3D(1, 0, 1), 0.3f, 0.9f);
+    REQUIRE(s.direction.y() == 1);
+    REQUIRE(s.distance == 5);
+    REQUIRE(s.weight[0] == Catch::Approx(2));
+    REQUIRE(s.weight[2] == Catch::Approx(0.5));
+
+    AnalyticLight sun = AnalyticLight::directional(Vector3D(0, -4, 3), 1, 1, 1, 0.75f);
+    REQUIRE(sun.direction[1] == Catch::Approx(-0.8));
+    s = sun.sample(Vector3D(100, -7, 2), 0.5f, 0.5f);
+    REQUIRE(s.direction.y() == Catch::Approx(0.8));
+    REQUIRE(s.direction.z() == Catch::Approx(-0.6));
+    REQUIRE(std::isinf(s.distance));
+    REQUIRE(s.weight[1] == 0.75f);
+
+    REQUIRE_THROWS_AS(AnalyticLight::directional(Vector3D(0, 0, 0), 1, 1, 1, 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(AnalyticLight::sphere(Vector3D(0, 0, 0), 0, 1, 1, 1, 1), std::invalid_argument);
+    REQUIRE(std::string(lightTypeName(LightType::Sphere)) == "sphere");
+}
+
+TEST_CASE("Sphere light samples land on the sphere", "[light]") {
+    const Vector3D center(2, 6, -1);
+    const float radius = 1.5f;
+    AnalyticLight light = AnalyticLight::sphere(center, radius, 1, 1, 1, 20);
+
+    for (Vector3D p : {Vector3D(0, 0, 0), Vector3D(2, 6.5f, -1), Vector3D(2, 6, -1), Vector3D(-30, 40, 12)}) {
+        CAPTURE(p.toString());
+        bool inside = (center - p).magnitude() <= radius;
+        float cosMax = inside ? -1 : std::sqrt(1 - radius * radius / (center - p).lengthSquared());
+        for (int k = 0; k < 200; k++) {
+            LightSample s = light.sample(p, (k % 20 + 0.5f) / 20, (k / 20 + 0.5f) / 10);
+            REQUIRE(s.direction.magnitude() == Catch::Approx(1));
+            REQUIRE(s.distance >= 0);
+            REQUIRE((p + s.direction * s.distance - center).magnitude() == Catch::Approx(radius).epsilon(1e-3));
+            if (!inside) REQUIRE(s.direction.dot((center - p).normalize()) >= cosMax - 1e-5f);
+        }
+    }
+}
+
+TEST_CASE("Sphere light estimates converge to the analytic irradiance", "[light]") {
+    // A sphere fully above the horizon, seen along the normal, gives the same
+    // irradiance as a point light of the same intensity at its centre.
+    const Vector3D normal(0, 1, 0);
+    for (float radius : {0.5f, 2.0f, 3.5f}) {
+        CAPTURE(radius);
+        AnalyticLight sphere = AnalyticLight::sphere(Vector3D(0, 4, 0), radius, 1, 1, 1, 32);
+        AnalyticLight point = AnalyticLight::point(Vector3D(0, 4, 0), 1, 1, 1, 32);
+        double expected = point.sample(Vector3D(), 0, 0).weight[0];
+        REQUIRE(expected == Catch::Approx(2));
+        REQUIRE(meanIrradiance(sphere, Vector3D(), normal, 64) == Catch::Approx(expected).epsilon(0.01));
+    }
+
+    // Small and far away it is a point light even sample by sample.
+    AnalyticLight tiny = AnalyticLight::sphere(Vector3D(0, 1000, 0), 0.01f, 1, 1, 1, 1e6f);
+    LightSample s = tiny.sample(Vector3D(), 0.7f, 0.2f);
+    REQUIRE(s.weight[0] == Catch::Approx(1));
+    REQUIRE(s.distance == Catch::Approx(1000).margin(0.02));
+}
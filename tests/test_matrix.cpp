@@ -202,3 +202,240 @@ TEST_CASE("VectorND Operations") {
         REQUIRE(cross_prod.z() == -3);
     }
 }
+
+TEST_CASE("MatrixND contiguous storage", "[MatrixND]") {
+    MatrixND<float> m(3, 5);
+    for (size_t i = 0; i < m.rows(); i++) {
+        for (size_t j = 0; j < m.cols(); j++) {
+            m.set(i, j, i * 10 + j);
+        }
+    }
+
+    SECTION("Rows are aligned and ld() apart") {
+        REQUIRE(m.ld() >= m.cols());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(m.data()) % MatrixND<float>::kAlignment == 0);
+        for (size_t i = 0; i < m.rows(); i++) {
+            REQUIRE(m.rowPtr(i) == m.data() + i * m.ld());
+            REQUIRE(reinterpret_cast<std::uintptr_t>(m.rowPtr(i)) % MatrixND<float>::kAlignment == 0);
+            REQUIRE(m.rowPtr(i)[4] == i * 10 + 4);
+        }
+    }
+
+    SECTION("Row views share the matrix storage") {
+        VectorND<float> row = m.row(1);
+        REQUIRE(row.size() == 5);
+        REQUIRE(row.vectorData().borrowed());
+        REQUIRE(&row.vectorData().get(0) == m.rowPtr(1));
+        row.set(2, -1);
+        REQUIRE(m.get(1, 2) == -1);
+
+        // Views work wherever a VectorND is expected.
+        MatrixND<float> shifted = m + m.get(0);
+        REQUIRE(shifted.get(2, 3) == 23 + 3);
+        REQUIRE(m.get(2).dot(m.get(0)) == Catch::Approx(20*0 + 21*1 + 22*2 + 23*3 + 24*4));
+
+        // Copies of a view own their data.
+        VectorND<float> copy(row);
+        REQUIRE_FALSE(copy.vectorData().borrowed());
+        copy.set(0, 99);
+        REQUIRE(m.get(1, 0) == 10);
+    }
+
+    SECTION("Non-square transpose and multiply") {
+        MatrixND<float> t = m.transpose();
+        REQUIRE(t.rows() == 5);
+        REQUIRE(t.cols() == 3);
+        REQUIRE(t.get(4, 2) == m.get(2, 4));
+
+        MatrixND<float> p = m * t;
+        REQUIRE(p.rows() == 3);
+        REQUIRE(p.cols() == 3);
+        REQUIRE(p.get(0, 1) == Catch::Approx(0*10 + 1*11 + 2*12 + 3*13 + 4*14));
+    }
+
+    SECTION("Copies are deep") {
+        MatrixND<float> copy = m;
+        copy.set(0, 0, 42);
+        REQUIRE(m.get(0, 0) == 0);
+    }
+
+    SECTION("Moves leave an empty matrix that can still be copied") {
+        MatrixND<float> moved(std::move(m));
+        REQUIRE(moved.get(2, 4) == 24);
+        REQUIRE(m.rows() == 0);
+        REQUIRE(m.cols() == 0);
+        MatrixND<float> copy = m;
+        REQUIRE(copy.rows() == 0);
+
+        MatrixND<float> assigned(1, 1);
+        assigned = std::move(moved);
+        REQUIRE(assigned.get(1, 3) == 13);
+        REQUIRE(moved.rows() == 0);
+        moved = copy;
+        REQUIRE(moved.cols() == 0);
+    }
+}
+
+TEST_CASE("GEMM kernels", "[MatrixND][gemm]") {
+    // Awkward sizes exercise the edge tiles and more than one KC/MC block.
+    const std::size_t m = 131, n = 37, k = 300;
+    MatrixND<float> a(m, k), b(k, n);
+    for (std::size_t i = 0; i < m; i++)
+        for (std::size_t p = 0; p < k; p++)
+            a.set(i, p, float((i * 7 + p * 3) % 11) - 5);
+    for (std::size_t p = 0; p < k; p++)
+        for (std::size_t j = 0; j < n; j++)
+            b.set(p, j, float((p * 5 + j) % 13) - 6);
+
+    // Small integers keep every partial sum exact, so all paths must agree bit for bit.
+    MatrixND<float> expected(m, n);
+    for (std::size_t i = 0; i < m; i++)
+        for (std::size_t j = 0; j < n; j++) {
+            float sum = 0;
+            for (std::size_t p = 0; p < k; p++) sum += a.get(i, p) * b.get(p, j);
+            expected.set(i, j, sum);
+        }
+
+    auto check = [&](const MatrixND<float>& c) {
+        REQUIRE(c.rows() == m);
+        REQUIRE(c.cols() == n);
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++)
+                REQUIRE(c.get(i, j) == expected.get(i, j));
+    };
+
+    SECTION("MatrixND::mul") {
+        check(a * b);
+    }
+
+    for (GemmKernel kernel : {GemmKernel::Scalar, detectGemmKernel()}) {
+        DYNAMIC_SECTION("Kernel " << gemmKernelName(kernel)) {
+            MatrixND<float> c(m, n);
+            gemm(m, n, k, a.data(), a.ld(), b.data(), b.ld(), c.data(), c.ld(), kernel);
+            check(c);
+        }
+    }
+
+    SECTION("double and int") {
+        MatrixND<double> ad(m, k), bd(k, n);
+        MatrixND<int> ai(m, k), bi(k, n);
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t p = 0; p < k; p++) {
+                ad.set(i, p, a.get(i, p));
+                ai.set(i, p, a.get(i, p));
+            }
+        for (std::size_t p = 0; p < k; p++)
+            for (std::size_t j = 0; j < n; j++) {
+                bd.set(p, j, b.get(p, j));
+                bi.set(p, j, b.get(p, j));
+            }
+        MatrixND<double> cd = ad * bd;
+        MatrixND<int> ci = ai * bi;
+        for (std::size_t i = 0; i < m; i++)
+            for (std::size_t j = 0; j < n; j++) {
+                REQUIRE(cd.get(i, j) == expected.get(i, j));
+                REQUIRE(ci.get(i, j) == expected.get(i, j));
+            }
+    }
+}
+
+TEST_CASE("MatrixND LU decomposition", "[MatrixND][lu]") {
+    MatrixND<double> a(std::vector<VectorND<double>>{
+        VectorND<double>(VectorData<double>(std::vector<double>{2, 1, 1, 0})),
+        VectorND<double>(VectorData<double>(std::vector<double>{4, 3, 3, 1})),
+        VectorND<double>(VectorData<double>(std::vector<double>{8, 7, 9, 5})),
+        VectorND<double>(VectorData<double>(std::vector<double>{6, 7, 9, 8})),
+    });
+
+    SECTION("Factors reproduce the permuted matrix") {
+        LUDecomposition<double> lu = a.lu();
+        REQUIRE_FALSE(lu.singular());
+        const MatrixND<double>& f = lu.factors();
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                double sum = 0;
+                for (size_t k = 0; k <= std::min(i, j); k++) {
+                    sum += (k == i ? 1.0 : f.get(i, k)) * f.get(k, j);
+                }
+                REQUIRE(sum == Catch::Approx(a.get(lu.permutation()[i], j)));
+            }
+        }
+    }
+
+    SECTION("Determinant") {
+        REQUIRE(a.determinant() == Catch::Approx(8));
+
+        MatrixND<int> swap(std::vector<VectorND<int>>{
+            VectorND<int>(VectorData<int>(std::vector<int>{0, 1})),
+            VectorND<int>(VectorData<int>(std::vector<int>{1, 0})),
+        });
+        REQUIRE(swap.determinant() == -1);
+
+        MatrixND<float> single(1, 1);
+        single.set(0, 0, 3);
+        REQUIRE(single.determinant() == 3);
+    }
+
+    SECTION("Inverse") {
+        MatrixND<double> product = a * a.inverse();
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                REQUIRE(product.get(i, j) == Catch::Approx(i == j ? 1.0 : 0.0).margin(1e-12));
+            }
+        }
+        // Agrees with the classical adjoint formula.
+        MatrixND<double> classical = a.adjoint() / a.determinant();
+        REQUIRE(classical.get(1, 2) == Catch::Approx(a.inverse().get(1, 2)));
+    }
+
+    SECTION("Solve") {
+        VectorND<double> b(VectorData<double>(std::vector<double>{1, 2, 3, 4}));
+        VectorND<double> x = a.solve(b);
+        VectorND<double> back = a.dot(x);
+        for (size_t i = 0; i < 4; i++) {
+            REQUIRE(back.get(i) == Catch::Approx(b.get(i)));
+        }
+
+        MatrixND<double> rhs = a.transpose();
+        MatrixND<double> xs = a.solve(rhs);
+        MatrixND<double> check = a * xs;
+        REQUIRE(check.get(3, 1) == Catch::Approx(rhs.get(3, 1)));
+    }
+
+    SECTION("Singular matrices") {
+        MatrixND<double> s(3, 3);
+        s.set(0, 0, 1);
+        s.set(1, 1, 1);
+        REQUIRE(s.lu().singular());
+        REQUIRE(s.determinant() == 0);
+        REQUIRE_THROWS_AS(s.inverse(), std::domain_error);
+    }
+}
+
+TEST_CASE("MatrixND row and column views", "[MatrixND][view]") {
+    MatrixND<double> m(3, 5);
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 5; j++) {
+            m.set(i, j, 10.0 * i + j);
+        }
+    }
+
+    VectorDataView<double> col = m.colView(3);
+    REQUIRE(col.length() == 3);
+    REQUIRE(col.stride() == m.ld());
+    REQUIRE(col.get(2) == 23);
+    REQUIRE(col.sum() == 3 + 13 + 23);
+    REQUIRE(m.rowView(1).dot(m.rowView(2)) == Catch::Approx(10 * 20 + 11 * 21 + 12 * 22 + 13 * 23 + 14 * 24));
+
+    // Writes through a view land in the matrix without any copy.
+    col.assign(col * 2.0);
+    REQUIRE(m.get(1, 3) == 26);
+    m.rowView(0).set(4, -1);
+    REQUIRE(m.get(0, 4) == -1);
+
+    const MatrixND<double>& cm = m;
+    VectorDataView<const double> ccol = cm.colView(0);
+    std::vector<double> column(ccol.begin(), ccol.end());
+    REQUIRE(column == std::vector<double>{0, 10, 20});
+    REQUIRE(cm.transpose().rowView(0).dot(ccol) == Catch::Approx(0 + 100 + 400));
+}
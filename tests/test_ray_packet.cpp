@@ -0,0 +1,109 @@
+#include "catch_amalgamated.hpp"
+#include "ray_packet.hpp"
+#include "scene.hpp"
+#include <random>
+
+
+TEST_CASE("Packet box test matches the single-ray box test", "[ray_packet]") {
+    std::mt19937 rng(20);
+    std::uniform_real_distribution<float> coord(-4, 4);
+    std::uniform_int_distribution<int> pick(0, 3);
+
+    for (int round = 0; round < 200; round++) {
+        float a[3] = {coord(rng), coord(rng), coord(rng)};
+        float b[3] = {coord(rng), coord(rng), coord(rng)};
+        AABB box(std::min(a[0], b[0]), std::min(a[1], b[1]), std::min(a[2], b[2]),
+                 std::max(a[0], b[0]), std::max(a[1], b[1]), std::max(a[2], b[2]));
+
+        RayPacket packet;
+        float bestDistSq[RayPacket::kMaxRays];
+        int count = 1 + round % RayPacket::kMaxRays;
+        for (int i = 0; i < count; i++) {
+            // Snap some coordinates onto the slab planes and zero some direction
+            // components, which is where the NaN handling matters.
+            float o[3], d[3];
+            for (int axis = 0; axis < 3; axis++) {
+                int kind = pick(rng);
+                o[axis] = kind == 0 ? box.min[axis] : kind == 1 ? box.max[axis] : coord(rng);
+                d[axis] = pick(rng) == 0 ? 0.0f : coord(rng);
+            }
+            packet.add(Ray{Vector3D(o[0], o[1], o[2]), Vector3D(d[0], d[1], d[2])});
+            bestDistSq[i] = pick(rng) == 0 ? std::numeric_limits<float>::infinity() : coord(rng) * coord(rng);
+        }
+
+        std::uint64_t mask = packet.all() & ~(std::uint64_t(round) * 0x9E3779B97F4A7C15ull >> 7);
+        std::uint64_t expected = 0;
+        for (int i = 0; i < count; i++) {
+            if (!(mask >> i & 1)) continue;
+            const float origin[3] = {packet.ox[i], packet.oy[i], packet.oz[i]};
+            const float invDir[3] = {1.0f / packet.dx[i], 1.0f / packet.dy[i], 1.0f / packet.dz[i]};
+            constexpr float inf = std::numeric_limits<float>::infinity();
+            if (box.distanceSquared(origin) > bestDistSq[i] || !box.intersects(origin, invDir, -inf, inf)) continue;
+            expected |= std::uint64_t(1) << i;
+        }
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2}) {
+            CAPTURE(round, simdLevelName(level));
+            REQUIRE(ray_packet::boxMask(box, packet, bestDistSq, mask, level) == expected);
+        }
+    }
+
+    RayPacket full;
+    for (int i = 0; i < RayPacket::kMaxRays; i++) full.add(Ray{Vector3D(0, 0, 0), Vector3D(1, 0, 0)});
+    REQUIRE(full.all() == ~std::uint64_t(0));
+    REQUIRE_THROWS_AS(full.add(Ray{}), std::length_error);
+}
+
+TEST_CASE("Scene packet intersect matches single rays", "[ray_packet]") {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> coord(-30, 30);
+    std::uniform_real_distribution<float> radius(1, 10);
+
+    Scene scene;
+    for (int i = 0; i < 500; i++) {
+        scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+    }
+
+    auto check = [&](const RayPacket& packet) {
+        std::optional<HitInfo> hits[RayPacket::kMaxRays];
+        scene.intersect(packet, hits);
+        int found = 0;
+        for (int i = 0; i < packet.count; i++) {
+            std::optional<HitInfo> expected = scene.intersect(packet.ray(i));
+            REQUIRE(hits[i].has_value() == expected.has_value());
+            if (!expected) continue;
+            found++;
+            REQUIRE(hits[i]->objectId == expected->objectId);
+            REQUIRE(hits[i]->t == expected->t);
+            REQUIRE(hits[i]->point.x() == expected->point.x());
+        }
+        return found;
+    };
+
+    for (bool bvh : {false, true}) {
+        if (bvh) scene.buildBVH();
+        int found = 0;
+        for (int round = 0; round < 40; round++) {
+            // Coherent: an 8 x 8 grid of origins sharing one direction, like
+            // the primary rays of a block of pixels.
+            RayPacket coherent;
+            Vector3D corner(coord(rng), coord(rng), coord(rng));
+            Vector3D dir = Vector3D(coord(rng), coord(rng), coord(rng)).normalize();
+            float spacing = round % 2 == 0 ? 0.05f : 2.0f;
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 8; x++) {
+                    coherent.add(Ray{corner + Vector3D(x * spacing, y * spacing, 0), dir});
+                }
+            }
+            found += check(coherent);
+
+            // Incoherent and partial packets fall apart into single rays.
+            RayPacket scattered;
+            for (int i = 0; i < 1 + round; i++) {
+                scattered.add(Ray{Vector3D(coord(rng), coord(rng), coord(rng)),
+                                  Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+            }
+            found += check(scattered);
+        }
+        REQUIRE(found > 500);
+    }
+}
@@ -0,0 +1,189 @@
+#include "catch_amalgamated.hpp"
+#include "renderer.hpp"
+#include <numbers>
+
+
+namespace {
+
+// Reports every ray as hitting it one unit behind its origin.
+class BehindObject : public SceneObject {
+public:
+    BehindObject() : SceneObject(0, 0, 0, 1, 1, 1, 1) {}
+    AABB bounds() const override { return AABB(-1e6f, -1e6f, -1e6f, 1e6f, 1e6f, 1e6f); }
+    std::optional<HitInfo> intersect(const Vector3D& origin, const Vector3D& direction) const override {
+        HitInfo hit;
+        hit.t = -1;
+        hit.point = origin - direction;
+        return hit;
+    }
+};
+
+Scene makeScene() {
+    Scene scene;
+    scene.addObject(std::make_unique<SphereSceneObject>(0.1, 1, 0, 1, 1, 1, 1, 2));
+    scene.setCamera(std::make_unique<Camera>(-4, 1, 0, 0, 0.2, 0.1, 4));
+    scene.addLight(std::make_unique<Light>(0, 15, 0, 1, 1, 1, 23));
+    return scene;
+}
+
+}
+
+
+TEST_CASE("Tiled renderer matches the serial pixel loop", "[renderer]") {
+    Scene scene = makeScene();
+
+    RenderSettings settings;
+    settings.height = 14;
+    settings.width = 11;
+    settings.tileSize = 4; // Leaves partial tiles on both edges
+
+    std::vector<std::uint8_t> serial;
+    for (int i = 0; i < settings.height; i++) {
+        for (int j = 0; j < settings.width; j++) {
+            auto color = shadePixel(scene, settings.height, settings.width, i, j);
+            serial.insert(serial.end(), color.begin(), color.end());
+        }
+    }
+
+    for (std::size_t threads : {1, 2, 3, 8}) {
+        settings.threads = threads;
+        Renderer renderer(settings);
+        REQUIRE(renderer.threads() == threads);
+
+        Framebuffer frame;
+        renderer.render(scene, frame);
+        REQUIRE(frame.width() == settings.width);
+        REQUIRE(frame.height() == settings.height);
+        std::vector<std::uint8_t> pixels;
+        for (int i = 0; i < settings.height; i++) {
+            pixels.insert(pixels.end(), frame.row(i), frame.row(i) + settings.width * 3);
+        }
+        REQUIRE(pixels == serial);
+    }
+}
+
+TEST_CASE("Renderer fills a float framebuffer", "[renderer]") {
+    Scene scene = makeScene();
+    RenderSettings settings;
+    settings.height = 9;
+    settings.width = 13;
+    settings.threads = 2;
+    Renderer renderer(settings);
+
+    Framebuffer bytes;
+    Framebuffer floats(1, 1, PixelFormat::RGBA32F);
+    renderer.render(scene, bytes);
+    renderer.render(scene, floats);
+    REQUIRE(floats.format() == PixelFormat::RGBA32F);
+    for (int i = 0; i < settings.height; i++) {
+        for (int j = 0; j < settings.width; j++) {
+            REQUIRE(floats.pixelRGB8(j, i) == bytes.pixelRGB8(j, i));
+            REQUIRE(floats.pixelRGBA32F(j, i)[3] == 1.0f);
+        }
+    }
+}
+
+TEST_CASE("Packet tracing renders the same image as single rays", "[renderer]") {
+    Scene scene = makeScene();
+    for (int i = 0; i < 200; i++) {
+        float x = -2.5f + (i % 20) * 0.25f, y = -1.5f + (i / 20) * 0.3f;
+        scene.addObject(std::make_unique<SphereSceneObject>(x, y, 0.3f * (i % 3), 1, 1, 1, 1, 0.2f + 0.05f * (i % 7)));
+    }
+    scene.addAnalyticLight(AnalyticLight::sphere(Vector3D(0, 6, -3), 1.5f, 1, 0.8f, 0.6f, 200));
+    scene.addAnalyticLight(AnalyticLight::directional(Vector3D(0.3f, -1, 0.2f), 0.2f, 0.2f, 0.3f, 1));
+    scene.buildBVH();
+
+    RenderSettings settings;
+    settings.height = 37;
+    settings.width = 29;
+    settings.tileSize = 12; // Partial packets inside and at the edge of tiles
+    settings.threads = 2;
+
+    settings.packetSize = 1;
+    Framebuffer expected;
+    Renderer(settings).render(scene, expected);
+    int lit = 0;
+    for (int i = 0; i < settings.height; i++) {
+        for (int j = 0; j < settings.width; j++) lit += expected.pixelRGB8(j, i)[1] != 0;
+    }
+    REQUIRE(lit > 0);
+
+    for (int packetSize : {2, 4, 8, 64}) {
+        CAPTURE(packetSize);
+        settings.packetSize = packetSize;
+        Framebuffer frame;
+        Renderer(settings).render(scene, frame);
+        for (int i = 0; i < settings.height; i++) {
+            REQUIRE(std::equal(frame.row(i), frame.row(i) + settings.width * 3, expected.row(i)));
+        }
+    }
+}
+
+TEST_CASE("Legacy lights keep their original yes/no shading", "[renderer]") {
+    // A Light counts whenever the bounce ray reaches it, with or without
+    // objects in the way, as the renderer has always drawn it.
+    Scene scene;
+    scene.addObject(std::make_unique<SphereSceneObject>(0, -1, 0, 1, 1, 1, 1, 1));
+    scene.addLight(std::make_unique<Light>(0, 0, 0, 1, 1, 1, 5));
+    HitInfo hit;
+    hit.point = Vector3D(0, 0, 0);
+    hit.normal = Vector3D(0, 1, 0);
+    hit.bounceDir = Vector3D(1, 0, 0);
+    hit.objectId = 0;
+    const std::array<std::uint8_t, 3> lit = {125, 255, 0};
+    REQUIRE(shadeHit(scene, hit, 0, 0) == lit);
+    REQUIRE(shadeHit(scene, std::nullopt, 0, 0) == std::array<std::uint8_t, 3>{0, 0, 0});
+
+    scene.addObject(std::make_unique<SphereSceneObject>(2, 0, 0, 1, 1, 1, 1, 1));
+    scene.addObject(std::make_unique<SphereSceneObject>(-2, 0, 0, 1, 1, 1, 1, 1));
+    REQUIRE(shadeHit(scene, hit, 0, 0) == lit);
+    scene.buildBVH();
+    REQUIRE(shadeHit(scene, hit, 0, 0) == lit);
+
+    // Far from the light the bounce ray misses it.
+    hit.point = Vector3D(0, 20, 0);
+    REQUIRE(shadeHit(scene, hit, 0, 0) == std::array<std::uint8_t, 3>{0, 0, 0});
+}
+
+TEST_CASE("Analytic lights shade hits with one shadow ray each", "[renderer]") {
+    Scene scene;
+    scene.addObject(std::make_unique<SphereSceneObject>(0, -1, 0, 0.5f, 1, 0.25f, 1, 1));
+    HitInfo hit;
+    hit.point = Vector3D(0, 0, 0);
+    hit.normal = Vector3D(0, 1, 0);
+    hit.bounceDir = Vector3D(1, 0, 0);
+    hit.objectId = 0;
+    REQUIRE(shadeHit(scene, hit, 0, 0) == std::array<std::uint8_t, 3>{0, 0, 0});
+
+    // Irradiance 100 / 5^2, times albedo / pi.
+    scene.addAnalyticLight(AnalyticLight::point(Vector3D(0, 5, 0), 1, 1, 1, 100));
+    auto lit = shadeHit(scene, hit, 0, 0);
+    REQUIRE(lit[0] == static_cast<std::uint8_t>(255 * 0.5f * 4 / std::numbers::pi_v<float>));
+    REQUIRE(lit[1] == 255);
+    REQUIRE(lit[2] == static_cast<std::uint8_t>(255 * 0.25f * 4 / std::numbers::pi_v<float>));
+
+    // Lights below the surface add nothing.
+    scene.addAnalyticLight(AnalyticLight::directional(Vector3D(0, 1, 0), 1, 1, 1, 100));
+    REQUIRE(shadeHit(scene, hit, 3, 4) == lit);
+
+    // Blockers behind the shading point cast no shadow: an object hit at
+    // t = -1, and a sphere around both the point and the light whose near
+    // side is behind the point.
+    scene.addObject(std::make_unique<BehindObject>());
+    scene.addObject(std::make_unique<SphereSceneObject>(0, 4, 0, 1, 1, 1, 1, 5));
+    REQUIRE(shadeHit(scene, hit, 0, 0) == lit);
+    scene.buildBVH();
+    REQUIRE(shadeHit(scene, hit, 0, 0) == lit);
+
+    // One between the point and the light does.
+    Scene blocked;
+    blocked.addObject(std::make_unique<SphereSceneObject>(0, -1, 0, 0.5f, 1, 0.25f, 1, 1));
+    blocked.addAnalyticLight(AnalyticLight::point(Vector3D(0, 5, 0), 1, 1, 1, 100));
+    blocked.addObject(std::make_unique<SphereSceneObject>(0.2f, 2.5f, 0, 1, 1, 1, 1, 0.5f));
+    REQUIRE(shadeHit(blocked, hit, 0, 0) == std::array<std::uint8_t, 3>{0, 0, 0});
+
+    // A sphere around the shadow ray's start blocks it.
+    scene.addObject(std::make_unique<SphereSceneObject>(0, 2, 0, 1, 1, 1, 1, 2.5f));
+    scene.buildBVH();
+    REQUIRE(shadeHit(scene, hit, 0, 0) == std::array<std::uint8_t, 3>{0, 0, 0});
+}
@@ -0,0 +1,220 @@
+#include "catch_amalgamated.hpp"
+#include "scene_cache.hpp"
+#include "scene_file.hpp"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+
+namespace {
+
+std::string cachePath(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+Scene randomScene(int count) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> coord(-10, 10);
+    std::uniform_real_distribution<float> radius(0.5, 3);
+    Scene scene;
+    for (int i = 0; i < count; i++) {
+        scene.addObject(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 0.1f * (i % 10), 0.5f,
+                                                            1, 1, radius(rng)));
+    }
+    scene.addLight(std::make_unique<Light>(0, 15, 0, 1, 0.5f, 0.25f, 23));
+    scene.addAnalyticLight(AnalyticLight::directional(Vector3D(1, -3, 0.5f), 1, 1, 1, 0.8f));
+    scene.addAnalyticLight(AnalyticLight::sphere(Vector3D(0, 12, 0), 2, 1, 0.9f, 0.8f, 60));
+    scene.setCamera(std::make_unique<Camera>(-4, 1, 0, 0, 0.2f, 0.1f, 4));
+    scene.buildBVH();
+    return scene;
+}
+
+void patch(const std::string& path, std::size_t offset, const void* bytes, std::size_t size) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(static_cast<const char*>(bytes), size);
+}
+
+}
+
+
+TEST_CASE("Scene cache maps the scene it was written from", "[scenecache]") {
+    Scene scene = randomScene(200);
+    RenderSettings settings;
+    settings.width = 320;
+    settings.height = 200;
+    settings.tileSize = 8;
+    std::string path = cachePath("raytrace_test.rtcache");
+    writeSceneCache(path, scene, settings);
+
+    SceneCache cache(path);
+    cache.verify();
+    REQUIRE(cache.spheres().size() == 200);
+    REQUIRE(cache.lights().size() == 1);
+    REQUIRE(cache.nodes().size() == scene.bvh().nodes().size());
+    REQUIRE(std::memcmp(cache.nodes().data(), scene.bvh().nodes().data(), cache.nodes().size_bytes()) == 0);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(cache.nodes().data()) % scene_cache::kSectionAlignment == 0);
+    REQUIRE(cache.settings().width == 320);
+    REQUIRE(cache.settings().tileSize == 8);
+    REQUIRE(cache.hasCamera());
+    REQUIRE(cache.camera().orientation().y() == 0.2f);
+    REQUIRE(cache.spheres()[7].color[0] == scene.objects()[7]->color().get(0));
+    REQUIRE(cache.lights()[0].color[2] == 0.25f);
+    REQUIRE(std::vector<AnalyticLight>(cache.analyticLights().begin(), cache.analyticLights().end()) ==
+            scene.analyticLights());
+
+    // In-place tracing gives exactly the Scene's answers.
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> coord(-12, 12);
+    int hits = 0;
+    for (int i = 0; i < 500; i++) {
+        Ray ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()};
+        std::optional<HitInfo> expected = scene.intersect(ray);
+        std::optional<HitInfo> actual = cache.intersect(ray);
+        REQUIRE(expected.has_value() == actual.has_value());
+        if (!expected) continue;
+        hits++;
+        REQUIRE(actual->objectId == expected->objectId);
+        REQUIRE(actual->t == expected->t);
+    }
+    REQUIRE(hits > 50);
+
+    // The cached BVH is installed as is.
+    SceneCache moved = std::move(cache);
+    Scene loaded;
+    moved.toScene(loaded);
+    REQUIRE(loaded.objects().size() == 200);
+    REQUIRE(loaded.bvh().indices() == scene.bvh().indices());
+    REQUIRE(loaded.cam()->position().x() == -4);
+    REQUIRE(loaded.analyticLights() == scene.analyticLights());
+    REQUIRE(sceneToString(loaded, settings) == sceneToString(scene, settings));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Scene cache without objects or camera", "[scenecache]") {
+    Scene scene;
+    std::string path = cachePath("raytrace_empty.rtcache");
+    writeSceneCache(path, scene, RenderSettings());
+    SceneCache cache(path);
+    cache.verify();
+    REQUIRE(cache.spheres().empty());
+    REQUIRE_FALSE(cache.hasCamera());
+    REQUIRE_FALSE(cache.intersect(Ray{Vector3D(0, 0, 0), Vector3D(1, 0, 0)}).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Scene cache rejects foreign and damaged files", "[scenecache]") {
+    Scene scene = randomScene(20);
+    std::string path = cachePath("raytrace_bad.rtcache");
+
+    REQUIRE_THROWS_AS(SceneCache(cachePath("raytrace_missing.rtcache")), std::runtime_error);
+
+    writeSceneCache(path, scene, RenderSettings());
+    patch(path, 0, "XX", 2);
+    REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("bad magic"));
+
+    writeSceneCache(path, scene, RenderSettings());
+    std::uint32_t version = scene_cache::kVersion + 1;
+    patch(path, offsetof(scene_cache::Header, version), &version, sizeof(version));
+    REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("version"));
+
+    writeSceneCache(path, scene, RenderSettings());
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("truncated"));
+
+    writeSceneCache(path, scene, RenderSettings());
+    std::uint64_t count = 1u << 30;
+    patch(path, offsetof(scene_cache::Header, nodes) + offsetof(scene_cache::Section, count), &count, sizeof(count));
+    REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("node section"));
+
+    // Render settings a scene file could not hold.
+    for (std::int32_t size : {0, -64, kMaxImageSize + 1}) {
+        writeSceneCache(path, scene, RenderSettings());
+        patch(path, offsetof(scene_cache::Header, width), &size, sizeof(size));
+        REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("render size"));
+    }
+    writeSceneCache(path, scene, RenderSettings());
+    std::int32_t tileSize = 0;
+    patch(path, offsetof(scene_cache::Header, tileSize), &tileSize, sizeof(tileSize));
+    REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("render size"));
+    writeSceneCache(path, scene, RenderSettings());
+    std::uint32_t threads = 100'000'000;
+    patch(path, offsetof(scene_cache::Header, threads), &threads, sizeof(threads));
+    REQUIRE_THROWS_WITH(SceneCache(path), Catch::Matchers::ContainsSubstring("thread count"));
+
+    writeSceneCache(path, scene, RenderSettings());
+    scene_cache::Header header;
+    std::ifstream(path, std::ios::binary).read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::uint32_t badIndex = 1000;
+    patch(path, header.indices.offset, &badIndex, sizeof(badIndex));
+    SceneCache damaged(path); // only verify() walks the tree
+    REQUIRE_THROWS_WITH(damaged.verify(), Catch::Matchers::ContainsSubstring("index out of range"));
+
+    writeSceneCache(path, scene, RenderSettings());
+    std::uint32_t badType = 7;
+    patch(path, header.analyticLights.offset + offsetof(AnalyticLight, type), &badType, sizeof(badType));
+    REQUIRE_THROWS_WITH(SceneCache(path).verify(), Catch::Matchers::ContainsSubstring("unknown light type"));
+
+    // Trees the traversals could loop in or overflow their stacks on.
+    auto patchNode = [&](std::size_t node, std::uint32_t leftFirst) {
+        writeSceneCache(path, scene, RenderSettings());
+        patch(path, header.nodes.offset + node * sizeof(BVH::Node) + offsetof(BVH::Node, leftFirst), &leftFirst,
+              sizeof(leftFirst));
+        return SceneCache(path);
+    };
+    REQUIRE(!scene.bvh().nodes()[0].isLeaf());
+    std::uint32_t rootChildren = scene.bvh().nodes()[0].leftFirst;
+    REQUIRE_THROWS_WITH(patchNode(0, 0).verify(), Catch::Matchers::ContainsSubstring("node out of range"));
+    std::size_t inner = rootChildren;
+    if (scene.bvh().nodes()[inner].isLeaf()) inner++;
+    REQUIRE(!scene.bvh().nodes()[inner].isLeaf());
+    // Children before their parent could form a cycle.
+    REQUIRE_THROWS_WITH(patchNode(inner, rootChildren).verify(), Catch::Matchers::ContainsSubstring("BVH node"));
+    Scene loaded;
+    REQUIRE_THROWS_AS(patchNode(inner, rootChildren).toScene(loaded), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Scene cache rejects trees deeper than the traversal stack", "[scenecache]") {
+    // A chain: every inner node has one leaf and one inner child.
+    const std::uint32_t leaves = BVH::kMaxDepth + 2;
+    Scene scene;
+    std::vector<BVH::Node> nodes;
+    std::vector<std::uint32_t> indices;
+    for (std::uint32_t i = 0; i < leaves; i++) {
+        scene.addObject(std::make_unique<SphereSceneObject>(float(i), 0, 0, 1, 1, 1, 1, 0.5f));
+        indices.push_back(i);
+    }
+    for (std::uint32_t i = 0; i + 1 < leaves; i++) {
+        BVH::Node inner;
+        inner.bounds = AABB(float(i) - 0.5f, -0.5f, -0.5f, float(leaves) - 0.5f, 0.5f, 0.5f);
+        inner.leftFirst = static_cast<std::uint32_t>(nodes.size()) + 1;
+        nodes.push_back(inner);
+        BVH::Node leaf;
+        leaf.bounds = scene.objects()[i]->bounds();
+        leaf.leftFirst = i;
+        leaf.count = 1;
+        nodes.push_back(leaf);
+    }
+    BVH::Node last;
+    last.bounds = scene.objects()[leaves - 1]->bounds();
+    last.leftFirst = leaves - 1;
+    last.count = 1;
+    nodes.push_back(last);
+    scene.setBVH(BVH(nodes, indices));
+
+    std::string path = cachePath("raytrace_deep.rtcache");
+    writeSceneCache(path, scene, RenderSettings());
+    REQUIRE_THROWS_WITH(SceneCache(path).verify(), Catch::Matchers::ContainsSubstring("deeper than"));
+    std::filesystem::remove(path);
+
+    std::vector<std::uint32_t> outOfRange = indices;
+    outOfRange[3] = leaves;
+    REQUIRE_THROWS_AS(scene.setBVH(BVH(nodes, outOfRange)), std::invalid_argument);
+    std::vector<std::uint32_t> repeated = indices;
+    repeated[3] = repeated[4];
+    REQUIRE_THROWS_WITH(scene.setBVH(BVH(nodes, repeated)), Catch::Matchers::ContainsSubstring("repeated"));
+}
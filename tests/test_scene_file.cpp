@@ -0,0 +1,126 @@
+#include "catch_amalgamated.hpp"
+#include "scene_file.hpp"
+#include <filesystem>
+#include <stdexcept>
+
+
+namespace {
+
+const char* kScene = R"(# demo scene
+render 64 48 8 2
+camera -4 1 0 0 0.2 0.1 4   # looking down x
+light 0 15 0 1 1 1 23
+pointlight 1 2 3 1 0.5 0.5 40
+dirlight 0 -2 0 1 1 1 0.5
+spherelight 0 8 0 1 1 0.75 30 1.5
+
+sphere 0.1 1 0 1 0.5 0.25 1 2
+	sphere -1e2 2.5 3 0 0 0 0.5 .75
+)";
+
+}
+
+
+TEST_CASE("Scene file records fill Scene and RenderSettings", "[scenefile]") {
+    Scene scene;
+    RenderSettings settings;
+    SceneFileStats stats = loadSceneFromString(kScene, scene, settings);
+
+    REQUIRE(stats.lines == 10);
+    REQUIRE(stats.objects == 2);
+    REQUIRE(stats.lights == 4);
+    REQUIRE(settings.width == 64);
+    REQUIRE(settings.height == 48);
+    REQUIRE(settings.tileSize == 8);
+    REQUIRE(settings.threads == 2);
+
+    REQUIRE(scene.cam()->position().x() == -4);
+    REQUIRE(scene.cam()->orientation().y() == 0.2f);
+    REQUIRE(scene.cam()->sizeOfLens() == 4);
+    REQUIRE(scene.lights()[0]->radius() == 23);
+    const std::vector<AnalyticLight>& lights = scene.analyticLights();
+    REQUIRE(lights.size() == 3);
+    REQUIRE(lights[0] == AnalyticLight::point(Vector3D(1, 2, 3), 1, 0.5f, 0.5f, 40));
+    REQUIRE(lights[1].type == LightType::Directional);
+    REQUIRE(lights[1].direction[1] == -1);
+    REQUIRE(lights[2] == AnalyticLight::sphere(Vector3D(0, 8, 0), 1.5f, 1, 1, 0.75f, 30));
+    REQUIRE(scene.objects().size() == 2);
+    REQUIRE(scene.objects()[0]->color().get(2) == 0.25f);
+    REQUIRE(scene.objects()[1]->position().x() == -100);
+    REQUIRE(scene.objects()[1]->color().get(3) == 0.5f);
+    REQUIRE(scene.objects()[1]->radius() == 0.75f);
+}
+
+TEST_CASE("Scene parser handles lines split across chunks", "[scenefile]") {
+    const std::string text = kScene;
+    for (std::size_t chunk : {1, 2, 7, 64}) {
+        Scene scene;
+        RenderSettings settings;
+        SceneParser parser(scene, settings);
+        for (std::size_t pos = 0; pos < text.size(); pos += chunk) {
+            parser.feed(text.data() + pos, std::min(chunk, text.size() - pos));
+        }
+        parser.finish();
+        REQUIRE(parser.stats().bytes == text.size());
+        REQUIRE(scene.objects().size() == 2);
+        REQUIRE(scene.objects()[1]->radius() == 0.75f);
+        REQUIRE(settings.width == 64);
+    }
+
+    // No trailing newline.
+    Scene scene;
+    RenderSettings settings;
+    loadSceneFromString("sphere 1 2 3 1 1 1 1 4", scene, settings);
+    REQUIRE(scene.objects().size() == 1);
+}
+
+TEST_CASE("Scene parser rejects malformed records", "[scenefile]") {
+    Scene scene;
+    RenderSettings settings;
+    REQUIRE_THROWS_WITH(loadSceneFromString("render 1 1\ncube 1 2 3\n", scene, settings),
+                        Catch::Matchers::ContainsSubstring("line 2: unknown record"));
+    REQUIRE_THROWS_AS(loadSceneFromString("sphere 1 2 3 1 1 1 1\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_AS(loadSceneFromString("sphere 1 2 3 1 1 1 1 2 9\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_AS(loadSceneFromString("light 1 2 3x 1 1 1 1\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_AS(loadSceneFromString("pointlight 1 2 3 1 1 1\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_WITH(loadSceneFromString("dirlight 0 0 0 1 1 1 1\n", scene, settings),
+                        Catch::Matchers::ContainsSubstring("non-zero direction"));
+    REQUIRE_THROWS_WITH(loadSceneFromString("render 1 1\ndirlight 1e-30 0 0 1 1 1 1\n", scene, settings),
+                        Catch::Matchers::ContainsSubstring("line 2: dirlight needs a non-zero direction"));
+    REQUIRE_THROWS_WITH(loadSceneFromString("spherelight 0 0 0 1 1 1 1 0\n", scene, settings),
+                        Catch::Matchers::ContainsSubstring("positive radius"));
+    REQUIRE_THROWS_AS(loadSceneFromString("render 0 10\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_AS(loadSceneFromString("render 10 10 4 -1\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_AS(loadSceneFromString(std::string(SceneParser::kMaxLineLength + 1, ' '), scene, settings),
+                      std::runtime_error);
+    REQUIRE(settings.width == 1);
+    REQUIRE_THROWS_WITH(loadSceneFromString("render 64 64 16 100000000\n", scene, settings),
+                        Catch::Matchers::ContainsSubstring("line 1: bad thread count"));
+    REQUIRE_THROWS_WITH(loadSceneFromString("render 64 64 0\n", scene, settings),
+                        Catch::Matchers::ContainsSubstring("line 1: bad tile size"));
+    REQUIRE_THROWS_AS(loadSceneFromString("render 64 64 -8\n", scene, settings), std::runtime_error);
+    REQUIRE_THROWS_AS(loadSceneFromString("render 70000 64\n", scene, settings), std::runtime_error);
+    REQUIRE_NOTHROW(loadSceneFromString("render 64 64 16 4096\n", scene, settings));
+    REQUIRE(settings.threads == 4096);
+    REQUIRE_THROWS_AS(loadScene("/nonexistent/scene.txt", scene, settings), std::runtime_error);
+}
+
+TEST_CASE("Saved scenes load back identically", "[scenefile]") {
+    Scene scene;
+    RenderSettings settings;
+    loadSceneFromString(kScene, scene, settings);
+    scene.addObject(std::make_unique<SphereSceneObject>(1.0f / 3, 0.1f, 1e-7f, 0.2f, 0.3f, 0.4f, 0.9f, 12345.678f));
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "raytrace_roundtrip.scene";
+    saveScene(path.string(), scene, settings);
+
+    Scene loaded;
+    RenderSettings loadedSettings;
+    loadScene(path.string(), loaded, loadedSettings);
+    std::filesystem::remove(path);
+
+    REQUIRE(sceneToString(loaded, loadedSettings) == sceneToString(scene, settings));
+    REQUIRE(loaded.objects()[2]->position().x() == 1.0f / 3);
+    REQUIRE(loaded.objects()[2]->radius() == 12345.678f);
+    REQUIRE(loaded.analyticLights() == scene.analyticLights());
+}
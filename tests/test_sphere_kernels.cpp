@@ -0,0 +1,218 @@
+#include "catch_amalgamated.hpp"
+#include "scene.hpp"
+#include "sphere_kernels.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+
+
+namespace {
+
+std::vector<SimdLevel> availableLevels() {
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level <= detectSimdLevel()) levels.push_back(level);
+    }
+    return levels;
+}
+
+struct SphereColumns {
+    std::vector<float> cx, cy, cz, radius;
+    std::vector<std::uint32_t> id;
+
+    SphereArrays arrays() const { return {cx.data(), cy.data(), cz.data(), radius.data(), id.data()}; }
+};
+
+// The reference: sphereHitDistance() one sphere at a time.
+std::optional<PrimitiveHit> scalarNearest(const SphereColumns& s, std::uint32_t first, std::uint32_t last,
+                                          const Ray& ray) {
+    std::optional<PrimitiveHit> best;
+    for (std::uint32_t i = first; i < last; i++) {
+        PrimitiveHit hit{s.id[i]};
+        if (!sphereHitDistance(Vector3D(s.cx[i], s.cy[i], s.cz[i]), s.radius[i], ray.origin, ray.direction, hit.t)) {
+            continue;
+        }
+        if (!best || hit.closerThan(*best)) best = hit;
+    }
+    return best;
+}
+
+}
+
+
+TEST_CASE("Sphere kernels match the scalar sphere test at every SIMD level", "[sphere_kernels]") {
+    std::mt19937 rng(19);
+    std::uniform_real_distribution<float> coord(-6, 6);
+    std::uniform_real_distribution<float> radius(0.5, 8);
+
+    // Large spheres around the origin, so most rays start inside several of
+    // them; every third sphere repeats an earlier one to produce exact ties.
+    SphereColumns s;
+    for (std::uint32_t i = 0; i < 61; i++) {
+        if (i % 3 == 2) {
+            std::uint32_t src = i / 2;
+            s.cx.push_back(s.cx[src]);
+            s.cy.push_back(s.cy[src]);
+            s.cz.push_back(s.cz[src]);
+            s.radius.push_back(s.radius[src]);
+        } else {
+            s.cx.push_back(coord(rng));
+            s.cy.push_back(coord(rng));
+            s.cz.push_back(coord(rng));
+            s.radius.push_back(radius(rng));
+        }
+        s.id.push_back(i);
+    }
+    // Ids in arbitrary order, as in a BVH leaf-ordered copy.
+    std::shuffle(s.id.begin(), s.id.end(), rng);
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 40; i++) {
+        rays.push_back(Ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()});
+    }
+
+    int hits = 0;
+    for (std::uint32_t first : {0u, 1u, 3u, 8u}) {
+        for (std::uint32_t last = first; last <= s.id.size(); last++) {
+            for (const Ray& ray : rays) {
+                std::optional<PrimitiveHit> expected = scalarNearest(s, first, last, ray);
+                hits += expected.has_value();
+                for (SimdLevel level : availableLevels()) {
+                    CAPTURE(first, last, simdLevelName(level));
+                    std::optional<PrimitiveHit> best;
+                    sphere_kernels::nearest(s.arrays(), first, last, ray, best, level);
+                    REQUIRE(best.has_value() == expected.has_value());
+                    if (!expected) continue;
+                    REQUIRE(best->index == expected->index);
+                    REQUIRE(best->t == expected->t);
+                }
+            }
+        }
+    }
+    REQUIRE(hits > 1000);
+
+    SECTION("an existing best is only replaced by a closer hit") {
+        const Ray& ray = rays[0];
+        std::optional<PrimitiveHit> expected = scalarNearest(s, 0, 61, ray);
+        REQUIRE(expected.has_value());
+        for (SimdLevel level : availableLevels()) {
+            std::optional<PrimitiveHit> best = PrimitiveHit{1000, 0.0f};
+            sphere_kernels::nearest(s.arrays(), 0, 61, ray, best, level);
+            REQUIRE(best->index == 1000);
+
+            best = PrimitiveHit{1000, std::abs(expected->t)};
+            sphere_kernels::nearest(s.arrays(), 0, 61, ray, best, level);
+            REQUIRE(best->index == expected->index);
+        }
+    }
+
+    SECTION("NaN radii never hit") {
+        std::fill(s.radius.begin(), s.radius.end(), std::numeric_limits<float>::quiet_NaN());
+        for (SimdLevel level : availableLevels()) {
+            std::optional<PrimitiveHit> best;
+            sphere_kernels::nearest(s.arrays(), 0, 61, rays[0], best, level);
+            REQUIRE_FALSE(best.has_value());
+        }
+    }
+}
+
+TEST_CASE("Any-hit kernel matches the scalar crossing test at every SIMD level", "[sphere_kernels]") {
+    std::mt19937 rng(24);
+    std::uniform_real_distribution<float> coord(-6, 6);
+    std::uniform_real_distribution<float> radius(0.5, 8);
+    SphereColumns s;
+    for (std::uint32_t i = 0; i < 37; i++) {
+        s.cx.push_back(coord(rng));
+        s.cy.push_back(coord(rng));
+        s.cz.push_back(coord(rng));
+        s.radius.push_back(i % 5 == 4 ? std::numeric_limits<float>::quiet_NaN() : radius(rng));
+        s.id.push_back(i);
+    }
+    std::shuffle(s.id.begin(), s.id.end(), rng);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    int blocked = 0, clear = 0;
+    for (int r = 0; r < 40; r++) {
+        Ray ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()};
+        for (std::uint32_t first : {0u, 3u}) {
+            for (std::uint32_t last = first; last <= s.id.size(); last++) {
+                // Whole line, forward only, and a window that starts past the origin.
+                const float ranges[][2] = {{-inf, inf}, {0, 0.5f}, {0, 4}, {0, inf}, {2, 6}};
+                for (const auto& range : ranges) {
+                    for (std::uint32_t ignore : {HitInfo::kNoObject, s.id[first]}) {
+                        bool expected = false;
+                        for (std::uint32_t i = first; i < last; i++) {
+                            float tNear, tFar;
+                            if (s.id[i] != ignore &&
+                                sphereCrossings(Vector3D(s.cx[i], s.cy[i], s.cz[i]), s.radius[i], ray.origin,
+                                                ray.direction, tNear, tFar) &&
+                                ((tNear > range[0] && tNear < range[1]) || (tFar > range[0] && tFar < range[1]))) {
+                                expected = true;
+                            }
+                        }
+                        (expected ? blocked : clear)++;
+                        for (SimdLevel level : availableLevels()) {
+                            CAPTURE(first, last, range[0], range[1], ignore, simdLevelName(level));
+                            REQUIRE(sphere_kernels::any(s.arrays(), first, last, ray, range[0], range[1], ignore,
+                                                        level) == expected);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    REQUIRE(blocked > 1000);
+    REQUIRE(clear > 1000);
+
+    // A sphere behind the origin blocks the whole line but not a forward ray.
+    SphereColumns behind;
+    behind.cx = {0};
+    behind.cy = {0};
+    behind.cz = {-5};
+    behind.radius = {1};
+    behind.id = {0};
+    Ray forward{Vector3D(0, 0, 0), Vector3D(0, 0, 1)};
+    for (SimdLevel level : availableLevels()) {
+        REQUIRE(sphere_kernels::any(behind.arrays(), 0, 1, forward, -inf, inf, HitInfo::kNoObject, level));
+        REQUIRE_FALSE(sphere_kernels::any(behind.arrays(), 0, 1, forward, 0, inf, HitInfo::kNoObject, level));
+    }
+}
+
+TEST_CASE("Scene BVH leaves run the sphere kernel over a leaf-ordered copy", "[sphere_kernels]") {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coord(-20, 20);
+    std::uniform_real_distribution<float> radius(1, 12);
+
+    Scene scene;
+    std::vector<std::unique_ptr<SceneObject>> reference;
+    for (int i = 0; i < 300; i++) {
+        float x = coord(rng), y = coord(rng), z = coord(rng), r = radius(rng);
+        scene.addObject(std::make_unique<SphereSceneObject>(x, y, z, 1, 1, 1, 1, r));
+        reference.push_back(std::make_unique<SphereSceneObject>(x, y, z, 1, 1, 1, 1, r));
+    }
+    scene.buildBVH();
+
+    int hits = 0;
+    for (int i = 0; i < 500; i++) {
+        Ray ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()};
+        std::optional<HitInfo> expected = scene.bvh().intersect(ray, reference);
+        std::optional<HitInfo> hit = scene.intersect(ray);
+        REQUIRE(hit.has_value() == expected.has_value());
+        if (!expected) continue;
+        hits++;
+        REQUIRE(hit->objectId == expected->objectId);
+        REQUIRE(hit->t == expected->t);
+    }
+    REQUIRE(hits > 100);
+
+    // Moving a sphere updates its leaf-ordered copy on the next refit.
+    scene.setPosition(0, 1000, 1000, 1000);
+    BVHBuildOptions options;
+    options.rebuildSahGrowth = std::numeric_limits<float>::infinity();
+    REQUIRE(scene.updateBVH(options) == BVHUpdate::Refit);
+    Ray ray{Vector3D(1000, 1000, 1000), Vector3D(1, 0, 0)};
+    std::optional<HitInfo> hit = scene.intersect(ray);
+    REQUIRE(hit.has_value());
+    REQUIRE(hit->objectId == 0);
+}
@@ -0,0 +1,49 @@
+#include "catch_amalgamated.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+
+TEST_CASE("ThreadPool parallelFor", "[thread_pool]") {
+    SECTION("Every index runs exactly once") {
+        for (std::size_t threads : {1, 2, 4, 7}) {
+            ThreadPool pool(threads);
+            REQUIRE(pool.size() == threads);
+
+            std::vector<std::atomic<int>> calls(1000);
+            pool.parallelFor(calls.size(), [&](std::size_t idx) { calls[idx]++; });
+            for (auto& count : calls) {
+                REQUIRE(count == 1);
+            }
+        }
+    }
+
+    SECTION("Pool is reusable") {
+        ThreadPool pool(3);
+        std::atomic<std::size_t> total{0};
+        for (int round = 0; round < 50; round++) {
+            pool.parallelFor(17, [&](std::size_t idx) { total += idx; });
+        }
+        REQUIRE(total == 50 * (16 * 17 / 2));
+    }
+
+    SECTION("Empty range") {
+        ThreadPool pool(2);
+        bool called = false;
+        pool.parallelFor(0, [&](std::size_t) { called = true; });
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("Exceptions reach the caller") {
+        ThreadPool pool(4);
+        REQUIRE_THROWS_AS(pool.parallelFor(64, [](std::size_t idx) {
+            if (idx == 42) throw std::runtime_error("tile failed");
+        }), std::runtime_error);
+
+        // The pool keeps working afterwards.
+        std::atomic<int> calls{0};
+        pool.parallelFor(8, [&](std::size_t) { calls++; });
+        REQUIRE(calls == 8);
+    }
+}
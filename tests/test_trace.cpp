@@ -0,0 +1,154 @@
+#include "catch_amalgamated.hpp"
+// Compile every TRACE in this file in, whatever the build-wide level is.
+#undef TRACE_LEVEL
+#define TRACE_LEVEL 4
+#include "trace.hpp"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+// Routes trace output to a temporary file for the lifetime of a test and
+// restores the previous configuration afterwards.
+struct TraceCapture {
+    explicit TraceCapture(trace::Config config) : previous(trace::config()), file(std::tmpfile()) {
+        trace::flush();
+        config.sink = file;
+        trace::configure(config);
+    }
+    ~TraceCapture() {
+        trace::flush();
+        trace::configure(previous);
+        std::fclose(file);
+    }
+
+    std::vector<std::string> lines() {
+        trace::flush();
+        std::vector<std::string> result;
+        std::rewind(file);
+        char buffer[512];
+        while (std::fgets(buffer, sizeof(buffer), file)) {
+            std::string line(buffer);
+            if (!line.empty() && line.back() == '\n') line.pop_back();
+            result.push_back(line);
+        }
+        return result;
+    }
+
+    trace::Config previous;
+    std::FILE* file;
+};
+
+std::size_t countContaining(const std::vector<std::string>& lines, const std::string& needle) {
+    std::size_t count = 0;
+    for (const std::string& line : lines) count += line.find(needle) != std::string::npos;
+    return count;
+}
+
+int sideEffect(int& calls) {
+    return ++calls;
+}
+
+}
+
+
+TEST_CASE("Trace events are filtered by level and category", "[trace]") {
+    trace::Config config;
+    config.level = trace::Level::Info;
+    config.categories = trace::Camera | trace::Shade;
+    TraceCapture capture(config);
+
+    TRACE(Info, Camera, "camera %d", 1);
+    TRACE(Debug, Camera, "too detailed %d", 2);
+    TRACE(Info, Intersect, "filtered category %d", 3);
+    TRACE(Error, Shade, "shade %s", "error");
+
+    std::vector<std::string> lines = capture.lines();
+    REQUIRE(lines.size() == 2);
+    REQUIRE(countContaining(lines, "INFO") == 1);
+    REQUIRE(countContaining(lines, "camera 1") == 1);
+    REQUIRE(countContaining(lines, "shade error") == 1);
+    REQUIRE(trace::enabled(trace::Level::Warn, trace::Shade));
+    REQUIRE_FALSE(trace::enabled(trace::Level::Info, trace::Intersect));
+}
+
+TEST_CASE("Trace arguments are only evaluated when the event is kept", "[trace]") {
+    trace::Config config;
+    config.level = trace::Level::Info;
+    TraceCapture capture(config);
+
+    int calls = 0;
+    TRACE(Debug, Render, "runtime filtered %d", sideEffect(calls));
+    REQUIRE(calls == 0);
+    // Verbose is above this file's compile-time level, so the call is not even compiled.
+    TRACE(Verbose, Render, "compiled out %d", sideEffect(calls));
+    REQUIRE(calls == 0);
+    TRACE(Info, Render, "kept %d", sideEffect(calls));
+    REQUIRE(calls == 1);
+    REQUIRE(capture.lines().size() == 1);
+}
+
+TEST_CASE("Trace sampling and rate limiting", "[trace]") {
+    SECTION("one in N") {
+        trace::Config config;
+        config.sampleEvery = 10;
+        TraceCapture capture(config);
+        for (int i = 0; i < 100; i++) TRACE(Info, Intersect, "sampled %d", i);
+        REQUIRE(capture.lines().size() == 10);
+    }
+    SECTION("per second cap") {
+        trace::Config config;
+        config.maxPerSecond = 5;
+        TraceCapture capture(config);
+        for (int i = 0; i < 100; i++) TRACE(Info, Shade, "limited %d", i);
+        REQUIRE(capture.lines().size() == 5);
+    }
+}
+
+TEST_CASE("Trace buffers are per thread and keep each thread's order", "[trace]") {
+    trace::Config config;
+    TraceCapture capture(config);
+    trace::Stats before = trace::stats();
+
+    constexpr int kThreads = 4;
+    constexpr int kEvents = 200;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kEvents; i++) TRACE(Info, Render, "worker %d event %d", t, i);
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<std::string> lines = capture.lines();
+    trace::Stats after = trace::stats();
+    REQUIRE(after.recorded - before.recorded + after.dropped - before.dropped == kThreads * kEvents);
+    REQUIRE(lines.size() == after.recorded - before.recorded);
+    for (int t = 0; t < kThreads; t++) {
+        REQUIRE(countContaining(lines, "worker " + std::to_string(t) + " event 0") == 1);
+    }
+    std::vector<int> last(kThreads, -1);
+    for (const std::string& line : lines) {
+        int worker = -1, event = -1;
+        REQUIRE(std::sscanf(line.c_str() + line.find("worker"), "worker %d event %d", &worker, &event) == 2);
+        REQUIRE(event > last[worker]);
+        last[worker] = event;
+    }
+}
+
+TEST_CASE("Full trace buffers drop instead of blocking", "[trace]") {
+    trace::Config config;
+    config.drainInterval = std::chrono::hours(1);
+    TraceCapture capture(config);
+    trace::Stats before = trace::stats();
+
+    for (int i = 0; i < 5000; i++) TRACE(Info, Render, "burst %d", i);
+
+    trace::Stats after = trace::stats();
+    REQUIRE(after.dropped > before.dropped);
+    REQUIRE(after.recorded - before.recorded + after.dropped - before.dropped == 5000);
+    REQUIRE(capture.lines().size() == after.recorded - before.recorded);
+}
@@ -1,4 +1,5 @@
 #include "vector_data.hpp"
+#include "vector.hpp"
 #include "catch_amalgamated.hpp"
 
 
@@ -145,4 +146,160 @@ TEST_CASE("VectorData Copy Constructor", "[vector_data]") {
             REQUIRE(copy.get(0) != original.get(0));
         }
     }
+
+    SECTION("Copying a strided borrow reads only the borrowed elements") {
+        // Exactly (length - 1) * stride + 1 elements, so ASan catches an overread.
+        auto raw = std::make_unique<int[]>(7);
+        for (int i = 0; i < 7; ++i) raw[i] = i % 2 == 0 ? i / 2 : -1;
+        VectorData<int> strided = VectorData<int>::borrow(raw.get(), 4, 2);
+
+        VectorData<int> copy(strided);
+        REQUIRE(!copy.borrowed());
+        REQUIRE(copy.stride() == 1);
+        for (size_t i = 0; i < 4; i++) REQUIRE(copy.get(i) == static_cast<int>(i));
+
+        VectorData<int> assigned(std::vector<int>{9});
+        assigned = strided;
+        REQUIRE(assigned.length() == 4);
+        REQUIRE(assigned.get(3) == 3);
+        copy.set(0, 100);
+        REQUIRE(raw[0] == 0);
+    }
+
+    SECTION("Resizing a strided borrow reads only the borrowed elements") {
+        auto raw = std::make_unique<int[]>(7);
+        for (int i = 0; i < 7; ++i) raw[i] = i % 2 == 0 ? i / 2 : -1;
+        VectorData<int> same = VectorData<int>::borrow(raw.get(), 4, 2);
+        same.resize(4);
+        REQUIRE(!same.borrowed());
+        REQUIRE(same.stride() == 1);
+        for (size_t i = 0; i < 4; i++) REQUIRE(same.get(i) == static_cast<int>(i));
+
+        VectorData<int> longer = VectorData<int>::borrow(raw.get(), 4, 2);
+        longer.resize(6);
+        REQUIRE(longer.get(3) == 3);
+        REQUIRE(longer.get(5) == 0);
+        VectorData<int> shorter = VectorData<int>::borrow(raw.get(), 4, 2);
+        shorter.resize(2);
+        REQUIRE(shorter.get(1) == 1);
+        shorter.set(0, 100);
+        REQUIRE(raw[0] == 0);
+    }
+}
+
+TEST_CASE("Vector expressions", "[vector_data][expr]") {
+    VectorData<int> a(std::vector<int>{1, 2, 3, 4});
+    VectorData<int> b(std::vector<int>{10, 20, 30, 40});
+
+    SECTION("Compound expressions evaluate element-wise on assignment") {
+        VectorND<int> va(a), vb(b);
+        auto expr = asVectorExpr(va) + asVectorExpr(vb) * 2 - 1;
+        REQUIRE(expr.size() == 4);
+        REQUIRE(expr.get(2) == 3 + 60 - 1);
+        REQUIRE_THROWS_AS(expr.get(4), std::out_of_range);
+
+        VectorND<int> result = expr;
+        VectorND<int> eager = va.add(vb.mul(2)).sub(1);
+        VectorND<int> chained = va + vb * 2 - 1;
+        for (size_t i = 0; i < 4; i++) {
+            REQUIRE(result.get(i) == eager.get(i));
+            REQUIRE(chained.get(i) == eager.get(i));
+        }
+        REQUIRE((asVectorExpr(va) * vb).sum() == va.dot(vb));
+        REQUIRE((100 - asVectorExpr(va) / 2).eval().get(3) == 98);
+        REQUIRE((100 - va / 2).get(3) == 98);
+    }
+
+    SECTION("VectorND operators still give an evaluated copy") {
+        VectorND<int> va(a), vb(b);
+        auto sum = va + vb;
+        static_assert(std::is_same_v<decltype(sum), VectorND<int>>);
+        va.set(0, 1000);
+        REQUIRE(sum.get(0) == 11);
+        // Temporaries lend their buffers but are never referenced afterwards.
+        auto scaled = VectorND<int>(a) * 3 + VectorND<int>(b);
+        REQUIRE(scaled.get(3) == 52);
+        sum = va - vb;
+        REQUIRE(sum.get(0) == 990);
+
+        // A temporary that borrows a matrix row is not written through.
+        int row[4] = {1, 2, 3, 4};
+        VectorND<int> doubled = VectorND<int>(VectorData<int>::borrow(row, 4)) * 2;
+        REQUIRE(doubled.get(3) == 8);
+        REQUIRE(row[3] == 4);
+    }
+
+    SECTION("Leaves honour stride and borrowed storage") {
+        int raw[7] = {1, -1, 2, -1, 3, -1, 4};
+        VectorData<int> strided = VectorData<int>::borrow(raw, 4, 2);
+        VectorData<int> doubled = asVectorExpr(a) + strided;
+        REQUIRE(doubled.length() == 4);
+        REQUIRE(doubled.get(3) == 8);
+        REQUIRE(doubled.stride() == 1);
+    }
+
+    SECTION("Eager VectorData operators are unchanged") {
+        VectorData<int> diff = b - a;
+        REQUIRE(diff.get(3) == 36);
+        VectorData<int> quot = b / a;
+        REQUIRE(quot.get(2) == 10);
+        VectorData<int> shorter(std::vector<int>{1});
+        REQUIRE_THROWS_AS(a + shorter, std::length_error);
+        REQUIRE_THROWS_AS(VectorND<int>(a) + VectorND<int>(shorter), std::length_error);
+    }
+}
+
+TEST_CASE("VectorDataView", "[vector_data][view]") {
+    int raw[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    VectorDataView<int> all(raw, 10);
+
+    SECTION("Strided slices share the underlying memory") {
+        VectorDataView<int> evens = all.slice(0, 5, 2);
+        REQUIRE(evens.length() == 5);
+        REQUIRE(evens.stride() == 2);
+        REQUIRE(evens.get(4) == 8);
+        REQUIRE_THROWS_AS(evens.get(5), std::out_of_range);
+        REQUIRE_THROWS_AS(all.slice(2, 5, 2), std::out_of_range);
+
+        evens.set(1, 20);
+        REQUIRE(raw[2] == 20);
+        VectorDataView<int> everyFourthOdd = all.slice(1, 3, 2).slice(0, 2, 2);
+        REQUIRE(everyFourthOdd.get(1) == 5);
+    }
+
+    SECTION("Iterators step by the stride") {
+        VectorDataView<const int> odds = all.slice(1, 5, 2);
+        std::vector<int> seen(odds.begin(), odds.end());
+        REQUIRE(seen == std::vector<int>{1, 3, 5, 7, 9});
+        REQUIRE(odds.end() - odds.begin() == 5);
+        REQUIRE(odds.begin()[3] == 7);
+        REQUIRE(*std::max_element(odds.begin(), odds.end()) == 9);
+        static_assert(std::random_access_iterator<VectorDataView<int>::iterator>);
+    }
+
+    SECTION("Reductions and arithmetic") {
+        VectorDataView<const int> evens = all.slice(0, 5, 2);
+        VectorDataView<const int> odds = all.slice(1, 5, 2);
+        REQUIRE(evens.sum() == 20);
+        REQUIRE(evens.dot(odds) == 0 * 1 + 2 * 3 + 4 * 5 + 6 * 7 + 8 * 9);
+
+        VectorData<int> pairSums = evens + odds;
+        REQUIRE(pairSums.get(2) == 9);
+        VectorND<int> scaled = odds * 10 - evens;
+        REQUIRE(scaled.get(4) == 82);
+        REQUIRE((VectorND<int>(pairSums) * evens).sum() == 2 * 0 + 5 * 2 + 9 * 4 + 13 * 6 + 17 * 8);
+
+        all.slice(0, 5, 2).assign(odds * 2);
+        REQUIRE(raw[0] == 2);
+        REQUIRE(raw[8] == 18);
+        REQUIRE(raw[9] == 9);
+    }
+
+    SECTION("Views over VectorData") {
+        VectorData<float> vd(std::vector<float>{1, 2, 3, 4, 5, 6});
+        VectorDataView<float> v = vd.view();
+        v.slice(3, 3).assign(v.slice(0, 3));
+        REQUIRE(vd.get(5) == 3);
+        REQUIRE(std::as_const(vd).view().sum() == 1 + 2 + 3 + 1 + 2 + 3);
+    }
 }
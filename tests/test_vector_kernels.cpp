@@ -0,0 +1,105 @@
+#include "catch_amalgamated.hpp"
+#include "vector.hpp"
+#include "vector_kernels.hpp"
+#include <random>
+
+
+namespace {
+
+std::vector<SimdLevel> availableLevels() {
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level <= detectSimdLevel()) levels.push_back(level);
+    }
+    return levels;
+}
+
+template <typename T>
+std::vector<T> randomValues(std::size_t n, std::mt19937& rng) {
+    std::uniform_real_distribution<T> value(-4, 4);
+    std::vector<T> values(n);
+    for (T& v : values) v = value(rng);
+    return values;
+}
+
+// Every SIMD level against the scalar loop, over lengths that exercise the
+// unrolled body, the single-vector step and the scalar tail.
+template <typename T>
+void checkKernels() {
+    std::mt19937 rng(9);
+    for (std::size_t n : {0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 64, 100, 1023}) {
+        std::vector<T> a = randomValues<T>(n, rng);
+        std::vector<T> b = randomValues<T>(n, rng);
+        for (T& v : b) v = v == 0 ? T(1) : v;
+        T s = T(1.75);
+
+        for (VectorOp op : {VectorOp::Add, VectorOp::Sub, VectorOp::Mul, VectorOp::Div}) {
+            std::vector<T> expected(n), expectedScalar(n);
+            vector_kernels::binary(op, a.data(), b.data(), expected.data(), n, SimdLevel::Scalar);
+            vector_kernels::binaryScalar(op, a.data(), s, expectedScalar.data(), n, SimdLevel::Scalar);
+            for (SimdLevel level : availableLevels()) {
+                CAPTURE(n, int(op), simdLevelName(level));
+                std::vector<T> out(n), outScalar(n);
+                vector_kernels::binary(op, a.data(), b.data(), out.data(), n, level);
+                vector_kernels::binaryScalar(op, a.data(), s, outScalar.data(), n, level);
+                // Element-wise results are exact: one IEEE operation per element.
+                REQUIRE(out == expected);
+                REQUIRE(outScalar == expectedScalar);
+            }
+        }
+
+        T sum = vector_kernels::sum(a.data(), n, SimdLevel::Scalar);
+        T dot = vector_kernels::dot(a.data(), b.data(), n, SimdLevel::Scalar);
+        T dist = vector_kernels::distanceSquared(a.data(), b.data(), n, SimdLevel::Scalar);
+        for (SimdLevel level : availableLevels()) {
+            CAPTURE(n, simdLevelName(level));
+            // Reductions only differ by summation order.
+            double margin = 1e-4 * (n + 1);
+            REQUIRE(vector_kernels::sum(a.data(), n, level) == Catch::Approx(sum).margin(margin));
+            REQUIRE(vector_kernels::dot(a.data(), b.data(), n, level) == Catch::Approx(dot).margin(margin));
+            REQUIRE(vector_kernels::distanceSquared(a.data(), b.data(), n, level) == Catch::Approx(dist).margin(margin));
+        }
+    }
+}
+
+}
+
+TEST_CASE("SIMD vector kernels match the scalar loop", "[vector_kernels]") {
+    INFO("detected " << simdLevelName(detectSimdLevel()));
+    checkKernels<float>();
+    checkKernels<double>();
+}
+
+TEST_CASE("VectorData picks the same results for contiguous and strided data", "[vector_kernels]") {
+    std::mt19937 rng(10);
+    const std::size_t n = 37;
+    std::vector<float> values = randomValues<float>(n, rng);
+    std::vector<float> interleaved(2 * n - 1, -1);
+    for (std::size_t i = 0; i < n; i++) interleaved[2 * i] = values[i];
+
+    VectorData<float> contiguous(values);
+    VectorData<float> strided = VectorData<float>::borrow(interleaved.data(), n, 2);
+
+    VectorData<float> a = contiguous * 3.0f + 1.0f;
+    VectorData<float> b = strided * 3.0f + 1.0f;
+    VectorData<float> sumA = contiguous + a;
+    VectorData<float> sumB = strided + b;
+    for (std::size_t i = 0; i < n; i++) {
+        REQUIRE(a.get(i) == b.get(i));
+        REQUIRE(sumA.get(i) == sumB.get(i));
+    }
+    REQUIRE(contiguous.sum() == Catch::Approx(strided.sum()));
+
+    VectorND<float> u(contiguous), v(a);
+    VectorND<float> uStrided(VectorData<float>::borrow(interleaved.data(), n, 2));
+    REQUIRE(u.dot(v) == Catch::Approx(uStrided.dot(v)));
+    REQUIRE(u.distance(v) == Catch::Approx(uStrided.distance(v)));
+    REQUIRE(u.magnitude() == Catch::Approx(uStrided.magnitude()));
+
+    strided *= 2.0f;
+    contiguous *= 2.0f;
+    for (std::size_t i = 0; i < n; i++) {
+        REQUIRE(interleaved[2 * i] == contiguous.get(i));
+        if (i + 1 < n) REQUIRE(interleaved[2 * i + 1] == -1);
+    }
+}
@@ -0,0 +1,71 @@
+#include "catch_amalgamated.hpp"
+#include "sphere_kernels.hpp"
+#include "wide_bvh.hpp"
+#include <random>
+
+
+namespace {
+
+template <int Width>
+void checkAgainstBinary(int objectCount, std::mt19937& rng) {
+    std::uniform_real_distribution<float> coord(-25, 25);
+    std::uniform_real_distribution<float> radius(0.5, 8);
+
+    std::vector<std::unique_ptr<SceneObject>> objects;
+    for (int i = 0; i < objectCount; i++) {
+        objects.push_back(std::make_unique<SphereSceneObject>(coord(rng), coord(rng), coord(rng), 1, 1, 1, 1, radius(rng)));
+    }
+    BVH bvh(objects);
+    WideBVH<Width> wide(bvh);
+    REQUIRE_FALSE(wide.empty());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(wide.nodes().data()) % 64 == 0);
+
+    // Every binary leaf appears exactly once among the wide tree's leaf slots.
+    std::size_t leafEntries = 0;
+    for (const auto& node : wide.nodes()) {
+        for (int slot = 0; slot < Width; slot++) {
+            if (node.count[slot] != WideNode<Width>::kEmptySlot) leafEntries += node.count[slot];
+        }
+    }
+    REQUIRE(leafEntries == objects.size());
+
+    auto leaf = [&](const Ray& ray) {
+        return [&objects, &bvh, &ray](std::uint32_t first, std::uint32_t count, std::optional<PrimitiveHit>& best) {
+            for (std::uint32_t i = first; i < first + count; i++) {
+                std::uint32_t idx = bvh.indices()[i];
+                std::optional<HitInfo> hit = objects[idx]->intersect(ray.origin, ray.direction);
+                if (!hit) continue;
+                PrimitiveHit candidate{idx, hit->t};
+                if (!best || candidate.closerThan(*best)) best = candidate;
+            }
+        };
+    };
+
+    int hits = 0;
+    for (int i = 0; i < 300; i++) {
+        Ray ray{Vector3D(coord(rng), coord(rng), coord(rng)), Vector3D(coord(rng), coord(rng), coord(rng)).normalize()};
+        std::optional<PrimitiveHit> expected = bvh_detail::closestLeafHit(bvh.nodes().data(), ray, leaf(ray));
+        std::optional<PrimitiveHit> best;
+        wide.closestLeafHit(ray, best, leaf(ray));
+        REQUIRE(best.has_value() == expected.has_value());
+        if (!expected) continue;
+        hits++;
+        REQUIRE(best->index == expected->index);
+        REQUIRE(best->t == expected->t);
+    }
+    if (objectCount >= 100) REQUIRE(hits > 30);
+}
+
+}
+
+
+TEST_CASE("Wide BVH finds the same hits as the binary BVH", "[wide_bvh]") {
+    std::mt19937 rng(21);
+    // 1 and 3 objects make a leaf root; the rest exercise partly filled nodes.
+    for (int count : {1, 3, 7, 40, 1000}) {
+        CAPTURE(count);
+        checkAgainstBinary<4>(count, rng);
+        checkAgainstBinary<8>(count, rng);
+    }
+    REQUIRE(WideBVH<8>(BVH()).empty());
+}
@@ -0,0 +1,48 @@
+// Converts a text scene (see include/scene_file.hpp) into a binary scene cache
+// (include/scene_cache.hpp) with its BVH prebuilt.
+//
+//   scene_cache <input.scene> <output.rtcache>
+#include "scene_cache.hpp"
+#include "scene_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <exception>
+
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <input.scene> <output.rtcache>\n", argv[0]);
+        return 2;
+    }
+    try {
+        auto start = std::chrono::steady_clock::now();
+        Scene scene;
+        RenderSettings settings;
+        SceneFileStats stats = loadScene(argv[1], scene, settings);
+        double parsed = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        scene.buildBVH();
+        double built = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        writeSceneCache(argv[2], scene, settings);
+        SceneCache(argv[2]).verify();
+        double written = secondsSince(start);
+
+        std::printf("%zu objects, %zu lights, %zu BVH nodes: parse %.2f s, build %.2f s, write %.2f s\n",
+                    stats.objects, stats.lights, scene.bvh().nodes().size(), parsed, built, written);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}